@@ -0,0 +1,481 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * CascadeInferencerBin.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gst/video/video.h>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/substitute.h"
+#include "CascadeInferencerBin.h"
+
+namespace szd {
+
+bool CascadeInferencerBin::FrameQueue::TryPush(std::unique_ptr<Frame> &frame) {
+  absl::MutexLock lock(&mutex_);
+  if (closed_ || frames_.size() >= kQueueSize) {
+    return false;
+  }
+  frames_.push_back(std::move(frame));
+  cond_.SignalAll();
+  return true;
+}
+
+void CascadeInferencerBin::FrameQueue::Push(std::unique_ptr<Frame> frame) {
+  absl::MutexLock lock(&mutex_);
+  while (!closed_ && frames_.size() >= kQueueSize) {
+    cond_.Wait(&mutex_);
+  }
+  if (!closed_) {
+    frames_.push_back(std::move(frame));
+    cond_.SignalAll();
+  }
+}
+
+std::unique_ptr<CascadeInferencerBin::Frame>
+CascadeInferencerBin::FrameQueue::Pop() {
+  absl::MutexLock lock(&mutex_);
+  while (!closed_ && frames_.empty()) {
+    cond_.Wait(&mutex_);
+  }
+  if (closed_) {
+    return nullptr;
+  }
+  auto frame = std::move(frames_.front());
+  frames_.pop_front();
+  cond_.SignalAll();
+  return frame;
+}
+
+void CascadeInferencerBin::FrameQueue::Close() {
+  absl::MutexLock lock(&mutex_);
+  closed_ = true;
+  frames_.clear();
+  cond_.SignalAll();
+}
+
+size_t CascadeInferencerBin::SelectRegions(const CascadeStage &stage,
+                                           std::vector<Region> *regions) {
+  auto end = std::remove_if(
+      regions->begin(), regions->end(), [&stage](const Region &region) {
+        const auto &box = region.box;
+        return (!stage.labels.empty() && !stage.labels.count(box.candidate))
+            || box.x2 - box.x1 < stage.min_size
+            || box.y2 - box.y1 < stage.min_size;
+      });
+  regions->erase(end, regions->end());
+  std::sort(regions->begin(), regions->end(),
+            [](const Region &a, const Region &b) {
+              return a.box.score > b.box.score;
+            });
+  if (!stage.top_k || regions->size() <= stage.top_k) {
+    return 0;
+  }
+  const size_t cut = regions->size() - stage.top_k;
+  regions->erase(regions->begin() + stage.top_k, regions->end());
+  return cut;
+}
+
+YuvImage CascadeInferencerBin::CopyYuvImage(const YuvImage &image,
+                                            std::vector<uint8_t> *pixels) {
+  const int chroma_width = (image.width + 1) / 2;
+  const int chroma_height = (image.height + 1) / 2;
+  const size_t luma_bytes = static_cast<size_t>(image.width) * image.height;
+  const size_t chroma_bytes = static_cast<size_t>(chroma_width)
+      * chroma_height;
+  pixels->resize(luma_bytes + 2 * chroma_bytes);
+
+  YuvImage copy = image;
+  uint8_t *y = pixels->data();
+  uint8_t *u = y + luma_bytes;
+  uint8_t *v = u + chroma_bytes;
+  copy.y = y;
+  copy.u = u;
+  copy.v = v;
+  copy.y_stride = image.width;
+  copy.uv_stride = chroma_width;
+  copy.uv_pixel_stride = 1;
+
+  for (int row = 0; row < image.height; ++row) {
+    memcpy(y + row * image.width, image.y + row * image.y_stride,
+           image.width);
+  }
+  for (int row = 0; row < chroma_height; ++row) {
+    const uint8_t *src_u = image.u + row * image.uv_stride;
+    const uint8_t *src_v = image.v + row * image.uv_stride;
+    uint8_t *dst_u = u + row * chroma_width;
+    uint8_t *dst_v = v + row * chroma_width;
+    if (image.uv_pixel_stride == 1) {
+      memcpy(dst_u, src_u, chroma_width);
+      memcpy(dst_v, src_v, chroma_width);
+      continue;
+    }
+    for (int x = 0; x < chroma_width; ++x) {
+      dst_u[x] = src_u[x * image.uv_pixel_stride];
+      dst_v[x] = src_v[x * image.uv_pixel_stride];
+    }
+  }
+  return copy;
+}
+
+GstFlowReturn CascadeInferencerBin::AppsinkOnNewSample(GstElement *sink) {
+  GstSample *sample = NULL;
+  g_signal_emit_by_name(sink, "pull-sample", &sample);
+  if (!sample) {
+    g_error("Failed to pull appsink sample\n");
+    return GST_FLOW_ERROR;
+  }
+  if (inferencer_->GetInferencerType() == kNone) {
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+  }
+  TraceAppsinkSample(sample);
+  if (!DoInterpret()) {
+    metrics_[0].skipped->Increment();
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+  }
+  {
+    absl::MutexLock lock(&mutex_);
+    if (stopped_) {
+      gst_sample_unref(sample);
+      return GST_FLOW_FLUSHING;
+    }
+    in_callback_ = true;
+  }
+
+  GstFlowReturn retval = GST_FLOW_OK;
+  GstVideoFrame video_frame;
+  YuvImage image;
+  if (MapYuvFrame(sample, &video_frame, &image)) {
+    auto frame = std::make_unique<Frame>();
+    frame->pts = GST_BUFFER_PTS(gst_sample_get_buffer(sample));
+    // The first stage infers the whole frame.
+    frame->regions.emplace_back();
+    auto &whole = frame->regions.back();
+    whole.box = { "", 1.0f, 0.0f, 0.0f, 1.0f, 1.0f };
+    whole.image = image;
+    RunStage(0, *frame);
+    // The regions of the next stage have their own pixels by now.
+    gst_video_frame_unmap(&video_frame);
+
+    if (stages_[0]->result.dropped) {
+      // Dropped by the TPU scheduler, the last results stay on screen.
+    } else if (stages_.size() == 1) {
+      ShowResults(*frame);
+    } else if (!stages_[1]->queue.TryPush(frame)) {
+      // Rather drop the frame than hold up the streaming thread.
+      metrics_[1].dropped->Increment(frame->regions.size());
+    }
+  } else {
+    g_error("Couldn't map buffer\n");
+    retval = GST_FLOW_ERROR;
+  }
+  gst_sample_unref(sample);
+
+  absl::MutexLock lock(&mutex_);
+  in_callback_ = false;
+  cond_.SignalAll();
+  return retval;
+}
+
+void CascadeInferencerBin::RunWorker(size_t index) {
+  auto &stage = *stages_[index];
+  while (auto frame = stage.queue.Pop()) {
+    ThreadPlacement::Enter(trace_stream_, ThreadPlacement::kInference);
+    Tracer::SetContext(trace_stream_, frame->pts);
+    RunStage(index, *frame);
+    if (index + 1 < stages_.size()) {
+      stages_[index + 1]->queue.Push(std::move(frame));
+    } else {
+      ShowResults(*frame);
+    }
+  }
+}
+
+void CascadeInferencerBin::RunStage(size_t index, Frame &frame) {
+  TraceSpan span(index == 0 ? "cascade_frame" : "cascade_regions");
+  auto &stage = *stages_[index];
+  auto &inferencer = *stage.config.inferencer;
+  auto &result = stage.result;
+  auto &metrics = metrics_[index];
+  auto &outputs = stage.outputs;
+  outputs.clear();
+  const bool classifier = inferencer.GetInferencerType() == kClassification;
+
+  for (size_t i = 0; i < frame.regions.size(); ++i) {
+    const auto &region = frame.regions[i];
+    // Only the whole frame is letterboxed, crops are stretched like the
+    // crops classifiers are trained on.
+    PrepareInput(region.image, stage.preprocessor, inferencer,
+                 index == 0 && letterbox_);
+    auto width = inferencer.GetInputWidth();
+    auto start_ns = Tracer::Now();
+    inferencer.InterpretFrame(inferencer.GetInputTensor(),
+                              inferencer.GetInputBytes(), width,
+                              inferencer.GetInputHeight(), width * 3, result);
+    metrics.latency->ObserveNs(Tracer::Now() - start_ns);
+    if (result.dropped) {
+      // The region keeps the label of the stage before.
+      metrics.dropped->Increment();
+      continue;
+    }
+    metrics.inferred->Increment();
+
+    if (classifier) {
+      if (result.classifications.empty()) {
+        continue;
+      }
+      outputs.emplace_back();
+      auto &output = outputs.back();
+      output.box = region.box;
+      output.box.candidate = result.classifications.front().candidate;
+      output.box_index = region.box_index;
+      output.parent = i;
+      if (output.box_index == kNoBox) {
+        output.box_index = frame.boxes.size();
+        frame.boxes.push_back(output.box);
+      } else {
+        frame.boxes[output.box_index].candidate = output.box.candidate;
+      }
+      continue;
+    }
+    const auto &box = region.box;
+    const float box_width = box.x2 - box.x1;
+    const float box_height = box.y2 - box.y1;
+    for (const auto &detection : result.detections) {
+      outputs.emplace_back();
+      auto &output = outputs.back();
+      // From region to frame coordinates.
+      output.box = detection;
+      output.box.x1 = box.x1 + detection.x1 * box_width;
+      output.box.x2 = box.x1 + detection.x2 * box_width;
+      output.box.y1 = box.y1 + detection.y1 * box_height;
+      output.box.y2 = box.y1 + detection.y2 * box_height;
+      output.box_index = frame.boxes.size();
+      output.parent = i;
+      output.crop = { detection.x1, detection.y1, detection.x2, detection.y2 };
+      frame.boxes.push_back(output.box);
+    }
+  }
+
+  if (index + 1 < stages_.size()) {
+    const size_t cut = SelectRegions(stages_[index + 1]->config, &outputs);
+    if (cut) {
+      metrics_[index + 1].dropped->Increment(cut);
+    }
+    // Only the regions the next stage infers are copied.
+    for (auto &output : outputs) {
+      auto &parent = frame.regions[output.parent];
+      if (classifier && !parent.pixels.empty()) {
+        // A labelled region is passed on as it is.
+        output.pixels.swap(parent.pixels);
+        output.image = parent.image;
+        continue;
+      }
+      const auto &image = parent.image;
+      const auto &crop = output.crop;
+      output.image = CopyYuvImage(
+          CropYuvImage(image, crop.x1 * image.width, crop.y1 * image.height,
+                       (crop.x2 - crop.x1) * image.width,
+                       (crop.y2 - crop.y1) * image.height),
+          &output.pixels);
+    }
+  }
+  frame.regions.swap(outputs);
+}
+
+void CascadeInferencerBin::ShowResults(const Frame &frame) {
+  const Region *best = nullptr;
+  for (const auto &region : frame.regions) {
+    if (!best || region.box.score > best->box.score) {
+      best = &region;
+    }
+  }
+  const auto &description =
+      stages_.back()->config.inferencer->GetModelDescription();
+  if (!best) {
+    g_object_set(G_OBJECT(cropper_), "left", 0, "right", 0, "top", 0,
+                 "bottom", 0, NULL);
+    g_object_set(G_OBJECT(text_overlay_1_), "text", description.c_str(),
+                 NULL);
+  } else {
+    const auto &box = best->box;
+    int crop_left = box.x1 * cropper_input_width_;
+    int crop_right = cropper_input_width_ - box.x2 * cropper_input_width_;
+    int crop_top = box.y1 * cropper_input_height_;
+    int crop_bottom = cropper_input_height_ - box.y2 * cropper_input_height_;
+    g_object_set(G_OBJECT(cropper_), "left", crop_left, "right", crop_right,
+                 "top", crop_top, "bottom", crop_bottom, NULL);
+    auto output = absl::StrCat(description, "\n", box.candidate);
+    g_object_set(G_OBJECT(text_overlay_1_), "text", output.c_str(), NULL);
+  }
+  OutputInferenceResult(ResultsToSvg(frame.boxes));
+}
+
+void CascadeInferencerBin::SetFullScreenCaps(int src_pad) {
+  std::string caps = "video/x-raw, width=$0, height=$1, pixel-aspect-ratio=1/1";
+  caps = absl::Substitute(caps, fullscreen_video_width_,
+                          fullscreen_video_height_);
+
+  auto filter = src_pad == 0 ? filter_0_ : filter_1_;
+  gst_util_set_object_arg(G_OBJECT(filter), "caps", caps.c_str());
+}
+
+void CascadeInferencerBin::SetTiledViewCaps(int src_pad) {
+  std::string caps = "video/x-raw, width=$0, height=$1, pixel-aspect-ratio=1/1";
+  caps = absl::Substitute(caps, tiled_video_width_, tiled_video_height_);
+
+  auto filter = src_pad == 0 ? filter_0_ : filter_1_;
+  gst_util_set_object_arg(G_OBJECT(filter), "caps", caps.c_str());
+}
+
+GstPadProbeReturn CascadeInferencerBin::CropperSinkPadCallback(
+    GstPad *pad, GstPadProbeInfo *info) {
+  auto event = gst_pad_probe_info_get_event(info);
+  if (GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+    GstCaps *caps = gst_caps_new_any();
+    gst_event_parse_caps(event, &caps);
+
+    GstStructure *s = gst_caps_get_structure(caps, 0);
+
+    auto res = gst_structure_get_int(s, "width", &cropper_input_width_);
+    CHECK(res);
+    res |= gst_structure_get_int(s, "height", &cropper_input_height_);
+    CHECK(res);
+  } else if (GST_EVENT_TYPE(event) == GST_EVENT_RECONFIGURE) {
+    return GST_PAD_PROBE_DROP;
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+CascadeInferencerBin::CascadeInferencerBin(
+    const std::vector<CascadeStage> &stages, std::string video_file)
+    :
+    InferencerBin(stages.at(0).inferencer) {
+  for (const auto &stage : stages) {
+    switch (auto type = stage.inferencer->GetInferencerType()) {
+      case kNone:
+      case kDetection:
+      case kManufacturing:
+      case kClassification:
+        break;
+      default:
+        g_error("Unsupported cascade inferencer type %d\n", type);
+    }
+  }
+
+  SetupAllDims(video_file);
+  auto bin_src = absl::Substitute(inferencer_bin_src_, tiled_video_width_,
+                                  tiled_video_height_,
+                                  MakeInputBranch(*inferencer_));
+  SetupBin(bin_src, video_file);
+  for (size_t i = 0; i < stages.size(); ++i) {
+    SetupMetrics(i, *stages[i].inferencer);
+    stages_.push_back(std::make_unique<Stage>());
+    stages_.back()->config = stages[i];
+  }
+
+  filter_1_ = gst_bin_get_by_name(GST_BIN(bin_), "filter_1");
+
+  // set up callback for cropper sink pad to query width and height
+  cropper_ = gst_bin_get_by_name(GST_BIN(bin_), "cropper");
+  auto cropper_sink_pad = gst_element_get_static_pad(cropper_, "sink");
+  gst_pad_add_probe(
+      cropper_sink_pad,
+      GST_PAD_PROBE_TYPE_EVENT_BOTH,
+      reinterpret_cast<GstPadProbeCallback>(+[](
+          GstPad *pad, GstPadProbeInfo *info,
+          CascadeInferencerBin *self) -> GstPadProbeReturn {
+        return self->CropperSinkPadCallback(pad, info);
+      }),
+      this, NULL);
+  gst_object_unref(cropper_sink_pad);
+
+  text_overlay_1_ = gst_bin_get_by_name(GST_BIN(bin_), "text_1");
+  g_object_set(
+      G_OBJECT(text_overlay_1_), "text",
+      stages_.back()->config.inferencer->GetModelDescription().c_str(), NULL);
+
+  // The workers draw into both tiles, so they start once the elements are
+  // found.
+  for (size_t i = 1; i < stages_.size(); ++i) {
+    stages_[i]->thread = std::thread([this, i] {
+      RunWorker(i);
+    });
+  }
+
+  appsink_0_ = gst_bin_get_by_name(GST_BIN(bin_), "appsink_0");
+  g_object_set(appsink_0_, "emit-signals", true, NULL);
+  g_signal_connect(
+      appsink_0_,
+      "new-sample",
+      reinterpret_cast<GCallback>(+[](
+          GstElement *sink, CascadeInferencerBin *self) -> GstFlowReturn {
+        return self->AppsinkOnNewSample(sink);
+      }),
+      this);
+
+  // Setup the output pads to be connected to the mixer
+  auto source_pad_internal = gst_element_get_static_pad(text_overlay_0_, "src");
+  auto source_pad = gst_ghost_pad_new("inf_bin_src_0", source_pad_internal);
+  gst_element_add_pad(bin_, source_pad);
+  gst_object_unref(source_pad_internal);
+
+  source_pad_internal = gst_element_get_static_pad(text_overlay_1_, "src");
+  source_pad = gst_ghost_pad_new("inf_bin_src_1", source_pad_internal);
+  gst_element_add_pad(bin_, source_pad);
+  gst_object_unref(source_pad_internal);
+
+  num_src_pads_ = 2;
+}
+
+CascadeInferencerBin::~CascadeInferencerBin() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopped_ = true;
+    // The streaming thread may still be in AppsinkOnNewSample, and push to
+    // the second stage.
+    while (in_callback_) {
+      cond_.Wait(&mutex_);
+    }
+  }
+  // Closing drops the queued frames, which own their pixels.
+  for (auto &stage : stages_) {
+    stage->queue.Close();
+  }
+  for (auto &stage : stages_) {
+    if (stage->thread.joinable()) {
+      stage->thread.join();
+    }
+  }
+  gst_object_unref(filter_1_);
+  gst_object_unref(appsink_0_);
+  gst_object_unref(text_overlay_1_);
+  gst_object_unref(cropper_);
+}
+
+} /* namespace szd */
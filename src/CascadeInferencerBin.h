@@ -0,0 +1,188 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * CascadeInferencerBin.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_CASCADEINFERENCERBIN_H_
+#define SRC_CASCADEINFERENCERBIN_H_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+
+#include "InferencerBin.h"
+
+namespace szd {
+  // The cropper branch only shows the best region of the last stage, the
+  // stages get their pixels from the appsink_0 frame, see
+  // CascadeInferencerBin::RunStage.
+  const std::string kCascadeInferencerBinSrc =
+      "queue name=q ! videoconvert ! tee name=t "
+          "t. ! videoscale ! capsfilter name=filter_0 caps=video/x-raw,width=$0,height=$1 ! queue ! videoconvert ! "
+          "rsvgoverlay fit-to-frame=true name=rsvg_0 ! textoverlay name=text_0 "
+          "t. ! $2 ! "
+          "queue name=appq_0 leaky=downstream max-size-buffers=1 ! appsink name=appsink_0 "
+          "t. ! videocrop name=cropper ! videoscale ! capsfilter name=filter_1 caps=video/x-raw,width=$0,height=$1,pixel-aspect-ratio=1/1 ! queue ! "
+          "videoconvert ! textoverlay name=text_1";
+
+// One model of a cascade and which regions of the stage before it infers.
+// The filters of the first stage are ignored, it sees the whole frame.
+// Stages share a TPU when their inferencers are co-compiled, see
+// ClassificationInferencer.
+struct CascadeStage {
+  std::shared_ptr<InferencerBase> inferencer;
+  // Only regions labelled with one of these, all when empty.
+  std::set<std::string> labels;
+  // Minimum width and height of a region, relative to the frame.
+  float min_size = 0.0f;
+  // At most this many regions per frame, the highest scoring, 0 for all.
+  size_t top_k = 0;
+};
+
+// Runs a cascade of models on one stream, e.g. bird -> species or
+// vehicle -> plate -> characters. The first stage infers the whole frame on
+// the streaming thread, every later stage has its own thread and infers the
+// regions the stage before found that pass its filters, so the stages of
+// consecutive frames run at the same time. Detection stages replace the
+// regions with what they find inside them, classification stages label
+// them. The pixels of the regions are copied out of the frame before it is
+// unmapped, no sample is held while a frame waits for the next stage.
+//
+// The first tile shows the boxes of all stages, the second one the best
+// region of the last stage.
+class CascadeInferencerBin : public InferencerBin {
+ public:
+  CascadeInferencerBin(const std::vector<CascadeStage> &stages,
+                       std::string video_file);
+  CascadeInferencerBin() = delete;
+  CascadeInferencerBin(const CascadeInferencerBin &other) = delete;
+  CascadeInferencerBin(CascadeInferencerBin &&other) = delete;
+  CascadeInferencerBin& operator=(const CascadeInferencerBin &other) = delete;
+  CascadeInferencerBin& operator=(CascadeInferencerBin &&other) = delete;
+  virtual ~CascadeInferencerBin();
+
+  static const size_t kNoBox = SIZE_MAX;
+
+  struct Rect {
+    float x1, y1, x2, y2;
+  };
+  // A part of the frame on its way through the stages.
+  struct Region {
+    // Relative to the frame. The candidate is what the filters of the next
+    // stage match.
+    DetectionResult box;
+    // Where box is drawn in the results of the frame, kNoBox for the whole
+    // frame until a classification stage labels it.
+    size_t box_index = kNoBox;
+    // The region of the stage before this one was found in and where,
+    // relative to that region.
+    size_t parent = 0;
+    Rect crop = { 0.0f, 0.0f, 1.0f, 1.0f };
+    // What the stage infers. image points into pixels, or into the mapped
+    // frame for the first stage. Moving a Region keeps pixels in place.
+    std::vector<uint8_t> pixels;
+    YuvImage image = { };
+  };
+
+  // Leaves the regions stage infers, highest scores first. Returns how many
+  // passed the filters but were cut off by top_k.
+  static size_t SelectRegions(const CascadeStage &stage,
+                              std::vector<Region> *regions);
+  // Copies image into pixels as I420 and returns the copy.
+  static YuvImage CopyYuvImage(const YuvImage &image,
+                               std::vector<uint8_t> *pixels);
+
+ private:
+  // Frames waiting in front of each stage past the first.
+  static const size_t kQueueSize = 2;
+
+  struct Frame {
+    uint64_t pts;
+    // What the next stage infers.
+    std::vector<Region> regions;
+    // What all stages found so far.
+    std::vector<DetectionResult> boxes;
+  };
+  class FrameQueue {
+   public:
+    // Returns false and leaves frame alone when the queue is full.
+    bool TryPush(std::unique_ptr<Frame> &frame);
+    // Blocks while the queue is full, drops frame once closed.
+    void Push(std::unique_ptr<Frame> frame);
+    // Blocks until a frame arrives, returns nullptr once closed.
+    std::unique_ptr<Frame> Pop();
+    void Close();
+
+   private:
+    absl::Mutex mutex_;
+    absl::CondVar cond_;
+    std::deque<std::unique_ptr<Frame>> frames_;
+    bool closed_ = false;
+  };
+  struct Stage {
+    CascadeStage config;
+    FramePreprocessor preprocessor;
+    // Reused for every region.
+    InferenceResult result;
+    std::vector<Region> outputs;
+    // Unused by the first stage, which runs on the streaming thread.
+    FrameQueue queue;
+    std::thread thread;
+  };
+
+  const std::string inferencer_bin_src_ = kCascadeInferencerBinSrc;
+  GstFlowReturn AppsinkOnNewSample(GstElement *sink) override;
+  // Runs the stage at index on the frames queued for it until the bin is
+  // destroyed.
+  void RunWorker(size_t index);
+  // Infers the regions of frame with the stage at index and replaces them
+  // with the ones the next stage infers, their pixels copied.
+  void RunStage(size_t index, Frame &frame);
+  // Draws the results of a frame that went through all stages.
+  void ShowResults(const Frame &frame);
+  void SetFullScreenCaps(int src_pad) override;
+  void SetTiledViewCaps(int src_pad) override;
+  GstPadProbeReturn CropperSinkPadCallback(GstPad *pad, GstPadProbeInfo *info);
+
+  std::vector<std::unique_ptr<Stage>> stages_;
+  GstElement *filter_1_;
+  GstElement *text_overlay_1_;
+  GstElement *appsink_0_;
+  GstElement *cropper_;
+  int cropper_input_width_;
+  int cropper_input_height_;
+
+  // Lets the destructor wait for the streaming thread to leave
+  // AppsinkOnNewSample.
+  absl::Mutex mutex_;
+  absl::CondVar cond_;
+  bool in_callback_ = false;
+  bool stopped_ = false;
+  friend class MixerBin;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_CASCADEINFERENCERBIN_H_ */
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * CascadeInferencerBinTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "CascadeInferencerBin.h"
+
+namespace szd {
+
+static CascadeInferencerBin::Region MakeRegion(const std::string &label,
+                                               float score, float size) {
+  CascadeInferencerBin::Region region;
+  region.box = { label, score, 0.1f, 0.1f, 0.1f + size, 0.1f + size };
+  return region;
+}
+
+TEST(CascadeInferencerBinTest, SelectsAllRegionsWithoutFilters) {
+  std::vector<CascadeInferencerBin::Region> regions;
+  regions.push_back(MakeRegion("bird", 0.5f, 0.2f));
+  regions.push_back(MakeRegion("cat", 0.9f, 0.01f));
+  regions.push_back(MakeRegion("bird", 0.7f, 0.3f));
+  EXPECT_EQ(CascadeInferencerBin::SelectRegions({ }, &regions), 0u);
+  ASSERT_EQ(regions.size(), 3u);
+  // Highest scores first.
+  EXPECT_EQ(regions[0].box.score, 0.9f);
+  EXPECT_EQ(regions[1].box.score, 0.7f);
+  EXPECT_EQ(regions[2].box.score, 0.5f);
+}
+
+TEST(CascadeInferencerBinTest, FiltersByLabelAndSize) {
+  std::vector<CascadeInferencerBin::Region> regions;
+  regions.push_back(MakeRegion("bird", 0.5f, 0.2f));
+  regions.push_back(MakeRegion("cat", 0.9f, 0.2f));
+  regions.push_back(MakeRegion("bird", 0.7f, 0.05f));
+  regions.push_back(MakeRegion("car", 0.6f, 0.4f));
+  CascadeStage stage;
+  stage.labels = { "bird", "car" };
+  stage.min_size = 0.1f;
+  EXPECT_EQ(CascadeInferencerBin::SelectRegions(stage, &regions), 0u);
+  ASSERT_EQ(regions.size(), 2u);
+  EXPECT_EQ(regions[0].box.candidate, "car");
+  EXPECT_EQ(regions[1].box.candidate, "bird");
+  EXPECT_EQ(regions[1].box.score, 0.5f);
+}
+
+TEST(CascadeInferencerBinTest, KeepsTheTopScoringRegions) {
+  std::vector<CascadeInferencerBin::Region> regions;
+  for (int i = 0; i < 10; ++i) {
+    regions.push_back(MakeRegion(i % 2 ? "bird" : "cat", i / 10.0f, 0.2f));
+  }
+  CascadeStage stage;
+  stage.labels = { "bird" };
+  stage.top_k = 3;
+  // Five birds pass the filters, the two lowest are cut off.
+  EXPECT_EQ(CascadeInferencerBin::SelectRegions(stage, &regions), 2u);
+  ASSERT_EQ(regions.size(), 3u);
+  EXPECT_FLOAT_EQ(regions[0].box.score, 0.9f);
+  EXPECT_FLOAT_EQ(regions[1].box.score, 0.7f);
+  EXPECT_FLOAT_EQ(regions[2].box.score, 0.5f);
+}
+
+// A frame of width x height with padded rows, the pixel at (x, y) has luma
+// x + 16 * y and chroma derived from its chroma position.
+class Frame {
+ public:
+  Frame(int width, int height, bool nv12) {
+    const int chroma_width = (width + 1) / 2;
+    const int chroma_height = (height + 1) / 2;
+    const int y_stride = width + 5;
+    const int uv_pixel_stride = nv12 ? 2 : 1;
+    const int uv_stride = chroma_width * uv_pixel_stride + 3;
+    pixels_.assign(y_stride * height + 2 * uv_stride * chroma_height, 0xee);
+    uint8_t *y = pixels_.data();
+    uint8_t *u = y + y_stride * height;
+    uint8_t *v = nv12 ? u + 1 : u + uv_stride * chroma_height;
+    for (int row = 0; row < height; ++row) {
+      for (int x = 0; x < width; ++x) {
+        y[row * y_stride + x] = x + 16 * row;
+      }
+    }
+    for (int row = 0; row < chroma_height; ++row) {
+      for (int x = 0; x < chroma_width; ++x) {
+        u[row * uv_stride + x * uv_pixel_stride] = 100 + x + 8 * row;
+        v[row * uv_stride + x * uv_pixel_stride] = 200 - x - 8 * row;
+      }
+    }
+    image_ = { y, u, v, width, height, y_stride, uv_stride, uv_pixel_stride,
+        true };
+  }
+
+  const YuvImage& image() const {
+    return image_;
+  }
+
+ private:
+  std::vector<uint8_t> pixels_;
+  YuvImage image_;
+};
+
+static void ExpectSamePixels(const YuvImage &a, const YuvImage &b) {
+  ASSERT_EQ(a.width, b.width);
+  ASSERT_EQ(a.height, b.height);
+  EXPECT_EQ(a.bt709, b.bt709);
+  for (int y = 0; y < a.height; ++y) {
+    for (int x = 0; x < a.width; ++x) {
+      EXPECT_EQ(a.y[y * a.y_stride + x], b.y[y * b.y_stride + x])
+          << x << "," << y;
+      const int ua = (y / 2) * a.uv_stride + (x / 2) * a.uv_pixel_stride;
+      const int ub = (y / 2) * b.uv_stride + (x / 2) * b.uv_pixel_stride;
+      EXPECT_EQ(a.u[ua], b.u[ub]) << x << "," << y;
+      EXPECT_EQ(a.v[ua], b.v[ub]) << x << "," << y;
+    }
+  }
+}
+
+TEST(CascadeInferencerBinTest, CopiesNv12AsI420) {
+  Frame frame(12, 8, true);
+  std::vector<uint8_t> pixels;
+  const auto copy = CascadeInferencerBin::CopyYuvImage(frame.image(),
+                                                       &pixels);
+  EXPECT_EQ(pixels.size(), 12u * 8 + 2 * 6 * 4);
+  EXPECT_EQ(copy.y_stride, 12);
+  EXPECT_EQ(copy.uv_stride, 6);
+  EXPECT_EQ(copy.uv_pixel_stride, 1);
+  ExpectSamePixels(frame.image(), copy);
+}
+
+TEST(CascadeInferencerBinTest, CopiesCropsOfOddSize) {
+  Frame frame(15, 11, false);
+  const auto crop = CropYuvImage(frame.image(), 4, 2, 9, 7);
+  std::vector<uint8_t> pixels;
+  const auto copy = CascadeInferencerBin::CopyYuvImage(crop, &pixels);
+  EXPECT_EQ(copy.width, 9);
+  EXPECT_EQ(copy.height, 7);
+  EXPECT_EQ(pixels.size(), 9u * 7 + 2 * 5 * 4);
+  ExpectSamePixels(crop, copy);
+}
+
+TEST(CascadeInferencerBinTest, CopyOutlivesTheFrame) {
+  std::vector<uint8_t> pixels;
+  YuvImage copy;
+  {
+    Frame frame(8, 6, true);
+    copy = CascadeInferencerBin::CopyYuvImage(
+        CropYuvImage(frame.image(), 2, 2, 4, 4), &pixels);
+  }
+  // Moving the pixels, as a Region is moved, keeps the copy valid.
+  std::vector<uint8_t> moved = std::move(pixels);
+  EXPECT_EQ(copy.y, moved.data());
+  EXPECT_EQ(copy.y[0], 2 + 16 * 2);
+  EXPECT_EQ(copy.y[copy.y_stride + 3], 5 + 16 * 3);
+  EXPECT_EQ(copy.u[0], 100 + 1 + 8 * 1);
+  EXPECT_EQ(copy.v[copy.uv_stride + 1], 200 - 2 - 8 * 2);
+}
+
+} /* namespace szd */
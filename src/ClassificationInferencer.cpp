@@ -24,35 +24,40 @@
 #include <string>
 #include <vector>
 
-#include "coral/classification/adapter.h"
-
 #include "ClassificationInferencer.h"
 
 namespace szd {
 
 void ClassificationInferencer::InterpretFrame(
     const uint8_t *pixels, size_t pixel_length, size_t width, size_t height,
-    size_t stride, std::shared_ptr<void> &return_data) {
-  auto result = GetClassificationResults(pixels, pixel_length);
-  return_data = std::static_pointer_cast<void>(result);
+    size_t stride, InferenceResult &result) {
+  result.Clear();
+  result.dropped = !GetClassificationResults(pixels, pixel_length,
+                                             &result.classifications);
 }
 
-std::shared_ptr<std::vector<ClassificationResult>> ClassificationInferencer::GetClassificationResults(
-    const uint8_t *input_data, const int input_size) {
-  auto output_data = std::make_shared<std::vector<ClassificationResult>>();
+bool ClassificationInferencer::GetClassificationResults(
+    const uint8_t *input_data, const int input_size,
+    std::vector<ClassificationResult> *results) {
+  results->clear();
 
   uint8_t *input = interpreter_->typed_input_tensor<uint8_t>(0);
-  std::memcpy(input, input_data, input_size);
-
-  CHECK_EQ(interpreter_->Invoke(), kTfLiteOk) << error_reporter_.message();
-
-  auto results = coral::GetClassificationResults(*interpreter_, threshold_, 1);
-
-  if (!results.empty())
-    output_data->push_back( { labels_.at(results[0].id), results[0].score });
-
-  return output_data;
-
+  if (input != input_data) {
+    std::memcpy(input, input_data, input_size);
+  }
+
+  if (!Invoke()) {
+    return false;
+  }
+
+  auto start_ns = Tracer::Now();
+  const size_t n = top_k_(*interpreter_->output_tensor(0), threshold_,
+                          top_.size(), top_.data());
+  for (size_t i = 0; i < n; ++i) {
+    results->push_back( { labels_.at(top_[i].id), top_[i].score });
+  }
+  decode_latency_->ObserveNs(Tracer::Now() - start_ns);
+  return true;
 }
 
 ClassificationInferencer::ClassificationInferencer(
@@ -62,6 +67,7 @@ ClassificationInferencer::ClassificationInferencer(
     InferencerBase(1),
     threshold_(threshold) {
   Initialize(model_path, label_path, "");
+  SetupOutputDecoding(model_path);
 }
 
 ClassificationInferencer::ClassificationInferencer(
@@ -71,6 +77,15 @@ ClassificationInferencer::ClassificationInferencer(
     InferencerBase(other),
     threshold_(threshold) {
   Initialize(model_path, label_path, "");
+  SetupOutputDecoding(model_path);
+}
+
+void ClassificationInferencer::SetupOutputDecoding(
+    const std::string &model_path) {
+  std::string decoder;
+  top_k_ = SelectTopKDecoder(*interpreter_->output_tensor(0), &decoder);
+  top_.resize(kTopK);
+  SetOutputDecoder(model_path, decoder);
 }
 
 ClassificationInferencer::~ClassificationInferencer() {
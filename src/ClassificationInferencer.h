@@ -24,12 +24,9 @@
 #define SRC_CLASSIFICATIONINFERENCER_H_
 
 #include "InferencerBase.h"
+#include "OutputDecoders.h"
 
 namespace szd {
-struct ClassificationResult {
-  std::string candidate;
-  float score;
-};
 
 class ClassificationInferencer : public szd::InferencerBase {
  public:
@@ -45,17 +42,26 @@ class ClassificationInferencer : public szd::InferencerBase {
   ClassificationInferencer& operator=(ClassificationInferencer &&other) = delete;
   virtual ~ClassificationInferencer();
 
-  std::shared_ptr<std::vector<ClassificationResult>> GetClassificationResults(
-      const uint8_t *input_data, const int input_size);
+  // Returns false if the TPU scheduler dropped the frame.
+  bool GetClassificationResults(const uint8_t *input_data,
+                                const int input_size,
+                                std::vector<ClassificationResult> *results);
   void InterpretFrame(const uint8_t *pixels, size_t pixel_length, size_t width,
                       size_t height, size_t stride,
-                      std::shared_ptr<void> &return_data) override;
+                      InferenceResult &result) override;
   virtual InferencerType GetInferencerType() override {
     return kClassification;
   }
 
  private:
+  // Classes reported per frame.
+  static const size_t kTopK = 1;
+
+  void SetupOutputDecoding(const std::string &model_path);
+
   const float threshold_;
+  TopKDecoder top_k_ = nullptr;
+  std::vector<ClassScore> top_;
 };
 
 } /* namespace szd */
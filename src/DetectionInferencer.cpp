@@ -20,73 +20,329 @@
  *      Author: pnordstrom
  */
 
+#include <algorithm>
+#include <map>
 #include <memory>
+#include <numeric>
 
+#include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
+#include "tensorflow/lite/builtin_ops.h"
 
 #include "DetectionInferencer.h"
+#include "OutputDecoders.h"
 
 namespace szd {
 
+OverlapSuppressor::OverlapSuppressor(float iou_threshold)
+    :
+    iou_threshold_(iou_threshold) {
+}
+
+OverlapSuppressor::~OverlapSuppressor() {
+}
+
+int OverlapSuppressor::ClassId(const std::string &label) {
+  // A frame has results of a handful of classes at most.
+  for (size_t id = 0; id < labels_.size(); ++id) {
+    if (*labels_[id] == label) {
+      return id;
+    }
+  }
+  labels_.push_back(&label);
+  return labels_.size() - 1;
+}
+
+void OverlapSuppressor::Run(std::vector<DetectionResult> *results) {
+  TraceSpan span("suppress_overlaps");
+  auto &input = *results;
+  const size_t n = input.size();
+  order_.resize(n);
+  std::iota(order_.begin(), order_.end(), 0);
+  std::sort(order_.begin(), order_.end(), [&input](size_t a, size_t b) {
+    return input[a].score > input[b].score;
+  });
+
+  x1_.resize(n);
+  y1_.resize(n);
+  x2_.resize(n);
+  y2_.resize(n);
+  area_.resize(n);
+  classes_.resize(n);
+  keep_.assign(n, 1);
+  labels_.clear();
+  for (size_t i = 0; i < n; ++i) {
+    const auto &result = input[order_[i]];
+    x1_[i] = result.x1;
+    y1_[i] = result.y1;
+    x2_[i] = result.x2;
+    y2_[i] = result.y2;
+    area_[i] = (result.x2 - result.x1) * (result.y2 - result.y1);
+    classes_[i] = ClassId(result.candidate);
+  }
+
+  kept_.clear();
+  for (size_t i = 0; i < n; ++i) {
+    if (!keep_[i]) {
+      continue;
+    }
+    kept_.push_back(std::move(input[order_[i]]));
+    for (size_t j = i + 1; j < n; ++j) {
+      const float width = std::max(
+          0.0f, std::min(x2_[i], x2_[j]) - std::max(x1_[i], x1_[j]));
+      const float height = std::max(
+          0.0f, std::min(y2_[i], y2_[j]) - std::max(y1_[i], y1_[j]));
+      const float intersection = width * height;
+      const bool overlaps = intersection
+          > iou_threshold_ * (area_[i] + area_[j] - intersection);
+      keep_[j] &= !(overlaps && classes_[i] == classes_[j]);
+    }
+  }
+  // The old results keep their capacity for the next call.
+  results->swap(kept_);
+}
+
 void DetectionInferencer::InterpretFrame(const uint8_t *pixels,
                                          size_t pixel_length, size_t width,
                                          size_t height, size_t stride,
-                                         std::shared_ptr<void> &return_data) {
-  auto results = GetDetectionResults(pixels, pixel_length);
-  return_data = std::static_pointer_cast<void>(results);
+                                         InferenceResult &result) {
+  result.Clear();
+  result.dropped = !GetDetectionResults(pixels, pixel_length,
+                                        &result.detections);
 }
 
-std::shared_ptr<std::vector<DetectionResult>> DetectionInferencer::GetDetectionResults(
-    const uint8_t *input_data, const int input_size) {
-  std::vector<std::vector<float>> output_data;
-
+bool DetectionInferencer::GetDetectionResults(
+    const uint8_t *input_data, const int input_size,
+    std::vector<DetectionResult> *results) {
   uint8_t *input = interpreter_->typed_input_tensor<uint8_t>(0);
-  std::memcpy(input, input_data, input_size);
-
-  CHECK_EQ(interpreter_->Invoke(), kTfLiteOk) << error_reporter_.message();
-
-  const auto &output_indices = interpreter_->outputs();
-  const size_t num_outputs = output_indices.size();
-  output_data.resize(num_outputs);
-  for (size_t i = 0; i < num_outputs; ++i) {
-    const auto *out_tensor = interpreter_->tensor(output_indices[i]);
-    CHECK_NOTNULL(out_tensor);
-    if (out_tensor->type == kTfLiteFloat32) {  // detection model out is Float32
-      const float *output = interpreter_->typed_output_tensor<float>(i);
-      const size_t size_of_output_tensor_i = output_shape_[i];
-
-      output_data[i].resize(size_of_output_tensor_i);
-      for (size_t j = 0; j < size_of_output_tensor_i; ++j) {
-        output_data[i][j] = output[j];
-      }
-    }
+  if (input != input_data) {
+    std::memcpy(input, input_data, input_size);
+  }
+
+  if (!Invoke()) {
+    return false;
   }
-  return std::make_shared<std::vector<DetectionResult>>(
-      ParseOutputs(output_data));
+
+  if (raw_decoder_) {
+    DecodeRawOutputs(interpreter_->output_tensor(raw_boxes_index_)->data.raw,
+                     interpreter_->output_tensor(raw_scores_index_)->data.raw,
+                     results);
+  } else {
+    // Parsed where the interpreter left them, detection model out is Float32.
+    ParseOutputs(interpreter_->typed_output_tensor<float>(0),
+                 interpreter_->typed_output_tensor<float>(1),
+                 interpreter_->typed_output_tensor<float>(2),
+                 interpreter_->typed_output_tensor<float>(3), results);
+  }
+  return true;
 }
 
-std::vector<DetectionResult> DetectionInferencer::ParseOutputs(
-    const std::vector<std::vector<float>> &raw_output) {
-  std::vector<DetectionResult> results;
-  int n = lround(raw_output[3][0]);
+void DetectionInferencer::ParseOutputs(const float *boxes,
+                                       const float *classes,
+                                       const float *scores,
+                                       const float *count,
+                                       std::vector<DetectionResult> *results) {
+  TraceSpan span("parse_outputs");
+  auto start_ns = Tracer::Now();
+  results->clear();
+  int n = lround(count[0]);
   for (int i = 0; i < n; i++) {
-    int id = lround(raw_output[1][i]);
-    if (id == detection_object_ || detection_object_ < 0) {
-      float score = raw_output[2][i];
-      if (score > threshold_
-          && (detection_object_ < 0 || detection_object_ == id)) {
-        DetectionResult result;
-        result.candidate = labels_.at(id);
-        result.score = score;
-        result.y1 = std::max(static_cast<float>(0.0), raw_output[0][4 * i]);
-        result.x1 = std::max(static_cast<float>(0.0), raw_output[0][4 * i + 1]);
-        result.y2 = std::min(static_cast<float>(1.0), raw_output[0][4 * i + 2]);
-        result.x2 = std::min(static_cast<float>(1.0), raw_output[0][4 * i + 3]);
-        results.push_back(result);
+    const float score = scores[i];
+    // The postprocess op sorts by score, nothing after this can pass.
+    if (score <= min_threshold_) {
+      break;
+    }
+    const int id = lround(classes[i]);
+    if (!IsClassAllowed(id) || score <= class_thresholds_[id]) {
+      continue;
+    }
+    results->emplace_back();
+    auto &result = results->back();
+    result.candidate = labels_.at(id);
+    result.score = score;
+    // Map from the model input back to the frame, this also clamps the
+    // box to the frame.
+    result.y1 = letterbox_.MapY(boxes[4 * i]);
+    result.x1 = letterbox_.MapX(boxes[4 * i + 1]);
+    result.y2 = letterbox_.MapY(boxes[4 * i + 2]);
+    result.x2 = letterbox_.MapX(boxes[4 * i + 3]);
+  }
+  decode_latency_->ObserveNs(Tracer::Now() - start_ns);
+}
+
+void DetectionInferencer::DecodeRawOutputs(
+    const void *boxes, const void *scores,
+    std::vector<DetectionResult> *results) {
+  TraceSpan span("decode_outputs");
+  auto start_ns = Tracer::Now();
+  results->clear();
+  for (const auto &detection : raw_decoder_->Decode(boxes, scores,
+                                                    single_class_)) {
+    const int id = detection.id;
+    if (!IsClassAllowed(id) || detection.score <= class_thresholds_[id]) {
+      continue;
+    }
+    results->emplace_back();
+    auto &result = results->back();
+    result.candidate = labels_.at(id);
+    result.score = detection.score;
+    result.x1 = letterbox_.MapX(detection.x1);
+    result.y1 = letterbox_.MapY(detection.y1);
+    result.x2 = letterbox_.MapX(detection.x2);
+    result.y2 = letterbox_.MapY(detection.y2);
+  }
+  decode_latency_->ObserveNs(Tracer::Now() - start_ns);
+}
+
+static TensorFormat GetTensorFormat(const TfLiteTensor &tensor) {
+  TensorFormat format;
+  switch (tensor.type) {
+    case kTfLiteFloat32:
+      format.type = TensorFormat::kFloat32;
+      return format;
+    case kTfLiteUInt8:
+      format.type = TensorFormat::kUInt8;
+      break;
+    case kTfLiteInt8:
+      format.type = TensorFormat::kInt8;
+      break;
+    default:
+      LOG(FATAL) << "Unsupported detection output type " << tensor.type;
+  }
+  format.scale = tensor.params.scale;
+  format.zero_point = tensor.params.zero_point;
+  return format;
+}
+
+// Models ending with the sigmoid output probabilities, the others logits.
+// The sigmoid is either a LOGISTIC op on the CPU or compiled into the Edge
+// TPU op, where its quantized output has the fixed scale of 1/256.
+static RawDetectionDecoder::ScoreType GetScoreType(
+    const tflite::Interpreter &interpreter, int tensor_index) {
+  for (int node_index : interpreter.execution_plan()) {
+    const auto *node_and_registration = interpreter.node_and_registration(
+        node_index);
+    const auto *outputs = node_and_registration->first.outputs;
+    for (int i = 0; i < outputs->size; ++i) {
+      if (outputs->data[i] == tensor_index) {
+        if (node_and_registration->second.builtin_code
+            == kTfLiteBuiltinLogistic) {
+          return RawDetectionDecoder::kProbabilities;
+        }
       }
     }
   }
-  return results;
+  const auto &tensor = *interpreter.tensor(tensor_index);
+  const bool sigmoid_quantization = tensor.params.scale == 1.0f / 256
+      && ((tensor.type == kTfLiteUInt8 && tensor.params.zero_point == 0)
+          || (tensor.type == kTfLiteInt8 && tensor.params.zero_point == -128));
+  return sigmoid_quantization ? RawDetectionDecoder::kProbabilities :
+      RawDetectionDecoder::kLogits;
+}
+
+void DetectionInferencer::SetClassFilter(const ClassFilter &filter) {
+  std::map<std::string, int> ids;
+  for (const auto &label : labels_) {
+    ids.emplace(label.second, label.first);
+  }
+  auto find_id = [&ids](const std::string &name) {
+    auto id = ids.find(name);
+    CHECK(id != ids.end()) << "Unknown class " << name;
+    return id->second;
+  };
+
+  const int num_ids = labels_.empty() ? 0 : labels_.rbegin()->first + 1;
+  class_thresholds_.assign(num_ids, threshold_);
+  class_bitmap_.assign((num_ids + 63) / 64, 0);
+  auto set_allowed = [this](int id, bool allowed) {
+    const uint64_t bit = uint64_t(1) << (id & 63);
+    class_bitmap_[id >> 6] = allowed ? class_bitmap_[id >> 6] | bit :
+        class_bitmap_[id >> 6] & ~bit;
+  };
+  if (!filter.allow.empty()) {
+    for (const auto &name : filter.allow) {
+      set_allowed(find_id(name), true);
+    }
+  } else if (detection_object_ >= 0) {
+    set_allowed(detection_object_, true);
+  } else {
+    for (const auto &label : labels_) {
+      set_allowed(label.first, true);
+    }
+  }
+  for (const auto &name : filter.deny) {
+    set_allowed(find_id(name), false);
+  }
+  for (const auto &threshold : filter.thresholds) {
+    class_thresholds_[find_id(threshold.first)] = threshold.second;
+  }
+
+  min_threshold_ = 1.0f;
+  single_class_ = -1;
+  int num_allowed = 0;
+  for (int id = 0; id < num_ids; ++id) {
+    if (IsClassAllowed(id)) {
+      min_threshold_ = std::min(min_threshold_, class_thresholds_[id]);
+      single_class_ = id;
+      num_allowed++;
+    }
+  }
+  if (num_allowed != 1) {
+    single_class_ = -1;
+  }
+  if (raw_decoder_) {
+    raw_decoder_->SetThreshold(min_threshold_);
+  }
+}
+
+void DetectionInferencer::SetupOutputDecoding(
+    tflite::Interpreter &interpreter, const std::string &model_path,
+    const std::string &anchors_path) {
+  SetClassFilter(ClassFilter());
+  const auto &outputs = interpreter.outputs();
+  if (outputs.size() != 2) {
+    CHECK_EQ(outputs.size(), 4)
+        << "Detection models need the postprocess op or raw box and score "
+           "outputs";
+    for (int i = 0; i < 4; ++i) {
+      CHECK_EQ(interpreter.output_tensor(i)->type, kTfLiteFloat32)
+          << "The postprocess op outputs floats";
+    }
+    SetOutputDecoder(model_path, "ssd_postprocess_float32");
+    return;
+  }
+  auto last_dim = [&interpreter](int index) {
+    const auto *dims = interpreter.output_tensor(index)->dims;
+    return dims->data[dims->size - 1];
+  };
+  if (last_dim(0) != 4 && last_dim(1) == 4) {
+    raw_boxes_index_ = 1;
+    raw_scores_index_ = 0;
+  }
+  const auto &boxes = *interpreter.output_tensor(raw_boxes_index_);
+  const auto &scores = *interpreter.output_tensor(raw_scores_index_);
+  raw_decoder_ = std::make_unique<RawDetectionDecoder>(
+      anchors_path, last_dim(raw_scores_index_), GetTensorFormat(boxes),
+      GetTensorFormat(scores),
+      GetScoreType(interpreter, outputs[raw_scores_index_]), min_threshold_);
+  CHECK_EQ(raw_decoder_->GetNumAnchors() * 4,
+           boxes.bytes / (boxes.type == kTfLiteFloat32 ? sizeof(float) : 1))
+      << "Anchors in " << anchors_path << " don't match the model";
+  SetOutputDecoder(model_path,
+                   absl::StrCat("ssd_raw_", GetTypeName(scores.type)));
+}
+
+// Raw output models read their anchors from models/name_anchors.csv next to
+// models/name.tflite.
+static std::string GetAnchorsPath(const std::string &model_path) {
+  const std::string extension = ".tflite";
+  auto base = model_path;
+  if (base.size() > extension.size()
+      && base.compare(base.size() - extension.size(), extension.size(),
+                      extension) == 0) {
+    base.resize(base.size() - extension.size());
+  }
+  return absl::StrCat(base, "_anchors.csv");
 }
 
 DetectionInferencer::DetectionInferencer(const std::string &model_path,
@@ -97,6 +353,7 @@ DetectionInferencer::DetectionInferencer(const std::string &model_path,
     InferencerBase(1),
     threshold_(threshold) {
   Initialize(model_path, label_path, detection_object);
+  SetupOutputDecoding(*interpreter_, model_path, GetAnchorsPath(model_path));
 }
 
 DetectionInferencer::DetectionInferencer(const std::string &model_path,
@@ -108,6 +365,7 @@ DetectionInferencer::DetectionInferencer(const std::string &model_path,
     InferencerBase(other),
     threshold_(threshold) {
   Initialize(model_path, label_path, detection_object);
+  SetupOutputDecoding(*interpreter_, model_path, GetAnchorsPath(model_path));
 }
 
 DetectionInferencer::DetectionInferencer(const float threshold,
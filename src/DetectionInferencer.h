@@ -23,15 +23,51 @@
 #ifndef DETECTIONINFERENCER_H_
 #define DETECTIONINFERENCER_H_
 
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
 #include "absl/strings/substitute.h"
 
 #include "DetectionInferencer.h"
 #include "InferencerBase.h"
+#include "RawDetectionDecoder.h"
 
 namespace szd {
-struct DetectionResult {
-  std::string candidate;
-  float score, x1, y1, x2, y2;
+
+// Keeps the highest scoring of each group of overlapping results of the same
+// class. Two results overlap when their intersection over union is above
+// iou_threshold, so a small object next to or inside a larger one of its
+// class survives. The buffers are kept between calls, so steady state calls
+// don't allocate. Not thread safe, keep one per stream.
+class OverlapSuppressor {
+ public:
+  explicit OverlapSuppressor(float iou_threshold);
+  OverlapSuppressor() = delete;
+  OverlapSuppressor(const OverlapSuppressor &other) = delete;
+  OverlapSuppressor(OverlapSuppressor &&other) = delete;
+  OverlapSuppressor& operator=(const OverlapSuppressor &other) = delete;
+  OverlapSuppressor& operator=(OverlapSuppressor &&other) = delete;
+  virtual ~OverlapSuppressor();
+
+  // Replaces results with the ones kept, highest score first.
+  void Run(std::vector<DetectionResult> *results);
+
+ private:
+  // Numbers the labels in the order they are first seen by this call.
+  int ClassId(const std::string &label);
+
+  const float iou_threshold_;
+  std::vector<size_t> order_;
+  // Kept as separate arrays in score order so the inner loop of Run() is
+  // branch free and the compiler can vectorize it.
+  std::vector<float> x1_, y1_, x2_, y2_, area_;
+  std::vector<int> classes_;
+  std::vector<uint8_t> keep_;
+  // Point into the results of the current call.
+  std::vector<const std::string*> labels_;
+  std::vector<DetectionResult> kept_;
 };
 
 class DetectionInferencer : public InferencerBase {
@@ -52,24 +88,63 @@ class DetectionInferencer : public InferencerBase {
 
   void InterpretFrame(const uint8_t *pixels, size_t pixel_length, size_t width,
                       size_t height, size_t stride,
-                      std::shared_ptr<void> &return_data) override;
+                      InferenceResult &result) override;
   virtual InferencerType GetInferencerType() override {
     return kDetection;
   }
 
+  // Which classes are reported, by label. Classes without a threshold of
+  // their own use the threshold of the inferencer.
+  struct ClassFilter {
+    std::map<std::string, float> thresholds;
+    // Only these classes, or the detection object if empty.
+    std::set<std::string> allow;
+    std::set<std::string> deny;
+  };
+  // Compiles filter into the lookup tables the outputs are checked against
+  // before any result is built. Must be set before the pipeline starts.
+  void SetClassFilter(const ClassFilter &filter);
+
  protected:
   // This constructor is needed by the PipelinedInferencer so is declared protected
   DetectionInferencer(const float threshold,
                       const std::string &detection_object,
                       const InferencerBase &other);
 
-  std::vector<DetectionResult> ParseOutputs(
-      const std::vector<std::vector<float>> &raw_output);
+  // Reads the four outputs of the postprocess op into results.
+  void ParseOutputs(const float *boxes, const float *classes,
+                    const float *scores, const float *count,
+                    std::vector<DetectionResult> *results);
+  // Models exported without the postprocess op output raw box encodings and
+  // class scores, which are then decoded on the CPU against the anchors in
+  // anchors_path, see RawDetectionDecoder. interpreter is the one producing
+  // the final outputs.
+  void SetupOutputDecoding(tflite::Interpreter &interpreter,
+                           const std::string &model_path,
+                           const std::string &anchors_path);
+  void DecodeRawOutputs(const void *boxes, const void *scores,
+                        std::vector<DetectionResult> *results);
+
+  std::unique_ptr<RawDetectionDecoder> raw_decoder_;
+  int raw_boxes_index_ = 0;
+  int raw_scores_index_ = 1;
 
  private:
+  bool IsClassAllowed(int id) const {
+    return id >= 0 && static_cast<size_t>(id) < class_thresholds_.size()
+        && (class_bitmap_[id >> 6] >> (id & 63)) & 1;
+  }
+
   const float threshold_;
-  std::shared_ptr<std::vector<DetectionResult>> GetDetectionResults(
-      const uint8_t *input_data, const int input_size);
+  // Compiled from the ClassFilter, indexed by class id.
+  std::vector<uint64_t> class_bitmap_;
+  std::vector<float> class_thresholds_;
+  float min_threshold_ = 1.0f;
+  // The only allowed class, or -1.
+  int single_class_ = -1;
+  // Returns false if the TPU scheduler dropped the frame.
+  bool GetDetectionResults(const uint8_t *input_data, const int input_size,
+                           std::vector<DetectionResult> *results);
 
 };
 
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * DeviceProvider.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <memory>
+#include <vector>
+
+#include "DeviceProvider.h"
+
+namespace szd {
+std::shared_ptr<DeviceProvider> DeviceProvider::provider_;
+
+DeviceProvider& DeviceProvider::Get() {
+  if (!provider_) {
+    provider_ = std::make_shared<EdgeTpuDeviceProvider>();
+  }
+  return *provider_;
+}
+
+void DeviceProvider::Set(std::shared_ptr<DeviceProvider> provider) {
+  provider_ = provider;
+}
+
+DeviceProvider::~DeviceProvider() {
+}
+
+std::vector<edgetpu::EdgeTpuManager::DeviceEnumerationRecord> EdgeTpuDeviceProvider::EnumerateDevices() {
+  return edgetpu::EdgeTpuManager::GetSingleton()->EnumerateEdgeTpu();
+}
+
+std::shared_ptr<edgetpu::EdgeTpuContext> EdgeTpuDeviceProvider::OpenDevice(
+    const edgetpu::EdgeTpuManager::DeviceEnumerationRecord &record) {
+  return edgetpu::EdgeTpuManager::GetSingleton()->OpenDevice(record.type,
+                                                             record.path);
+}
+
+TfLiteRegistration* EdgeTpuDeviceProvider::GetCustomOp() {
+  return edgetpu::RegisterCustomOp();
+}
+
+} /* namespace szd */
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * DeviceProvider.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_DEVICEPROVIDER_H_
+#define SRC_DEVICEPROVIDER_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/lite/c/common.h"
+#include "tflite/public/edgetpu.h"
+
+namespace szd {
+
+// Where the inferencers get their Edge TPUs from. The default provider uses
+// the EdgeTpuManager, MockDeviceProvider simulates the devices so the demo
+// can run without them.
+class DeviceProvider {
+ public:
+  DeviceProvider() = default;
+  DeviceProvider(const DeviceProvider &other) = delete;
+  DeviceProvider(DeviceProvider &&other) = delete;
+  DeviceProvider& operator=(const DeviceProvider &other) = delete;
+  DeviceProvider& operator=(DeviceProvider &&other) = delete;
+  virtual ~DeviceProvider();
+
+  virtual std::vector<edgetpu::EdgeTpuManager::DeviceEnumerationRecord> EnumerateDevices() = 0;
+  virtual std::shared_ptr<edgetpu::EdgeTpuContext> OpenDevice(
+      const edgetpu::EdgeTpuManager::DeviceEnumerationRecord &record) = 0;
+  // The implementation of edgetpu::kCustomOp for interpreters running on
+  // these devices.
+  virtual TfLiteRegistration* GetCustomOp() = 0;
+
+  // Returns the provider set with Set(), or the EdgeTpuManager one.
+  static DeviceProvider& Get();
+  // Must be called before any inferencer is created.
+  static void Set(std::shared_ptr<DeviceProvider> provider);
+
+ private:
+  static std::shared_ptr<DeviceProvider> provider_;
+};
+
+class EdgeTpuDeviceProvider : public DeviceProvider {
+ public:
+  std::vector<edgetpu::EdgeTpuManager::DeviceEnumerationRecord> EnumerateDevices() override;
+  std::shared_ptr<edgetpu::EdgeTpuContext> OpenDevice(
+      const edgetpu::EdgeTpuManager::DeviceEnumerationRecord &record) override;
+  TfLiteRegistration* GetCustomOp() override;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_DEVICEPROVIDER_H_ */
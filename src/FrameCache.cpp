@@ -0,0 +1,177 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * FrameCache.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "absl/strings/substitute.h"
+#include "FrameCache.h"
+
+namespace szd {
+  const std::string kFrameCacheDecodeSrc =
+      "filesrc location=\"$0\" ! decodebin ! videoconvert ! "
+          "video/x-raw,format=I420 ! appsink name=sink sync=false";
+
+bool FrameCache::Load() {
+  GError *error = nullptr;
+  auto pipeline_src = absl::Substitute(kFrameCacheDecodeSrc, video_file_);
+  auto pipeline = gst_parse_launch(pipeline_src.c_str(), &error);
+  if (!pipeline) {
+    g_printerr("Failed to decode %s: %s\n", video_file_.c_str(),
+               error->message);
+    g_clear_error(&error);
+    return false;
+  }
+  auto sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+  auto bus = gst_element_get_bus(pipeline);
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+
+  size_t capacity = 0;
+  bool size_limited = false;
+  GstClockTime stalled = 0;
+  while (true) {
+    // A decoding error only shows on the bus, pull-sample would wait for a
+    // sample that never comes.
+    GstSample *sample = nullptr;
+    g_signal_emit_by_name(sink, "try-pull-sample", kPullTimeout, &sample);
+    if (!sample) {
+      auto msg = gst_bus_pop_filtered(
+          bus, static_cast<GstMessageType>(GST_MESSAGE_ERROR
+              | GST_MESSAGE_EOS));
+      if (msg) {
+        if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+          GError *decode_error = nullptr;
+          gst_message_parse_error(msg, &decode_error, nullptr);
+          g_printerr("Failed to decode %s: %s\n", video_file_.c_str(),
+                     decode_error->message);
+          g_clear_error(&decode_error);
+        }
+        gst_message_unref(msg);
+        break;
+      }
+      stalled += kPullTimeout;
+      if (stalled >= kStallTimeout) {
+        g_printerr("Decoding %s stalled\n", video_file_.c_str());
+        break;
+      }
+      continue;
+    }
+    stalled = 0;
+    auto buffer = gst_sample_get_buffer(sample);
+    if (!frames_) {
+      GstVideoInfo info;
+      caps_ = gst_caps_ref(gst_sample_get_caps(sample));
+      if (!gst_video_info_from_caps(&info, caps_)) {
+        gst_sample_unref(sample);
+        break;
+      }
+      frame_size_ = GST_VIDEO_INFO_SIZE(&info);
+      if (GST_VIDEO_INFO_FPS_N(&info) > 0) {
+        frame_duration_ = gst_util_uint64_scale_int(
+            GST_SECOND, GST_VIDEO_INFO_FPS_D(&info), GST_VIDEO_INFO_FPS_N(&info));
+      }
+
+      // Size the mapping from the clip duration when it is known.
+      capacity = max_bytes_ / frame_size_;
+      size_limited = true;
+      gint64 duration;
+      if (gst_element_query_duration(pipeline, GST_FORMAT_TIME, &duration)
+          && duration > 0
+          && static_cast<size_t>(duration / frame_duration_ + 2) <= capacity) {
+        capacity = duration / frame_duration_ + 2;
+        size_limited = false;
+      }
+      mapped_bytes_ = std::max<size_t>(capacity, 1) * frame_size_;
+      void *frames = mmap(nullptr, mapped_bytes_, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (frames == MAP_FAILED) {
+        mapped_bytes_ = 0;
+        gst_sample_unref(sample);
+        break;
+      }
+      frames_ = static_cast<uint8_t*>(frames);
+    }
+    if (num_frames_ < capacity) {
+      gst_buffer_extract(buffer, 0, frames_ + num_frames_ * frame_size_,
+                         frame_size_);
+      num_frames_++;
+    }
+    gst_sample_unref(sample);
+    if (num_frames_ == capacity) {
+      if (size_limited) {
+        g_printerr("Caching only the first %zu frames of %s, the clip is "
+                   "larger than %zu bytes\n", num_frames_,
+                   video_file_.c_str(), max_bytes_);
+      }
+      break;
+    }
+  }
+
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(bus);
+  gst_object_unref(sink);
+  gst_object_unref(pipeline);
+
+  if (frames_) {
+    // The frames are only read from now on.
+    mprotect(frames_, mapped_bytes_, PROT_READ);
+  }
+  return num_frames_ > 0;
+}
+
+GstBuffer* FrameCache::MakeBuffer(uint64_t frame_no) {
+  auto *frame = frames_ + (frame_no % num_frames_) * frame_size_;
+  // Buffers can outlive the SourceBin downstream, each one keeps the frames
+  // mapped until it is freed.
+  auto buffer = gst_buffer_new_wrapped_full(
+      GST_MEMORY_FLAG_READONLY, frame, frame_size_, 0, frame_size_,
+      new std::shared_ptr<FrameCache>(shared_from_this()),
+      [](gpointer data) {
+        delete static_cast<std::shared_ptr<FrameCache>*>(data);
+      });
+  GST_BUFFER_PTS(buffer) = frame_no * frame_duration_;
+  GST_BUFFER_DURATION(buffer) = frame_duration_;
+  return buffer;
+}
+
+FrameCache::FrameCache(const std::string &video_file, size_t max_bytes)
+    :
+    video_file_(video_file),
+    max_bytes_(max_bytes) {
+}
+
+FrameCache::~FrameCache() {
+  if (frames_) {
+    munmap(frames_, mapped_bytes_);
+  }
+  if (caps_) {
+    gst_caps_unref(caps_);
+  }
+}
+
+} /* namespace szd */
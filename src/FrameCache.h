@@ -0,0 +1,79 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * FrameCache.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_FRAMECACHE_H_
+#define SRC_FRAMECACHE_H_
+
+#include <memory>
+#include <string>
+
+#include <gst/gst.h>
+
+namespace szd {
+
+// Holds every decoded frame of a video clip in one memory mapped region so
+// the clip can be replayed in a loop without decoding or seeking. Frames are
+// stored as I420. Must be owned by a std::shared_ptr, the buffers it makes
+// share the ownership.
+class FrameCache : public std::enable_shared_from_this<FrameCache> {
+ public:
+  FrameCache(const std::string &video_file, size_t max_bytes);
+  FrameCache() = delete;
+  FrameCache(const FrameCache &other) = delete;
+  FrameCache(FrameCache &&other) = delete;
+  FrameCache& operator=(const FrameCache &other) = delete;
+  FrameCache& operator=(FrameCache &&other) = delete;
+  virtual ~FrameCache();
+
+  // Decodes the clip, blocking until done or until decoding fails or stalls.
+  // Clips larger than max_bytes are truncated with a warning. Returns false
+  // if nothing could be decoded.
+  bool Load();
+  // Returns a buffer wrapping cached frame frame_no modulo the number of
+  // frames, timestamped as if the clip had been played frame_no frames in.
+  GstBuffer* MakeBuffer(uint64_t frame_no);
+  GstCaps* GetCaps() {
+    return caps_;
+  }
+  size_t GetNumFrames() {
+    return num_frames_;
+  }
+
+ private:
+  static const GstClockTime kDefaultFrameDuration = GST_SECOND / 30;
+  // How often the bus is checked for errors while waiting for a frame.
+  static const GstClockTime kPullTimeout = GST_SECOND / 10;
+  // Gives up when no frame was decoded for this long.
+  static const GstClockTime kStallTimeout = 10 * GST_SECOND;
+
+  std::string video_file_;
+  size_t max_bytes_;
+  uint8_t *frames_ = nullptr;
+  size_t mapped_bytes_ = 0;
+  size_t frame_size_ = 0;
+  size_t num_frames_ = 0;
+  GstClockTime frame_duration_ = kDefaultFrameDuration;
+  GstCaps *caps_ = nullptr;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_FRAMECACHE_H_ */
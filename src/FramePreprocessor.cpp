@@ -0,0 +1,353 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * FramePreprocessor.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "FramePreprocessor.h"
+
+namespace szd {
+// Bilinear weights have 8 fractional bits.
+static const int kWeightBits = 8;
+static const int kWeightOne = 1 << kWeightBits;
+
+// Finds the two source samples and the weight of the second one for output
+// position i when src_size samples are scaled to dst_size.
+static void SamplePosition(int i, int src_size, int dst_size, int *p0, int *p1,
+                           int *frac) {
+  float s = (i + 0.5f) * src_size / dst_size - 0.5f;
+  if (s < 0.0f) {
+    s = 0.0f;
+  }
+  int p = static_cast<int>(s);
+  *p0 = std::min(p, src_size - 1);
+  *p1 = std::min(p + 1, src_size - 1);
+  *frac = static_cast<int>((s - p) * kWeightOne);
+}
+
+// Blends n samples of two rows, 8 fractional bits in the result.
+static void LerpRows(const uint8_t *row0, const uint8_t *row1, int frac,
+                     int n, uint16_t *out) {
+  const uint16_t w0 = kWeightOne - frac;
+  const uint16_t w1 = frac;
+  int i = 0;
+#if defined(__ARM_NEON)
+  for (; i + 8 <= n; i += 8) {
+    const uint16x8_t a = vmovl_u8(vld1_u8(row0 + i));
+    const uint16x8_t b = vmovl_u8(vld1_u8(row1 + i));
+    vst1q_u16(out + i, vmlaq_n_u16(vmulq_n_u16(a, w0), b, w1));
+  }
+#elif defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i weight0 = _mm_set1_epi16(w0);
+  const __m128i weight1 = _mm_set1_epi16(w1);
+  for (; i + 16 <= n; i += 16) {
+    const __m128i a = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(row0 + i));
+    const __m128i b = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(row1 + i));
+    // The sum is at most 255 << 8, the low halves of the products are exact.
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(out + i),
+        _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), weight0),
+                      _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), weight1)));
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(out + i + 8),
+        _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), weight0),
+                      _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), weight1)));
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i] = row0[i] * w0 + row1[i] * w1;
+  }
+}
+
+static inline uint8_t Clamp(int v) {
+  return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// Fixed point YUV to RGB coefficients with 8 fractional bits, limited range.
+struct ColorMatrix {
+  explicit ColorMatrix(bool bt709)
+      :
+      crv(bt709 ? 459 : 409),
+      cgu(bt709 ? 55 : 100),
+      cgv(bt709 ? 136 : 208),
+      cbu(bt709 ? 541 : 516) {
+  }
+  static const int cy = 298;
+  const int crv;
+  const int cgu;
+  const int cgv;
+  const int cbu;
+};
+
+#if defined(__SSE2__) && !defined(__ARM_NEON)
+// Two 16 bit lanes, for _mm_madd_epi16 to multiply pairs of samples by.
+static inline __m128i Pair(int low, int high) {
+  return _mm_set1_epi32(
+      static_cast<int>(static_cast<uint32_t>(static_cast<uint16_t>(high)) << 16
+          | static_cast<uint16_t>(low)));
+}
+#endif
+
+// Converts n pixels of separate Y, U and V rows to packed RGB.
+static void ConvertRow(const uint8_t *luma, const uint8_t *u,
+                       const uint8_t *v, int n, const ColorMatrix &m,
+                       uint8_t *out) {
+  int x = 0;
+#if defined(__ARM_NEON)
+  const int32x4_t round = vdupq_n_s32(128);
+  for (; x + 8 <= n; x += 8) {
+    const int16x8_t y16 = vsubq_s16(
+        vreinterpretq_s16_u16(vmovl_u8(vld1_u8(luma + x))), vdupq_n_s16(16));
+    const int16x8_t d = vsubq_s16(
+        vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + x))), vdupq_n_s16(128));
+    const int16x8_t e = vsubq_s16(
+        vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + x))), vdupq_n_s16(128));
+    const int32x4_t c_lo = vmlal_n_s16(round, vget_low_s16(y16), m.cy);
+    const int32x4_t c_hi = vmlal_n_s16(round, vget_high_s16(y16), m.cy);
+    // Shifted and clamped to 0 to 255 as Clamp does.
+    auto narrow = [](int32x4_t lo, int32x4_t hi) {
+      return vqmovn_u16(vcombine_u16(vqshrun_n_s32(lo, 8),
+                                     vqshrun_n_s32(hi, 8)));
+    };
+    uint8x8x3_t rgb;
+    rgb.val[0] = narrow(vmlal_n_s16(c_lo, vget_low_s16(e), m.crv),
+                        vmlal_n_s16(c_hi, vget_high_s16(e), m.crv));
+    rgb.val[1] = narrow(
+        vmlsl_n_s16(vmlsl_n_s16(c_lo, vget_low_s16(d), m.cgu),
+                    vget_low_s16(e), m.cgv),
+        vmlsl_n_s16(vmlsl_n_s16(c_hi, vget_high_s16(d), m.cgu),
+                    vget_high_s16(e), m.cgv));
+    rgb.val[2] = narrow(vmlal_n_s16(c_lo, vget_low_s16(d), m.cbu),
+                        vmlal_n_s16(c_hi, vget_high_s16(d), m.cbu));
+    vst3_u8(out + 3 * x, rgb);
+  }
+#elif defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi16(1);
+  const __m128i r_weights = Pair(m.cy, m.crv);
+  const __m128i g_weights = Pair(m.cy, -m.cgu);
+  const __m128i g_v_weights = Pair(-m.cgv, 128);
+  const __m128i b_weights = Pair(m.cy, m.cbu);
+  const __m128i round = _mm_set1_epi32(128);
+  for (; x + 8 <= n; x += 8) {
+    auto load = [zero](const uint8_t *row, int offset) {
+      return _mm_sub_epi16(
+          _mm_unpacklo_epi8(
+              _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row)), zero),
+          _mm_set1_epi16(offset));
+    };
+    const __m128i y16 = load(luma + x, 16);
+    const __m128i d = load(u + x, 128);
+    const __m128i e = load(v + x, 128);
+    // Each 32 bit lane sums the products of a pixel's pair of samples.
+    const __m128i ye[2] = { _mm_unpacklo_epi16(y16, e),
+        _mm_unpackhi_epi16(y16, e) };
+    const __m128i yd[2] = { _mm_unpacklo_epi16(y16, d),
+        _mm_unpackhi_epi16(y16, d) };
+    const __m128i e1[2] = { _mm_unpacklo_epi16(e, one),
+        _mm_unpackhi_epi16(e, one) };
+    __m128i r[2], g[2], b[2];
+    for (int half = 0; half < 2; ++half) {
+      r[half] = _mm_srai_epi32(
+          _mm_add_epi32(_mm_madd_epi16(ye[half], r_weights), round), 8);
+      g[half] = _mm_srai_epi32(
+          _mm_add_epi32(_mm_madd_epi16(yd[half], g_weights),
+                        _mm_madd_epi16(e1[half], g_v_weights)),
+          8);
+      b[half] = _mm_srai_epi32(
+          _mm_add_epi32(_mm_madd_epi16(yd[half], b_weights), round), 8);
+    }
+    // Saturating packs clamp to 0 to 255 as Clamp does. SSE2 can't shuffle
+    // bytes, the channels are interleaved from memory.
+    uint8_t channels[3][16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(channels[0]),
+                     _mm_packus_epi16(_mm_packs_epi32(r[0], r[1]), zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(channels[1]),
+                     _mm_packus_epi16(_mm_packs_epi32(g[0], g[1]), zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(channels[2]),
+                     _mm_packus_epi16(_mm_packs_epi32(b[0], b[1]), zero));
+    for (int i = 0; i < 8; ++i) {
+      out[3 * (x + i)] = channels[0][i];
+      out[3 * (x + i) + 1] = channels[1][i];
+      out[3 * (x + i) + 2] = channels[2][i];
+    }
+  }
+#endif
+  for (; x < n; ++x) {
+    const int c = m.cy * (luma[x] - 16) + 128;
+    const int d = u[x] - 128;
+    const int e = v[x] - 128;
+    out[3 * x] = Clamp((c + m.crv * e) >> 8);
+    out[3 * x + 1] = Clamp((c - m.cgu * d - m.cgv * e) >> 8);
+    out[3 * x + 2] = Clamp((c + m.cbu * d) >> 8);
+  }
+}
+
+YuvImage CropYuvImage(const YuvImage &image, int x, int y, int width,
+                      int height) {
+  const int x0 = std::max(0, std::min(x, image.width - 2)) & ~1;
+  const int y0 = std::max(0, std::min(y, image.height - 2)) & ~1;
+  YuvImage crop = image;
+  crop.width = std::max(2, std::min(width + x - x0, image.width - x0));
+  crop.height = std::max(2, std::min(height + y - y0, image.height - y0));
+  crop.y = image.y + y0 * image.y_stride + x0;
+  const int chroma_offset = (y0 / 2) * image.uv_stride
+      + (x0 / 2) * image.uv_pixel_stride;
+  crop.u = image.u + chroma_offset;
+  crop.v = image.v + chroma_offset;
+  return crop;
+}
+
+void FramePreprocessor::UpdateColumnTables(int src_width, int content_width) {
+  if (src_width == table_src_width_ && content_width == table_content_width_) {
+    return;
+  }
+  const int chroma_width = (src_width + 1) / 2;
+  luma_x0_.resize(content_width);
+  luma_x1_.resize(content_width);
+  luma_fx_.resize(content_width);
+  chroma_x0_.resize(content_width);
+  chroma_x1_.resize(content_width);
+  chroma_fx_.resize(content_width);
+  for (int x = 0; x < content_width; ++x) {
+    SamplePosition(x, src_width, content_width, &luma_x0_[x], &luma_x1_[x],
+                   &luma_fx_[x]);
+    SamplePosition(x, chroma_width, content_width, &chroma_x0_[x],
+                   &chroma_x1_[x], &chroma_fx_[x]);
+  }
+  table_src_width_ = src_width;
+  table_content_width_ = content_width;
+}
+
+Utility::Letterbox FramePreprocessor::Run(const YuvImage &src, uint8_t *dst,
+                                          int dst_width, int dst_height,
+                                          bool letterbox) {
+  int content_width = dst_width;
+  int content_height = dst_height;
+  if (letterbox) {
+    const float scale = std::min(static_cast<float>(dst_width) / src.width,
+                                 static_cast<float>(dst_height) / src.height);
+    content_width = std::min(dst_width,
+                             static_cast<int>(std::lround(src.width * scale)));
+    content_height = std::min(
+        dst_height, static_cast<int>(std::lround(src.height * scale)));
+  }
+  const int offset_x = (dst_width - content_width) / 2;
+  const int offset_y = (dst_height - content_height) / 2;
+  const size_t dst_stride = dst_width * 3;
+
+  UpdateColumnTables(src.width, content_width);
+
+  const ColorMatrix matrix(src.bt709);
+  const int chroma_width = (src.width + 1) / 2;
+  const int chroma_height = (src.height + 1) / 2;
+  const int ups = src.uv_pixel_stride;
+  // Chroma rows are blended as stored, interleaved for NV12, so V of NV12
+  // comes out of the same pass as U.
+  const int chroma_span = (chroma_width - 1) * ups + 1;
+  const bool interleaved = ups == 2 && src.v == src.u + 1;
+  vertical_luma_.resize(src.width);
+  vertical_u_.resize(chroma_span + (interleaved ? 1 : 0));
+  vertical_v_.resize(interleaved ? 0 : chroma_span);
+  luma_row_.resize(content_width);
+  u_row_.resize(content_width);
+  v_row_.resize(content_width);
+  const uint16_t *vu = vertical_u_.data();
+  const uint16_t *vv = interleaved ? vu + 1 : vertical_v_.data();
+  const int *lx0 = luma_x0_.data();
+  const int *lx1 = luma_x1_.data();
+  const int *lfx = luma_fx_.data();
+  const int *cx0 = chroma_x0_.data();
+  const int *cx1 = chroma_x1_.data();
+  const int *cfx = chroma_fx_.data();
+
+  // Letterbox bars above and below.
+  std::memset(dst, 0, offset_y * dst_stride);
+  std::memset(dst + (offset_y + content_height) * dst_stride, 0,
+              (dst_height - offset_y - content_height) * dst_stride);
+
+  for (int y = 0; y < content_height; ++y) {
+    int ly0, ly1, lfy, cy0, cy1, cfy;
+    SamplePosition(y, src.height, content_height, &ly0, &ly1, &lfy);
+    SamplePosition(y, chroma_height, content_height, &cy0, &cy1, &cfy);
+    LerpRows(src.y + ly0 * src.y_stride, src.y + ly1 * src.y_stride, lfy,
+             src.width, vertical_luma_.data());
+    LerpRows(src.u + cy0 * src.uv_stride, src.u + cy1 * src.uv_stride, cfy,
+             vertical_u_.size(), vertical_u_.data());
+    if (!interleaved) {
+      LerpRows(src.v + cy0 * src.uv_stride, src.v + cy1 * src.uv_stride, cfy,
+               chroma_span, vertical_v_.data());
+    }
+
+    // The column tables make every sample an indexed load, this pass stays
+    // scalar. It reads six samples per pixel, the vertical pass having
+    // halved them, the passes before and after it are vectorized.
+    const uint16_t *vl = vertical_luma_.data();
+    uint8_t *luma_row = luma_row_.data();
+    uint8_t *u_row = u_row_.data();
+    uint8_t *v_row = v_row_.data();
+    for (int x = 0; x < content_width; ++x) {
+      // 16 fractional bits after both passes, rounded back to 8 bit samples.
+      luma_row[x] = (vl[lx0[x]] * (kWeightOne - lfx[x]) + vl[lx1[x]] * lfx[x]
+          + (1 << 15)) >> 16;
+      const int c0 = cx0[x] * ups;
+      const int c1 = cx1[x] * ups;
+      u_row[x] = (vu[c0] * (kWeightOne - cfx[x]) + vu[c1] * cfx[x]
+          + (1 << 15)) >> 16;
+      v_row[x] = (vv[c0] * (kWeightOne - cfx[x]) + vv[c1] * cfx[x]
+          + (1 << 15)) >> 16;
+    }
+
+    uint8_t *out = dst + (offset_y + y) * dst_stride;
+    std::memset(out, 0, offset_x * 3);
+    std::memset(out + (offset_x + content_width) * 3, 0,
+                (dst_width - offset_x - content_width) * 3);
+    out += offset_x * 3;
+    ConvertRow(luma_row, u_row, v_row, content_width, matrix, out);
+  }
+
+  Utility::Letterbox result;
+  result.x_ = static_cast<float>(offset_x) / dst_width;
+  result.y_ = static_cast<float>(offset_y) / dst_height;
+  result.width_ = static_cast<float>(content_width) / dst_width;
+  result.height_ = static_cast<float>(content_height) / dst_height;
+  return result;
+}
+
+FramePreprocessor::FramePreprocessor() {
+}
+
+FramePreprocessor::~FramePreprocessor() {
+}
+
+} /* namespace szd */
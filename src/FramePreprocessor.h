@@ -0,0 +1,98 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * FramePreprocessor.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_FRAMEPREPROCESSOR_H_
+#define SRC_FRAMEPREPROCESSOR_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "Utility.h"
+
+namespace szd {
+
+// A decoded 4:2:0 frame. NV12 has interleaved chroma, set u to the UV plane,
+// v to u + 1 and uv_pixel_stride to 2. I420 has separate planes and
+// uv_pixel_stride 1.
+struct YuvImage {
+  const uint8_t *y;
+  const uint8_t *u;
+  const uint8_t *v;
+  int width;
+  int height;
+  int y_stride;
+  int uv_stride;
+  int uv_pixel_stride;
+  bool bt709;
+};
+
+// Returns the part of image inside the rectangle, clamped to the image and
+// aligned to the chroma subsampling. No pixels are copied.
+YuvImage CropYuvImage(const YuvImage &image, int x, int y, int width,
+                      int height);
+
+// Converts a decoded YUV frame to the packed RGB model input in one pass,
+// doing colour conversion, bilinear scaling and optional letterboxing
+// together instead of in separate videoconvert and videoscale elements.
+// Not thread safe, keep one per appsink.
+class FramePreprocessor {
+ public:
+  FramePreprocessor();
+  FramePreprocessor(const FramePreprocessor &other) = delete;
+  FramePreprocessor(FramePreprocessor &&other) = delete;
+  FramePreprocessor& operator=(const FramePreprocessor &other) = delete;
+  FramePreprocessor& operator=(FramePreprocessor &&other) = delete;
+  virtual ~FramePreprocessor();
+
+  // Writes dst_width * dst_height * 3 bytes of RGB to dst. With letterbox set
+  // the frame keeps its aspect ratio and is centered on black, the returned
+  // Letterbox tells where it ended up.
+  Utility::Letterbox Run(const YuvImage &src, uint8_t *dst, int dst_width,
+                         int dst_height, bool letterbox);
+
+ private:
+  // Horizontal sample positions only depend on the frame and output sizes so
+  // they are computed once and reused for every row of every frame.
+  void UpdateColumnTables(int src_width, int content_width);
+
+  // Each output row is made in three passes: the two source rows are
+  // blended vertically into vertical_*_, those are sampled horizontally into
+  // the *_row_ of the output, and those are converted to RGB. The first and
+  // last run on contiguous rows, with NEON or SSE2 where available.
+  std::vector<uint16_t> vertical_luma_;
+  std::vector<uint16_t> vertical_u_;
+  std::vector<uint16_t> vertical_v_;
+  std::vector<uint8_t> luma_row_;
+  std::vector<uint8_t> u_row_;
+  std::vector<uint8_t> v_row_;
+  std::vector<int> luma_x0_;
+  std::vector<int> luma_x1_;
+  std::vector<int> luma_fx_;
+  std::vector<int> chroma_x0_;
+  std::vector<int> chroma_x1_;
+  std::vector<int> chroma_fx_;
+  int table_src_width_ = 0;
+  int table_content_width_ = 0;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_FRAMEPREPROCESSOR_H_ */
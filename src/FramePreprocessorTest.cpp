@@ -0,0 +1,353 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * FramePreprocessorTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "FramePreprocessor.h"
+
+namespace szd {
+
+struct Rgb {
+  int r, g, b;
+};
+
+// The limited range conversion in floating point.
+static Rgb Convert(float y, float u, float v, bool bt709) {
+  const float c = 255.0f / 219.0f * (y - 16.0f);
+  const float d = 255.0f / 224.0f * (u - 128.0f);
+  const float e = 255.0f / 224.0f * (v - 128.0f);
+  const float kr = bt709 ? 0.2126f : 0.299f;
+  const float kb = bt709 ? 0.0722f : 0.114f;
+  const float kg = 1.0f - kr - kb;
+  const float r = c + 2.0f * (1.0f - kr) * e;
+  const float b = c + 2.0f * (1.0f - kb) * d;
+  const float g = (c - kr * r - kb * b) / kg;
+  auto clamp = [](float x) {
+    return static_cast<int>(std::lround(std::min(255.0f, std::max(0.0f, x))));
+  };
+  return {clamp(r), clamp(g), clamp(b)};
+}
+
+// A frame in memory, NV12 or I420, with strides wider than its rows filled
+// with garbage that must never be sampled.
+class Frame {
+ public:
+  Frame(int width, int height, int y_stride, int uv_stride, bool nv12,
+        bool bt709)
+      :
+      width_(width),
+      height_(height),
+      nv12_(nv12),
+      y_(y_stride * height, 0xee),
+      uv_(uv_stride * ((height + 1) / 2) * (nv12 ? 1 : 2), 0xee) {
+    const int chroma_height = (height + 1) / 2;
+    image_.y = y_.data();
+    image_.u = uv_.data();
+    image_.v = nv12 ? uv_.data() + 1 : uv_.data() + uv_stride * chroma_height;
+    image_.width = width;
+    image_.height = height;
+    image_.y_stride = y_stride;
+    image_.uv_stride = uv_stride;
+    image_.uv_pixel_stride = nv12 ? 2 : 1;
+    image_.bt709 = bt709;
+  }
+
+  void SetY(int x, int y, uint8_t value) {
+    y_[y * image_.y_stride + x] = value;
+  }
+  void SetUv(int x, int y, uint8_t u, uint8_t v) {
+    const int offset = y * image_.uv_stride + x * image_.uv_pixel_stride;
+    uv_[image_.u - uv_.data() + offset] = u;
+    uv_[image_.v - uv_.data() + offset] = v;
+  }
+  void Fill(uint8_t y, uint8_t u, uint8_t v) {
+    for (int j = 0; j < height_; ++j) {
+      for (int i = 0; i < width_; ++i) {
+        SetY(i, j, y);
+        SetUv(i / 2, j / 2, u, v);
+      }
+    }
+  }
+  void FillRandom(unsigned seed) {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> value(16, 240);
+    for (int j = 0; j < height_; ++j) {
+      for (int i = 0; i < width_; ++i) {
+        SetY(i, j, value(random));
+        SetUv(i / 2, j / 2, value(random), value(random));
+      }
+    }
+  }
+  float GetY(int x, int y) const {
+    return image_.y[y * image_.y_stride + x];
+  }
+  float GetU(int x, int y) const {
+    return image_.u[y * image_.uv_stride + x * image_.uv_pixel_stride];
+  }
+  float GetV(int x, int y) const {
+    return image_.v[y * image_.uv_stride + x * image_.uv_pixel_stride];
+  }
+  const YuvImage& image() const {
+    return image_;
+  }
+
+ private:
+  int width_, height_;
+  bool nv12_;
+  std::vector<uint8_t> y_;
+  std::vector<uint8_t> uv_;
+  YuvImage image_;
+};
+
+// Bilinear sample positions with centers aligned, edges clamped.
+static void Sample(int i, int src_size, int dst_size, int *p0, int *p1,
+                   float *frac) {
+  const float s = std::max(0.0f, (i + 0.5f) * src_size / dst_size - 0.5f);
+  *p0 = std::min(static_cast<int>(s), src_size - 1);
+  *p1 = std::min(*p0 + 1, src_size - 1);
+  *frac = s - static_cast<int>(s);
+}
+
+// Frame scaled to width x height in floating point, then converted.
+static Rgb Reference(const Frame &frame, int x, int y, int width, int height) {
+  const auto &image = frame.image();
+  const int cw = (image.width + 1) / 2;
+  const int ch = (image.height + 1) / 2;
+  int x0, x1, y0, y1;
+  float fx, fy;
+  auto lerp = [](float a, float b, float f) {
+    return a + (b - a) * f;
+  };
+  Sample(x, image.width, width, &x0, &x1, &fx);
+  Sample(y, image.height, height, &y0, &y1, &fy);
+  const float luma = lerp(lerp(frame.GetY(x0, y0), frame.GetY(x1, y0), fx),
+                          lerp(frame.GetY(x0, y1), frame.GetY(x1, y1), fx),
+                          fy);
+  Sample(x, cw, width, &x0, &x1, &fx);
+  Sample(y, ch, height, &y0, &y1, &fy);
+  const float u = lerp(lerp(frame.GetU(x0, y0), frame.GetU(x1, y0), fx),
+                       lerp(frame.GetU(x0, y1), frame.GetU(x1, y1), fx), fy);
+  const float v = lerp(lerp(frame.GetV(x0, y0), frame.GetV(x1, y0), fx),
+                       lerp(frame.GetV(x0, y1), frame.GetV(x1, y1), fx), fy);
+  return Convert(luma, u, v, image.bt709);
+}
+
+static void ExpectPixel(const std::vector<uint8_t> &rgb, int width, int x,
+                        int y, const Rgb &expected, int tolerance) {
+  const uint8_t *pixel = &rgb[(y * width + x) * 3];
+  EXPECT_NEAR(pixel[0], expected.r, tolerance) << "at " << x << "," << y;
+  EXPECT_NEAR(pixel[1], expected.g, tolerance) << "at " << x << "," << y;
+  EXPECT_NEAR(pixel[2], expected.b, tolerance) << "at " << x << "," << y;
+}
+
+struct KnownColor {
+  uint8_t y, u, v;
+  Rgb rgb;
+};
+
+// Colour bars as the two matrices encode them.
+static const KnownColor kBt601Colors[] = {
+  { 235, 128, 128, { 255, 255, 255 } },
+  { 16, 128, 128, { 0, 0, 0 } },
+  { 81, 90, 240, { 255, 0, 0 } },
+  { 145, 54, 34, { 0, 255, 0 } },
+  { 41, 240, 110, { 0, 0, 255 } },
+};
+static const KnownColor kBt709Colors[] = {
+  { 235, 128, 128, { 255, 255, 255 } },
+  { 16, 128, 128, { 0, 0, 0 } },
+  { 63, 102, 240, { 255, 0, 0 } },
+  { 173, 42, 26, { 0, 255, 0 } },
+  { 32, 240, 118, { 0, 0, 255 } },
+};
+
+static void ExpectKnownColors(const KnownColor *colors, size_t n, bool nv12,
+                              bool bt709) {
+  FramePreprocessor preprocessor;
+  for (size_t i = 0; i < n; ++i) {
+    Frame frame(6, 4, 8, 8, nv12, bt709);
+    frame.Fill(colors[i].y, colors[i].u, colors[i].v);
+    std::vector<uint8_t> rgb(6 * 4 * 3);
+    preprocessor.Run(frame.image(), rgb.data(), 6, 4, false);
+    ExpectPixel(rgb, 6, 3, 2, colors[i].rgb, 3);
+    ExpectPixel(rgb, 6, 3, 2, Convert(colors[i].y, colors[i].u, colors[i].v,
+                                      bt709),
+                1);
+  }
+}
+
+TEST(FramePreprocessorTest, ConvertsBt601) {
+  ExpectKnownColors(kBt601Colors, 5, true, false);
+  ExpectKnownColors(kBt601Colors, 5, false, false);
+}
+
+TEST(FramePreprocessorTest, ConvertsBt709) {
+  ExpectKnownColors(kBt709Colors, 5, true, true);
+  ExpectKnownColors(kBt709Colors, 5, false, true);
+}
+
+// Same size in and out samples every luma pixel exactly, chroma is scaled
+// from its half size plane. Odd sizes and strides wider than the rows must
+// not shift or mix in the padding.
+TEST(FramePreprocessorTest, KeepsPixelsOfOddSizesAndStrides) {
+  for (bool nv12 : { true, false }) {
+    Frame frame(7, 5, 13, 11, nv12, false);
+    frame.FillRandom(1);
+    std::vector<uint8_t> rgb(7 * 5 * 3);
+    FramePreprocessor preprocessor;
+    preprocessor.Run(frame.image(), rgb.data(), 7, 5, false);
+    for (int y = 0; y < 5; ++y) {
+      for (int x = 0; x < 7; ++x) {
+        ExpectPixel(rgb, 7, x, y, Reference(frame, x, y, 7, 5), 1);
+      }
+    }
+  }
+}
+
+TEST(FramePreprocessorTest, ScalesBilinearly) {
+  for (bool nv12 : { true, false }) {
+    Frame frame(37, 23, 40, 40, nv12, true);
+    frame.FillRandom(2);
+    FramePreprocessor preprocessor;
+    for (int size : { 16, 61 }) {
+      std::vector<uint8_t> rgb(size * size * 3);
+      preprocessor.Run(frame.image(), rgb.data(), size, size, false);
+      for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+          // 8 bit weights, off by a little more once the V to R and U to B
+          // coefficients amplify them.
+          ExpectPixel(rgb, size, x, y, Reference(frame, x, y, size, size), 3);
+        }
+      }
+    }
+  }
+}
+
+TEST(FramePreprocessorTest, Letterboxes) {
+  Frame frame(9, 3, 12, 6, false, false);
+  frame.Fill(235, 128, 128);
+  std::vector<uint8_t> rgb(6 * 6 * 3, 0x55);
+  FramePreprocessor preprocessor;
+  // 9x3 fits 6x2, centered with bars of two rows above and below.
+  const auto letterbox = preprocessor.Run(frame.image(), rgb.data(), 6, 6,
+                                          true);
+  EXPECT_FLOAT_EQ(letterbox.x_, 0.0f);
+  EXPECT_FLOAT_EQ(letterbox.y_, 2.0f / 6);
+  EXPECT_FLOAT_EQ(letterbox.width_, 1.0f);
+  EXPECT_FLOAT_EQ(letterbox.height_, 2.0f / 6);
+  for (int y = 0; y < 6; ++y) {
+    for (int x = 0; x < 6; ++x) {
+      const bool content = y >= 2 && y < 4;
+      ExpectPixel(rgb, 6, x, y,
+                  content ? Rgb { 255, 255, 255 } : Rgb { 0, 0, 0 }, 0);
+    }
+  }
+
+  // 3x9 fits 2x6 in the middle columns.
+  Frame tall(3, 9, 4, 4, true, false);
+  tall.Fill(235, 128, 128);
+  std::fill(rgb.begin(), rgb.end(), 0x55);
+  const auto pillarbox = preprocessor.Run(tall.image(), rgb.data(), 6, 6,
+                                          true);
+  EXPECT_FLOAT_EQ(pillarbox.x_, 2.0f / 6);
+  EXPECT_FLOAT_EQ(pillarbox.width_, 2.0f / 6);
+  for (int y = 0; y < 6; ++y) {
+    for (int x = 0; x < 6; ++x) {
+      const bool content = x >= 2 && x < 4;
+      ExpectPixel(rgb, 6, x, y,
+                  content ? Rgb { 255, 255, 255 } : Rgb { 0, 0, 0 }, 0);
+    }
+  }
+}
+
+// Detection boxes scaled to the frame may extend past any edge.
+TEST(FramePreprocessorTest, CropsClampToTheFrame) {
+  for (bool nv12 : { true, false }) {
+    Frame frame(64, 48, 72, 72, nv12, false);
+    const auto &image = frame.image();
+    const int ups = image.uv_pixel_stride;
+
+    auto crop = CropYuvImage(image, -10, -6, 30, 20);
+    EXPECT_EQ(crop.y, image.y);
+    EXPECT_EQ(crop.u, image.u);
+    EXPECT_EQ(crop.v, image.v);
+    EXPECT_EQ(crop.width, 20);
+    EXPECT_EQ(crop.height, 14);
+
+    crop = CropYuvImage(image, 50, 40, 30, 30);
+    EXPECT_EQ(crop.y, image.y + 40 * image.y_stride + 50);
+    EXPECT_EQ(crop.u, image.u + 20 * image.uv_stride + 25 * ups);
+    EXPECT_EQ(crop.v, image.v + 20 * image.uv_stride + 25 * ups);
+    EXPECT_EQ(crop.width, 14);
+    EXPECT_EQ(crop.height, 8);
+
+    // Odd corners move to the chroma sample before them, the size grows to
+    // still cover the box.
+    crop = CropYuvImage(image, 7, 5, 10, 10);
+    EXPECT_EQ(crop.y, image.y + 4 * image.y_stride + 6);
+    EXPECT_EQ(crop.width, 11);
+    EXPECT_EQ(crop.height, 11);
+
+    // Boxes outside the frame keep the 2x2 at the nearest corner.
+    crop = CropYuvImage(image, 100, -100, 20, 20);
+    EXPECT_EQ(crop.y, image.y + 62);
+    EXPECT_EQ(crop.width, 2);
+    EXPECT_EQ(crop.height, 2);
+    crop = CropYuvImage(image, 30, 20, 0, 0);
+    EXPECT_EQ(crop.width, 2);
+    EXPECT_EQ(crop.height, 2);
+  }
+}
+
+// Crops past the bottom right corner sample only the frame, the pixels of
+// the corner end up in the model input. Without padding after the rows, a
+// read past the corner is past the end of the buffers.
+TEST(FramePreprocessorTest, ConvertsCropsAtTheEdge) {
+  for (bool nv12 : { true, false }) {
+    Frame frame(64, 48, 64, 64, nv12, false);
+    frame.Fill(16, 128, 128);
+    for (int y = 40; y < 48; ++y) {
+      for (int x = 56; x < 64; ++x) {
+        frame.SetY(x, y, 235);
+      }
+    }
+    const auto crop = CropYuvImage(frame.image(), 56, 40, 40, 40);
+    ASSERT_EQ(crop.width, 8);
+    ASSERT_EQ(crop.height, 8);
+    std::vector<uint8_t> rgb(16 * 16 * 3);
+    FramePreprocessor preprocessor;
+    preprocessor.Run(crop, rgb.data(), 16, 16, false);
+    for (int y = 0; y < 16; ++y) {
+      for (int x = 0; x < 16; ++x) {
+        ExpectPixel(rgb, 16, x, y, { 255, 255, 255 }, 0);
+      }
+    }
+  }
+}
+
+} /* namespace szd */
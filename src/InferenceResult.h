@@ -0,0 +1,99 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * InferenceResult.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_INFERENCERESULT_H_
+#define SRC_INFERENCERESULT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace szd {
+
+struct DetectionResult {
+  std::string candidate;
+  float score, x1, y1, x2, y2;
+};
+
+struct ClassificationResult {
+  std::string candidate;
+  float score;
+};
+
+// What InterpretFrame produced for one frame, the members filled depend on
+// the inferencer type. Callers keep one per stream and pass it to every
+// call, the vectors keep their capacity so steady state inference doesn't
+// allocate.
+struct InferenceResult {
+  // Set when the frame wasn't inferred, e.g. the TPU scheduler dropped it.
+  // Nothing else is valid then.
+  bool dropped = false;
+  std::vector<DetectionResult> detections;
+  std::vector<ClassificationResult> classifications;
+  std::vector<uint8_t> segmentation_mask;
+
+  void Clear() {
+    dropped = false;
+    detections.clear();
+    classifications.clear();
+    segmentation_mask.clear();
+  }
+};
+
+// Hands the latest of a series of values from one producer thread to one
+// consumer thread without locks, copies or allocations. Each side owns one
+// of the three slots and the third holds the latest published value, the
+// slots are exchanged by index.
+template<typename T>
+class TripleBuffer {
+ public:
+  // Where the producer writes the next value.
+  T& GetWriteSlot() {
+    return slots_[write_];
+  }
+  // Makes the write slot the latest value, the producer gets a new one.
+  void Publish() {
+    write_ = latest_.exchange(write_ | kFresh, std::memory_order_acq_rel)
+        & kIndex;
+  }
+  // Returns the latest published value, or the value returned last time if
+  // nothing was published since. Valid until the next call.
+  const T& Read() {
+    if (latest_.load(std::memory_order_acquire) & kFresh) {
+      read_ = latest_.exchange(read_, std::memory_order_acq_rel) & kIndex;
+    }
+    return slots_[read_];
+  }
+
+ private:
+  static const int kIndex = 3;
+  static const int kFresh = 4;
+
+  T slots_[3];
+  int write_ = 0;
+  std::atomic<int> latest_ { 1 };
+  int read_ = 2;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_INFERENCERESULT_H_ */
@@ -19,31 +19,37 @@
  *  Created on: Apr 7, 2021
  *      Author: pnordstrom
  */
+#include <cstring>
 #include <fstream>
 #include <regex>
+#include <thread>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
 #include "tensorflow/lite/builtin_op_data.h"
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/kernels/register.h"
 
+#include "DeviceProvider.h"
 #include "InferencerBase.h"
+#include "ModelRegistry.h"
 
 namespace szd {
 
 void InferencerBase::InterpretFrame(const uint8_t *pixels, size_t pixel_length,
                                     size_t width, size_t height, size_t stride,
-                                    std::shared_ptr<void> &return_data) {
-  return_data = nullptr;
-  return;
+                                    InferenceResult &result) {
+  result.Clear();
+  result.dropped = true;
 }
 
 std::unique_ptr<tflite::Interpreter> InferencerBase::InitializeInterpreter(
     tflite::FlatBufferModel *model, edgetpu::EdgeTpuContext *context,
     coral::EdgeTpuErrorReporter *error_reporter) {
   tflite::ops::builtin::BuiltinOpResolver resolver;
-  resolver.AddCustom(edgetpu::kCustomOp, edgetpu::RegisterCustomOp());
+  resolver.AddCustom(edgetpu::kCustomOp,
+                     DeviceProvider::Get().GetCustomOp());
   tflite::InterpreterBuilder builder(model->GetModel(), resolver, error_reporter);
   std::unique_ptr<tflite::Interpreter> interpreter;
   CHECK_EQ(builder(&interpreter), kTfLiteOk);
@@ -52,9 +58,116 @@ std::unique_ptr<tflite::Interpreter> InferencerBase::InitializeInterpreter(
   return interpreter;
 }
 
+int InferencerBase::warm_up_invokes_ = 0;
+
+void InferencerBase::SetWarmUpInvokes(int invokes) {
+  warm_up_invokes_ = invokes;
+}
+
+void InferencerBase::WarmUp(tflite::Interpreter &interpreter,
+                            const std::string &model_path,
+                            edgetpu::EdgeTpuContext &context) {
+  if (warm_up_invokes_ <= 0) {
+    return;
+  }
+  for (auto input : interpreter.inputs()) {
+    auto *tensor = interpreter.tensor(input);
+    std::memset(tensor->data.raw, 0, tensor->bytes);
+  }
+  // Takes turns with the other models on the TPU like any invoke, models
+  // compiled together would otherwise warm up at the same time on it.
+  auto &scheduler = TpuScheduler::ForDevice(context);
+  const int cache_group = TpuScheduler::GetCacheGroup(model_path);
+  const int stream = Tracer::GetContext().stream;
+  uint64_t cold_ns = 0;
+  uint64_t warm_ns = 0;
+  for (int i = 0; i < warm_up_invokes_; ++i) {
+    // A warm-up invoke has no frame to give up, it waits for its turn.
+    while (!scheduler.Acquire(cache_group, stream)) {
+    }
+    auto start_ns = Tracer::Now();
+    const auto status = interpreter.Invoke();
+    (i == 0 ? cold_ns : warm_ns) += Tracer::Now() - start_ns;
+    scheduler.Release();
+    CHECK_EQ(status, kTfLiteOk);
+  }
+
+  const double cold = cold_ns / 1e9;
+  const double warm =
+      warm_up_invokes_ > 1 ? warm_ns / 1e9 / (warm_up_invokes_ - 1) : cold;
+  const auto labels = absl::Substitute(
+      "model=\"$0\",tpu=\"$1\"",
+      model_path.substr(model_path.find_last_of("/") + 1),
+      context.GetDeviceEnumRecord().path);
+  auto &registry = MetricsRegistry::GetInstance();
+  registry.AddCallbackGauge(
+      "model_warmup_latency_seconds",
+      "Invoke latency when the model was loaded, of the first invoke and the "
+      "mean of the others.",
+      absl::StrCat(labels, ",invoke=\"cold\""), [cold] {
+        return cold;
+      });
+  registry.AddCallbackGauge(
+      "model_warmup_latency_seconds",
+      "Invoke latency when the model was loaded, of the first invoke and the "
+      "mean of the others.",
+      absl::StrCat(labels, ",invoke=\"warm\""), [warm] {
+        return warm;
+      });
+  LOG(INFO) << "Warmed up " << model_path << ": cold " << cold * 1e3
+      << " ms, warm " << warm * 1e3 << " ms";
+}
+
+void InferencerBase::SetOutputDecoder(const std::string &model_path,
+                                      const std::string &decoder) {
+  // Decoding takes microseconds, far below the invoke latency buckets.
+  static const std::vector<double> kDecodeBuckets = { 0.00001, 0.00002,
+      0.00005, 0.0001, 0.0002, 0.0005, 0.001, 0.002, 0.005 };
+  decode_latency_ = MetricsRegistry::GetInstance().GetLatencyHistogram(
+      "output_decode_seconds",
+      "Time from the end of an invoke to the results of the frame, by "
+      "output decoder.",
+      absl::Substitute("model=\"$0\",decoder=\"$1\"",
+                       model_path.substr(model_path.find_last_of("/") + 1),
+                       decoder),
+      kDecodeBuckets);
+}
+
+bool InferencerBase::Invoke() {
+  TraceSpan span("invoke");
+  if (!scheduler_->Acquire(cache_group_, Tracer::GetContext().stream)) {
+    return false;
+  }
+  auto start_ns = Tracer::Now();
+  const auto status = interpreter_->Invoke();
+  tpu_busy_ns_->Increment(Tracer::Now() - start_ns);
+  scheduler_->Release();
+  CHECK_EQ(status, kTfLiteOk) << error_reporter_.message();
+  return true;
+}
+
+absl::Mutex InferencerBase::tpu_mutex_;
 std::vector<edgetpu::EdgeTpuManager::DeviceEnumerationRecord> InferencerBase::all_tpus_;
+std::vector<std::shared_ptr<edgetpu::EdgeTpuContext>> InferencerBase::open_tpus_;
 size_t InferencerBase::next_available_tpu_ = 0;
 
+void InferencerBase::OpenAllTpus() {
+  absl::MutexLock lock(&tpu_mutex_);
+  if (all_tpus_.empty()) {
+    all_tpus_ = DeviceProvider::Get().EnumerateDevices();
+  }
+  open_tpus_.resize(all_tpus_.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < all_tpus_.size(); i++) {
+    threads.emplace_back([i] {
+      open_tpus_[i] = DeviceProvider::Get().OpenDevice(all_tpus_[i]);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
 void InferencerBase::ReadLabels(std::map<int, std::string> &labels,
                                 const std::string &label_path,
                                 const std::string &detection_object) {
@@ -78,14 +191,25 @@ void InferencerBase::ReadLabels(std::map<int, std::string> &labels,
 
 void InferencerBase::Initialize(const std::string &model_path,
                                 const std::string &label_path,
-                                const std::string &detection_object) {
-  model_ = tflite::FlatBufferModel::BuildFromFile(model_path.c_str());
-  CHECK_NOTNULL(model_);
+                                const std::string &detection_object,
+                                bool warm_up) {
+  model_ = ModelRegistry::GetInstance().Get(model_path);
+  CHECK(model_) << "Can't load " << model_path;
   model_description_ = model_path.substr(model_path.find_last_of("/") + 1);
   model_description_ = absl::StrCat(model_description_, "\non $0 TPU(s)");
   model_description_ = absl::Substitute(model_description_, num_tpus_);
 
   interpreter_ = InitializeInterpreter(model_.get(), tpu_contexts_[0].get(), &error_reporter_);
+  tpu_busy_ns_ = MetricsRegistry::GetInstance().GetCounter(
+      "tpu_busy_seconds_total", "Time the TPU spent running invokes.",
+      absl::Substitute("tpu=\"$0\"",
+                       tpu_contexts_[0]->GetDeviceEnumRecord().path),
+      1e-9);
+  scheduler_ = &TpuScheduler::ForDevice(*tpu_contexts_[0]);
+  cache_group_ = TpuScheduler::GetCacheGroup(model_path);
+  if (warm_up) {
+    WarmUp(*interpreter_, model_path, *tpu_contexts_[0]);
+  }
 
   auto dims = interpreter_->input_tensor(0)->dims;
   CHECK_EQ(dims->size, 4);
@@ -97,9 +221,11 @@ void InferencerBase::Initialize(const std::string &model_path,
   const auto &out_tensor_indices = interpreter_->outputs();
   output_shape_.resize(out_tensor_indices.size());
   for (size_t i = 0; i < out_tensor_indices.size(); ++i) {
-    const auto *tensor = interpreter_->tensor(out_tensor_indices[i]);
-    // For detection inferencers the output tensors are only of type float.
-    output_shape_[i] = tensor->bytes / sizeof(float);
+    const auto *dims = interpreter_->tensor(out_tensor_indices[i])->dims;
+    output_shape_[i] = 1;
+    for (int j = 0; j < dims->size; ++j) {
+      output_shape_[i] *= dims->data[j];
+    }
   }
   ReadLabels(labels_, label_path, detection_object);
 }
@@ -107,6 +233,7 @@ void InferencerBase::Initialize(const std::string &model_path,
 InferencerBase::InferencerBase(size_t num_tpus)
     :
     InferencerBase() {
+  absl::MutexLock lock(&tpu_mutex_);
   if (num_tpus + next_available_tpu_ > all_tpus_.size()) {
     LOG(ERROR) << "Not enough TPUs found. This demo requires at least 8 TPUs";
     exit(1);
@@ -116,16 +243,17 @@ InferencerBase::InferencerBase(size_t num_tpus)
       i++) {
     tpu_contexts_.push_back(
         CHECK_NOTNULL(
-            edgetpu::EdgeTpuManager::GetSingleton()->OpenDevice(
-                all_tpus_[i].type, all_tpus_[i].path)));
+            i < open_tpus_.size() && open_tpus_[i] ?
+                open_tpus_[i] : DeviceProvider::Get().OpenDevice(all_tpus_[i])));
   }
   next_available_tpu_ += num_tpus;
   num_tpus_ = num_tpus;
 }
 
 InferencerBase::InferencerBase() {
+  absl::MutexLock lock(&tpu_mutex_);
   if (all_tpus_.empty()) {
-    all_tpus_ = edgetpu::EdgeTpuManager::GetSingleton()->EnumerateEdgeTpu();
+    all_tpus_ = DeviceProvider::Get().EnumerateDevices();
   }
 }
 
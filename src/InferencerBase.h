@@ -22,12 +22,17 @@
 #include <memory>
 #include <string>
 
+#include "absl/synchronization/mutex.h"
 #include "coral/error_reporter.h"
 #include "coral/pipeline/pipelined_model_runner.h"
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/model.h"
 #include "tflite/public/edgetpu.h"
 
+#include "InferenceResult.h"
+#include "Metrics.h"
+#include "TpuScheduler.h"
+#include "Tracer.h"
 #include "Utility.h"
 
 #ifndef INFERENCERBASE_H_
@@ -53,18 +58,21 @@ class InferencerBase {
   InferencerBase& operator=(InferencerBase &&other) = delete;
   virtual ~InferencerBase();
 
+  // Replaces the contents of result with the results for the frame, result
+  // is dropped if the frame wasn't inferred.
   virtual void InterpretFrame(const uint8_t *pixels, size_t pixel_length,
                               size_t width, size_t height, size_t stride,
-                              std::shared_ptr<void> &return_data);
+                              InferenceResult &result);
   virtual InferencerType GetInferencerType() {
     return kNone;
   }
   virtual Utility::Polygon GetKeepOut() {
     return {};
   }
-  virtual void InitializePipelineRunner(
-      coral::Allocator *allocator,
-      std::function<void(const std::string)> output_cb) {
+  // Called once the bin running this inferencer knows its metric labels.
+  virtual void SetupMetrics(const std::string &labels) {
+  }
+  virtual void InitializePipelineRunner(coral::Allocator *allocator) {
   }
   size_t GetInputWidth() {
     return input_width_;
@@ -72,34 +80,91 @@ class InferencerBase {
   size_t GetInputHeight() {
     return input_height_;
   }
+  size_t GetInputBytes() {
+    return input_bytes_;
+  }
+  // Frames can be written straight into the input tensor, InterpretFrame
+  // then skips its copy when given this pointer.
+  uint8_t* GetInputTensor() {
+    return interpreter_ ? interpreter_->typed_input_tensor<uint8_t>(0) : nullptr;
+  }
+  // Sets where the frame was placed in the input tensor for the next
+  // InterpretFrame call.
+  void SetLetterbox(const Utility::Letterbox &letterbox) {
+    letterbox_ = letterbox;
+  }
   std::string GetModelDescription() {
     return model_description_;
   }
   int GetDetectionObject() {
     return detection_object_;
   }
+  // The device the model runs on, or its first stage, empty if none.
+  std::string GetTpuPath() {
+    return tpu_contexts_.empty() ?
+        "" : tpu_contexts_[0]->GetDeviceEnumRecord().path;
+  }
+  // Time spent in invokes on the TPU of this inferencer, in ns. nullptr
+  // until the model is loaded.
+  const Counter* GetTpuBusy() {
+    return tpu_busy_ns_;
+  }
+  // Opens every TPU concurrently, the inferencers created afterwards only
+  // take theirs. Opening a TPU can take seconds, e.g. to load the USB
+  // firmware.
+  static void OpenAllTpus();
+  // Invokes run on synthetic input whenever an interpreter is created, so
+  // the parameters are on the TPU before the first frame arrives. Must be
+  // set before any inferencer is created, 0 to disable.
+  static void SetWarmUpInvokes(int invokes);
 
  protected:
   static std::unique_ptr<tflite::Interpreter> InitializeInterpreter(
       tflite::FlatBufferModel *model, edgetpu::EdgeTpuContext *context, coral::EdgeTpuErrorReporter *error_reporter);
+  // Loads the model into interpreter_ on the first TPU, warm_up runs the
+  // warm-up invokes on it.
   void Initialize(const std::string &model_path, const std::string &label_path,
-                  const std::string &detection_object);
+                  const std::string &detection_object, bool warm_up = true);
+  // Runs the interpreter when its TPU scheduler lets it and accounts the
+  // time to the TPU. Returns false if the scheduler dropped the invoke for
+  // the stream of the calling thread, see TpuScheduler.
+  bool Invoke();
+  // Runs the warm-up invokes on interpreter through the scheduler of the
+  // TPU of context and exports the latency of the first one and the mean of
+  // the others.
+  static void WarmUp(tflite::Interpreter &interpreter,
+                     const std::string &model_path,
+                     edgetpu::EdgeTpuContext &context);
+  // Names the output decoder selected for the model in the metrics, the
+  // time each frame takes to decode is then observed in decode_latency_.
+  void SetOutputDecoder(const std::string &model_path,
+                        const std::string &decoder);
   std::map<int, std::string> labels_;
   std::unique_ptr<tflite::Interpreter> interpreter_;
   coral::EdgeTpuErrorReporter error_reporter_;
+  // Elements in each output tensor.
   std::vector<size_t> output_shape_;
   std::vector<std::shared_ptr<edgetpu::EdgeTpuContext>> tpu_contexts_;
   size_t num_tpus_ = 0;
   int detection_object_ = -1;
+  Utility::Letterbox letterbox_;
+  Histogram *decode_latency_ = nullptr;
 
  private:
+  Counter *tpu_busy_ns_ = nullptr;
+  TpuScheduler *scheduler_ = nullptr;
+  int cache_group_ = -1;
   void ReadLabels(std::map<int, std::string> &labels,
                   const std::string &label_path,
                   const std::string &detection_object);
+  static int warm_up_invokes_;
+  // Guards the TPU lists below, inferencers may be created concurrently.
+  static absl::Mutex tpu_mutex_;
   static std::vector<edgetpu::EdgeTpuManager::DeviceEnumerationRecord> all_tpus_;
+  static std::vector<std::shared_ptr<edgetpu::EdgeTpuContext>> open_tpus_;
   static size_t next_available_tpu_;
   std::string model_description_ = "No inferencing";
-  std::unique_ptr<tflite::FlatBufferModel> model_;
+  std::shared_ptr<tflite::FlatBufferModel> model_;
   size_t input_width_ = 1;
   size_t input_height_ = 1;
   size_t input_bytes_ = 1;
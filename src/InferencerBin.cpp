@@ -33,22 +33,12 @@
 #include "absl/strings/substitute.h"
 #include "InferencerBin.h"
 #include "ManufacturingInferencer.h"
+#include "MemfdAllocator.h"
 #include "PipelinedInferencer.h"
 #include "Utility.h"
+#include "VideoInfoCache.h"
 
 namespace szd {
-constexpr char InferencerBin::kSvgHeaderTemplate[] =
-    "<svg viewBox=\"0 0 $0 $1\">";
-constexpr char InferencerBin::kSvgFooter[] = "</svg>";
-constexpr char InferencerBin::kSvgBox[] =
-    "<rect x=\"$0\" y=\"$1\" width=\"$2\" height=\"$3\" "
-        "fill-opacity=\"0.0\" "
-        "style=\"stroke-width:2;stroke:rgb($4,$5,$6);\"/>";
-constexpr char InferencerBin::kSvgText[] =
-    "<text x=\"$0\" y=\"$1\" font-size=\"large\" fill=\"$2\">$3</text>";
-const std::string InferencerBin::kSvgHeader = absl::Substitute(
-    kSvgHeaderTemplate, kSvgWidth, kSvgHeight);
-
 std::string InferencerBin::MakeKeepOutSvg(Utility::Polygon keepout_polygon) {
   std::string polygon_svg;
   polygon_svg = "<polygon points=\"";
@@ -69,72 +59,52 @@ std::string InferencerBin::MakeKeepOutSvg(Utility::Polygon keepout_polygon) {
   return polygon_svg;
 }
 
-std::string InferencerBin::ResultsToSvg(
+const std::string& InferencerBin::ResultsToSvg(
     const std::vector<DetectionResult> &results) {
   static const int kMaxIntensity = 255;
-  std::string boxlist;
-  std::string labellist;
-  std::string svg;
 
+  svg_builder_.Begin();
   for (const auto &result : results) {
-    std::string box_str;
-    std::string label_str;
-    int w, h;
+    int x, y, w, h;
+    x = result.x1 * kSvgWidth;
+    y = result.y1 * kSvgHeight;
     w = (result.x2 - result.x1) * kSvgWidth;
     h = (result.y2 - result.y1) * kSvgHeight;
-    // Checks if this box collided with the keepout.
 
+    // Checks if this box collided with the keepout.
+    bool collided = false;
     if (!keepout_svg_.empty()) {
-      // Check for keepout.
       Utility::Box b { result.x1, result.y1, result.x2, result.y2 };
-      if (b.CollidedWithPolygon(keepout_polygon_, 1.0)) {
-        box_str = absl::Substitute(kSvgBox, result.x1 * kSvgWidth,
-                                   result.y1 * kSvgHeight, w, h, kMaxIntensity, 0, 0);  // Red
-        label_str = absl::Substitute(
-            kSvgText, result.x1 * kSvgWidth, (result.y1 * kSvgHeight) - 5,
-            "red", absl::StrCat(result.candidate, ": ", result.score));
-      } else {
-        box_str = absl::Substitute(kSvgBox, result.x1 * kSvgWidth,
-                                   result.y1 * kSvgHeight, w, h, 0, kMaxIntensity, 0);  // Green
-        label_str = absl::Substitute(
-            kSvgText, result.x1 * kSvgWidth, (result.y1 * kSvgHeight) - 5,
-            "lightgreen", absl::StrCat(result.candidate, ": ", result.score));
-      }
+      collided = b.CollidedWithPolygon(keepout_polygon_, 1.0);
+    }
+    if (collided) {
+      svg_builder_.AddBox(x, y, w, h, kMaxIntensity, 0, 0);  // Red
+      svg_builder_.AddLabel(x, y - 5, "red", result.candidate, result.score);
     } else {
-      // Don't check for keepout.
-      box_str = absl::Substitute(kSvgBox, result.x1 * kSvgWidth,
-                                 result.y1 * kSvgHeight, w, h, 0, kMaxIntensity, 0);  // Green
-      label_str = absl::Substitute(
-          kSvgText, result.x1 * kSvgWidth, (result.y1 * kSvgHeight) - 5,
-          "lightgreen", absl::StrCat(result.candidate, ": ", result.score));
+      svg_builder_.AddBox(x, y, w, h, 0, kMaxIntensity, 0);  // Green
+      svg_builder_.AddLabel(x, y - 5, "lightgreen", result.candidate,
+                            result.score);
     }
-    boxlist = absl::StrCat(boxlist, box_str);
-    labellist = absl::StrCat(labellist, label_str);
-
   }
-  svg = absl::StrCat(kSvgHeader, keepout_svg_, boxlist, labellist,
-		     kSvgFooter);
-
-  return svg;
+  return svg_builder_.Finish(keepout_svg_);
 }
 
 GstFlowReturn InferencerBin::AppsinkOnNewSample(GstElement *sink) {
   GstSample *sample = NULL;
   GstFlowReturn retval = GST_FLOW_OK;
-  std::shared_ptr<void> output_data;
-  std::string svg_string;
+  auto &metrics = metrics_[0];
 
   switch (auto type = inferencer_->GetInferencerType()) {
     case kPipelined:
-      // For pipelined inferencers, the frames are pulled by the DmaAllocator
-      // class in InferencerBin.h, and we always have to call Interpretframe
-      // otherwise the buffers won't be freed and we end up with a discrepancy
-      // between incoming frames and the video
-      inferencer_->InterpretFrame(nullptr, 0, tiled_video_width_,
-                                  tiled_video_height_, 0, output_data);
-      svg_string = ResultsToSvg(
-          *std::static_pointer_cast<std::vector<DetectionResult>>(output_data));
-      OutputInferenceResult(svg_string);
+      // The frames are handed to the TPU pipeline by FeedPipeline(), so the
+      // streaming thread never waits for the TPUs.
+      g_signal_emit_by_name(sink, "pull-sample", &sample);
+      if (!sample) {
+        g_error("Failed to pull appsink sample\n");
+        return GST_FLOW_ERROR;
+      }
+      TraceAppsinkSample(sample);
+      allocator_.PushSample(sample);
       break;
     case kSegmentation:
     case kManufacturing:
@@ -144,30 +114,38 @@ GstFlowReturn InferencerBin::AppsinkOnNewSample(GstElement *sink) {
         g_error("Failed to pull appsink sample\n");
         return GST_FLOW_ERROR;
       }
-      if (mixer_->DoInterpret(this)) {
-        GstMapInfo info;
-        auto buf = gst_sample_get_buffer(sample);
-        if (gst_buffer_map(buf, &info, GST_MAP_READ) == TRUE) {
-          auto meta = gst_buffer_get_video_meta(buf);
+      TraceAppsinkSample(sample);
+      if (DoInterpret()) {
+        // The segmentation mask is drawn over the whole frame so it can't be
+        // letterboxed.
+        if (PrepareInput(sample, preprocessor_, *inferencer_,
+                         letterbox_ && type != kSegmentation)) {
           // Pass the frame to the inferencer
-          inferencer_->InterpretFrame(info.data, info.size, meta->width,
-                                      meta->height, meta->stride[0],
-                                      output_data);
-          if (type == kSegmentation) {
-            auto segmentation_mask =
-                std::static_pointer_cast<std::vector<uint8_t>>(output_data);
-            OutputSegmentation(segmentation_mask);
-          } else {  // (type == kDetection || kManufacturing)
-            svg_string = ResultsToSvg(
-                *std::static_pointer_cast<std::vector<DetectionResult>>(
-                    output_data));
-            OutputInferenceResult(svg_string);
+          auto width = inferencer_->GetInputWidth();
+          auto &result = results_.GetWriteSlot();
+          auto start_ns = Tracer::Now();
+          inferencer_->InterpretFrame(inferencer_->GetInputTensor(),
+                                      inferencer_->GetInputBytes(), width,
+                                      inferencer_->GetInputHeight(), width * 3,
+                                      result);
+          metrics.latency->ObserveNs(Tracer::Now() - start_ns);
+          if (result.dropped) {
+            // Dropped by the TPU scheduler, the last results stay on screen.
+            metrics.dropped->Increment();
+          } else {
+            metrics.inferred->Increment();
+            if (type == kSegmentation) {
+              OutputSegmentation();
+            } else {  // (type == kDetection || kManufacturing)
+              OutputInferenceResult(ResultsToSvg(result.detections));
+            }
           }
-          gst_buffer_unmap(buf, &info);
         } else {
           g_error("Couldn't map buffer\n");
           retval = GST_FLOW_ERROR;
         }
+      } else {
+        metrics.skipped->Increment();
       }
       gst_sample_unref(sample);
       break;
@@ -182,7 +160,106 @@ GstFlowReturn InferencerBin::AppsinkOnNewSample(GstElement *sink) {
   return retval;
 }
 
-  void InferencerBin::SetFullScreenCaps(int src_pad) {
+void InferencerBin::FeedPipeline() {
+  auto &result = results_.GetWriteSlot();
+  Tracer::SetContext(trace_stream_, TraceContext::kNoPts);
+  ThreadPlacement::Enter(trace_stream_, ThreadPlacement::kInference);
+  while (allocator_.WaitForSample()) {
+    // For pipelined inferencers, the frames are taken from the DmaAllocator
+    // class in InferencerBin.h, which also fills in the pts of the trace
+    // context. The latency is recorded by the inferencer when the frame
+    // leaves the TPU pipeline.
+    inferencer_->InterpretFrame(nullptr, 0, tiled_video_width_,
+                                tiled_video_height_, 0, result);
+    // Only dropped when the pipeline isn't running, the frame wasn't
+    // pushed then.
+    if (!result.dropped) {
+      metrics_[0].inferred->Increment();
+      OutputInferenceResult(ResultsToSvg(result.detections));
+    }
+  }
+}
+
+std::string InferencerBin::MakeInputBranch(InferencerBase &inferencer) {
+  switch (inferencer.GetInferencerType()) {
+    case kDetection:
+    case kManufacturing:
+    case kSegmentation:
+    case kClassification:
+      return kYuvInputBranch;
+    default:
+      // The pipelined runner takes the appsink buffers as they are, so the
+      // frame has to be converted to the model input by GStreamer.
+      return absl::Substitute(kRgbInputBranch, inferencer.GetInputWidth(),
+                              inferencer.GetInputHeight());
+  }
+}
+
+bool InferencerBin::DoInterpret() {
+  if (!mixer_->DoInterpret(this)) {
+    return false;
+  }
+  return !rate_controller_ || rate_controller_->OnFrame();
+}
+
+void InferencerBin::TraceAppsinkSample(GstSample *sample) {
+  auto pts = TraceContext::kNoPts;
+  if (sample) {
+    pts = GST_BUFFER_PTS(gst_sample_get_buffer(sample));
+  }
+  Tracer::SetContext(trace_stream_, pts);
+  auto now = Tracer::Now();
+  Tracer::GetInstance().Record("appsink", now, now);
+}
+
+bool InferencerBin::MapYuvFrame(GstSample *sample, GstVideoFrame *frame,
+                                YuvImage *image) {
+  GstVideoInfo video_info;
+  if (!gst_video_info_from_caps(&video_info, gst_sample_get_caps(sample))
+      || !gst_video_frame_map(frame, &video_info, gst_sample_get_buffer(sample),
+                              GST_MAP_READ)) {
+    return false;
+  }
+
+  const bool nv12 = GST_VIDEO_INFO_FORMAT(&video_info) == GST_VIDEO_FORMAT_NV12;
+  image->y = static_cast<const uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(frame, 0));
+  image->u = static_cast<const uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(frame, 1));
+  image->v = nv12 ?
+      image->u + 1 :
+      static_cast<const uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(frame, 2));
+  image->width = GST_VIDEO_FRAME_WIDTH(frame);
+  image->height = GST_VIDEO_FRAME_HEIGHT(frame);
+  image->y_stride = GST_VIDEO_FRAME_PLANE_STRIDE(frame, 0);
+  image->uv_stride = GST_VIDEO_FRAME_PLANE_STRIDE(frame, 1);
+  image->uv_pixel_stride = nv12 ? 2 : 1;
+  image->bt709 = video_info.colorimetry.matrix == GST_VIDEO_COLOR_MATRIX_BT709;
+  return true;
+}
+
+void InferencerBin::PrepareInput(const YuvImage &image,
+                                 FramePreprocessor &preprocessor,
+                                 InferencerBase &inferencer, bool letterbox) {
+  TraceSpan span("pack_input");
+  inferencer.SetLetterbox(
+      preprocessor.Run(image, inferencer.GetInputTensor(),
+                       inferencer.GetInputWidth(), inferencer.GetInputHeight(),
+                       letterbox));
+}
+
+bool InferencerBin::PrepareInput(GstSample *sample,
+                                 FramePreprocessor &preprocessor,
+                                 InferencerBase &inferencer, bool letterbox) {
+  GstVideoFrame frame;
+  YuvImage image;
+  if (!MapYuvFrame(sample, &frame, &image)) {
+    return false;
+  }
+  PrepareInput(image, preprocessor, inferencer, letterbox);
+  gst_video_frame_unmap(&frame);
+  return true;
+}
+
+void InferencerBin::SetFullScreenCaps(int src_pad) {
     std::string caps = "video/x-raw(memory:GLMemory), width=$0, height=$1";
     caps = absl::Substitute(caps, fullscreen_video_width_,
                             fullscreen_video_height_);
@@ -199,35 +276,22 @@ void InferencerBin::SetTiledViewCaps(int src_pad) {
   fullscreen_ = false;
 }
 
-void InferencerBin::OutputInferenceResult(const std::string output) {
+void InferencerBin::OutputInferenceResult(const std::string &output) {
+  TraceSpan span("overlay");
   g_object_set(G_OBJECT(rsvg_overlay_), "data", output.c_str(), NULL);
 }
 
-void InferencerBin::OutputSegmentation(
-    std::shared_ptr<std::vector<uint8_t>> segmentation_mask) {
-  if (!segmentation_mask->empty()) {
-    segmentation_mask_ = segmentation_mask;
-  } else {
-    segmentation_mask_ = nullptr;
-  }
-
-}
-
-void InferencerBin::Rewind() {
-  gst_element_seek(decoder_, 1.0, GST_FORMAT_TIME, GST_SEEK_FLAG_SEGMENT,
-                   GST_SEEK_TYPE_SET, 0, GST_SEEK_TYPE_NONE, 0);
+void InferencerBin::OutputSegmentation() {
+  TraceSpan span("overlay");
+  // The GL thread draws the latest mask from now on.
+  results_.Publish();
 }
 
 GstPadProbeReturn InferencerBin::QueueSinkPadCallback(GstPad *pad,
                                                       GstPadProbeInfo *info) {
+  // Looping is handled by the SourceBin feeding this bin.
   auto event = gst_pad_probe_info_get_event(info);
-  if (GST_EVENT_TYPE(event) == GST_EVENT_SEGMENT_DONE) {
-    g_idle_add(reinterpret_cast<GSourceFunc>(+[](InferencerBin *self) -> int {
-      self->Rewind();
-      return 0;
-    }),
-               this);
-  } else if (GST_EVENT_TYPE(event) == GST_EVENT_RECONFIGURE) {
+  if (GST_EVENT_TYPE(event) == GST_EVENT_RECONFIGURE) {
     return GST_PAD_PROBE_DROP;
   }
   return GST_PAD_PROBE_PASS;
@@ -258,7 +322,8 @@ gboolean InferencerBin::OnClientDraw(GstElement *filter, GLuint in_tex,
   static const unsigned int OVERLAY_W = inferencer_->GetInputWidth();
   static const unsigned int OVERLAY_H = inferencer_->GetInputHeight();
   static const unsigned int OVERLAY_PX_BYTES = OVERLAY_W * OVERLAY_H;
-  if (segmentation_mask_ && segmentation_mask_->size() == OVERLAY_PX_BYTES) {
+  const auto &segmentation_mask = results_.Read().segmentation_mask;
+  if (segmentation_mask.size() == OVERLAY_PX_BYTES) {
     GstGLContext *context = GST_GL_BASE_FILTER (filter)->context;
     const GstGLFuncs *gl = context->gl_vtable;
 
@@ -315,7 +380,7 @@ gboolean InferencerBin::OnClientDraw(GstElement *filter, GLuint in_tex,
     gl->PixelStorei(GL_UNPACK_ALIGNMENT, 1);
     gl->TexImage2D(GL_TEXTURE_2D, 0, GL_R8, OVERLAY_W, OVERLAY_H, 0, GL_RED,
     GL_UNSIGNED_BYTE,
-                   segmentation_mask_->data());
+                   segmentation_mask.data());
     // Draw the overlay texture.
     gl->ActiveTexture(GL_TEXTURE0);
     gl->BindTexture(GL_TEXTURE_2D, o_tex);
@@ -330,22 +395,9 @@ gboolean InferencerBin::OnClientDraw(GstElement *filter, GLuint in_tex,
 }
 
 void InferencerBin::SetupAllDims(std::string video_file) {
-  char dir[FILENAME_MAX];
-  auto uri = absl::StrCat("file:///", getcwd(dir,FILENAME_MAX), "/" ,video_file);
-
-  auto discoverer = gst_discoverer_new(GST_SECOND * 10, nullptr);
-  auto info = gst_discoverer_discover_uri(discoverer, uri.c_str(), nullptr);
-  auto streaminfo = gst_discoverer_info_get_video_streams(info);
-
-  int video_file_width = gst_discoverer_video_info_get_width(
-      GST_DISCOVERER_VIDEO_INFO(streaminfo->data));
-  int video_file_height = gst_discoverer_video_info_get_height(
-      GST_DISCOVERER_VIDEO_INFO(streaminfo->data));
-  auto par_denom = gst_discoverer_video_info_get_par_denom(
-      GST_DISCOVERER_VIDEO_INFO(streaminfo->data));
-  auto par_num = gst_discoverer_video_info_get_par_num(
-      GST_DISCOVERER_VIDEO_INFO(streaminfo->data));
-  video_file_height = video_file_height * par_denom / par_num;
+  auto info = VideoInfoCache::GetInstance().Get(video_file);
+  int video_file_width = info.width;
+  int video_file_height = info.height;
 
   GstVideoRectangle s_rect = { 0, 0, video_file_width, video_file_height };
   GstVideoRectangle d_rect = { 0, 0, TILE_WIDTH, TILE_HEIGHT };
@@ -369,19 +421,16 @@ void InferencerBin::SetupAllDims(std::string video_file) {
 
 void InferencerBin::SetupBin(std::string bin_src, std::string video_file) {
   ParseBin(bin_src);
-  auto source = gst_element_factory_make("filesrc", "source");
-  g_object_set(G_OBJECT(source), "location", video_file.c_str(), NULL);
-
-  gst_bin_add(GST_BIN(bin_), source);
-
-  decoder_ = gst_bin_get_by_name(GST_BIN(bin_), "decoder");
-  gst_element_link(source, decoder_);
+  video_file_ = video_file;
 
   filter_0_ = gst_bin_get_by_name(GST_BIN(bin_), "filter_0");
 
-  // setup pad probe for enabling looping of videos
+  // The decoded frames come from a SourceBin shared by all bins showing the
+  // same video, see SourceRegistry.
   auto q = gst_bin_get_by_name(GST_BIN(bin_), "q");
   auto sink_pad_queue = gst_element_get_static_pad(q, "sink");
+  auto sink_pad = gst_ghost_pad_new("inf_bin_sink", sink_pad_queue);
+  gst_element_add_pad(bin_, sink_pad);
   gst_pad_add_probe(
       sink_pad_queue,
       static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM
@@ -392,6 +441,31 @@ void InferencerBin::SetupBin(std::string bin_src, std::string video_file) {
         return self->QueueSinkPadCallback(pad, info);
       }),
       this, NULL);
+
+  trace_stream_ = Tracer::GetInstance().RegisterStream(video_file);
+  metric_labels_ = absl::Substitute("stream=\"$0\",file=\"$1\"",
+                                    trace_stream_, video_file);
+  decoded_ = MetricsRegistry::GetInstance().GetCounter(
+      "frames_decoded_total", "Decoded frames that reached the stream.",
+      metric_labels_);
+  AddQueueLevelMetric("q");
+  // Counts, and when tracing marks, each decoded frame reaching this bin.
+  gst_pad_add_probe(
+      sink_pad_queue,
+      GST_PAD_PROBE_TYPE_BUFFER,
+      reinterpret_cast<GstPadProbeCallback>(+[](
+          GstPad *pad, GstPadProbeInfo *info,
+          InferencerBin *self) -> GstPadProbeReturn {
+        self->decoded_->Increment();
+        if (Tracer::GetInstance().IsEnabled()) {
+          auto now = Tracer::Now();
+          Tracer::GetInstance().Record(
+              "decoded", self->trace_stream_,
+              GST_BUFFER_PTS(gst_pad_probe_info_get_buffer(info)), now, now);
+        }
+        return GST_PAD_PROBE_OK;
+      }),
+      this, NULL);
   gst_object_unref(sink_pad_queue);
   gst_object_unref(q);
 
@@ -402,17 +476,74 @@ void InferencerBin::SetupBin(std::string bin_src, std::string video_file) {
 
 }
 
+void InferencerBin::SetupMetrics(int index, InferencerBase &inferencer) {
+  auto &registry = MetricsRegistry::GetInstance();
+  auto model = inferencer.GetModelDescription();
+  auto labels = absl::StrCat(metric_labels_, ",model=\"",
+                             model.substr(0, model.find('\n')), "\"");
+  StreamMetrics metrics;
+  metrics.inferred = registry.GetCounter("frames_inferred_total",
+                                         "Frames passed to the model.", labels);
+  metrics.skipped = registry.GetCounter(
+      "frames_skipped_total",
+      "Frames not inferred while the stream is hidden or to keep it at its "
+      "target rate.",
+      labels);
+  metrics.dropped = registry.GetCounter(
+      "frames_dropped_total",
+      "Frames dropped because the model couldn't keep up.", labels);
+  metrics.latency = registry.GetLatencyHistogram(
+      "inference_latency_seconds", "Time from input to model results.",
+      labels);
+  metrics_.push_back(metrics);
+  inferencer.SetupMetrics(labels);
+  if (index == 0) {
+    rate_controller_ = std::make_unique<RateController>(
+        labels, metrics.latency, metrics.dropped, inferencer.GetTpuBusy());
+  }
+
+  // A leaky queue overruns right before it drops its oldest frame. Stages
+  // fed from another stage's frame have no queue of their own.
+  auto queue_name = absl::StrCat("appq_", index);
+  auto queue = gst_bin_get_by_name(GST_BIN(bin_), queue_name.c_str());
+  if (!queue) {
+    return;
+  }
+  g_signal_connect(queue, "overrun",
+                   reinterpret_cast<GCallback>(+[](GstElement *queue,
+                                                   Counter *dropped) {
+                     dropped->Increment();
+                   }),
+                   metrics.dropped);
+  gst_object_unref(queue);
+  AddQueueLevelMetric(queue_name);
+}
+
+void InferencerBin::AddQueueLevelMetric(const std::string &queue_name) {
+  // The registry outlives the bins, so it keeps its own reference.
+  auto queue = gst_bin_get_by_name(GST_BIN(bin_), queue_name.c_str());
+  MetricsRegistry::GetInstance().AddCallbackGauge(
+      "queue_level_buffers", "Buffers waiting in the queue.",
+      absl::StrCat(metric_labels_, ",queue=\"", queue_name, "\""),
+      [queue]() -> double {
+        guint level;
+        g_object_get(G_OBJECT(queue), "current-level-buffers", &level, NULL);
+        return level;
+      });
+}
+
 InferencerBin::InferencerBin(std::shared_ptr<InferencerBase> inferencer,
                              std::string video_file)
     :
-    inferencer_(inferencer) {
+    inferencer_(inferencer),
+    svg_builder_(kSvgWidth, kSvgHeight) {
 
   SetupAllDims(video_file);
   auto bin_src = absl::Substitute(inferencer_bin_src_, tiled_video_width_,
                                   tiled_video_height_,
-                                  inferencer_->GetInputWidth(),
-                                  inferencer_->GetInputHeight());
+                                  MakeInputBranch(*inferencer_));
   SetupBin(bin_src, video_file);
+  SetupMetrics(0, *inferencer_);
 
   // Setup the appsink
   auto appsink = gst_bin_get_by_name(GST_BIN(bin_), "appsink_0");
@@ -431,11 +562,17 @@ InferencerBin::InferencerBin(std::shared_ptr<InferencerBase> inferencer,
   // Setup callbacks etc for non-trivial inferencers
   switch (inferencer_->GetInferencerType()) {
     case kPipelined: {
-      allocator_.UpdateAppSink(appsink);
-      inferencer_->InitializePipelineRunner(
-          &allocator_, [this](const std::string output) {
-            this->OutputInferenceResult(output);
-          });
+      allocator_.SetDroppedCounter(metrics_[0].dropped);
+      // Frames with an fd can be mapped by the runner without gst_buffer_map.
+      MemfdAllocator::ProvideBufferPool(appsink, kMinPipelinedBuffers);
+      allocator_.SetMapLatency(
+          MetricsRegistry::GetInstance().GetLatencyHistogram(
+              "dma_map_seconds", "Time to map a frame for the TPU pipeline.",
+              metric_labels_));
+      inferencer_->InitializePipelineRunner(&allocator_);
+      pipeline_feeder_ = std::thread([this] {
+        FeedPipeline();
+      });
       break;
     }
     case kManufacturing: {
@@ -467,8 +604,12 @@ InferencerBin::InferencerBin(std::shared_ptr<InferencerBase> inferencer,
 }
 
 InferencerBin::~InferencerBin() {
+  // Wakes the feeder if it waits for a sample that won't come.
+  allocator_.Stop();
+  if (pipeline_feeder_.joinable()) {
+    pipeline_feeder_.join();
+  }
   gst_object_unref(filter_0_);
-  gst_object_unref(decoder_);
   gst_object_unref(rsvg_overlay_);
   gst_object_unref(text_overlay_0_);
 }
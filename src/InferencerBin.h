@@ -23,123 +23,120 @@
 #ifndef INFERENCERBIN_H_
 #define INFERENCERBIN_H_
 
+#include <array>
+#include <memory>
+#include <thread>
+#include <vector>
+
 #include <gst/allocators/gstdmabuf.h>
+#include <gst/allocators/gstfdmemory.h>
 #include <gst/gl/gstglfilter.h>
 #include <gst/gl/gstglfuncs.h>
 #include <gst/gst.h>
+#include <gst/video/video.h>
 #include <sys/mman.h>
+#include <unistd.h>
 
+#include "absl/synchronization/mutex.h"
 #include "coral/pipeline/pipelined_model_runner.h"
 
 #include "Bin.h"
 #include "DetectionInferencer.h"
+#include "FramePreprocessor.h"
 #include "InferencerBase.h"
+#include "Metrics.h"
 #include "MixerBin.h"
+#include "RateController.h"
+#include "SvgBuilder.h"
+#include "ThreadPlacement.h"
+#include "Tracer.h"
 #include "Utility.h"
 
 namespace szd {
   const std::string kInferencerBinSrc =
-      "decodebin name=decoder ! queue name=q ! videoconvert ! videoscale ! tee name=t "
+      "queue name=q ! videoconvert ! videoscale ! tee name=t "
           "t. ! queue ! videoconvert ! "
           "rsvgoverlay fit-to-frame=true name=rsvg_0 ! textoverlay name=text_0 ! videoconvert ! video/x-raw,format=RGBA,width=$0,height=$1 ! "
           "glupload ! glfilterapp name=segmask ! capsfilter name=filter_0 caps=video/x-raw(memory:GLMemory),width=$0,height=$1 "
-          "t. ! videoconvert ! videoscale ! video/x-raw,width=$2,height=$3,format=RGB ! "
-          "queue leaky=downstream max-size-buffers=1 ! appsink name=appsink_0";
+          "t. ! $2 ! "
+          "queue name=appq_0 leaky=downstream max-size-buffers=1 ! appsink name=appsink_0";
 
-class InferencerBin : public Bin {
- public:
-  InferencerBin(std::shared_ptr<InferencerBase> inferencer,
-                std::string video_file);
-  InferencerBin(InferencerBin &&other) = delete;
-  InferencerBin& operator=(const InferencerBin &other) = delete;
-  InferencerBin& operator=(InferencerBin &&other) = delete;
-  virtual ~InferencerBin();
-
-  void Rewind();
-
- protected:
-  // This constructor needed by TwoModelInferencer child class
-  InferencerBin(std::shared_ptr<InferencerBase> inferencer)
-      :
-      inferencer_(inferencer) {
-  }
-  std::string ResultsToSvg(const std::vector<DetectionResult> &results);
-  void OutputInferenceResult(const std::string output);
-  void SetupAllDims(std::string video_file);
-  void SetupBin(std::string bin_src, std::string video_file);
-
-  std::shared_ptr<InferencerBase> inferencer_;
-  GstElement *filter_0_;
-  GstElement *rsvg_overlay_;
-  GstElement *text_overlay_0_;
-  int tiled_video_x_;
-  int tiled_video_y_;
-  int tiled_video_width_;
-  int tiled_video_height_;
-  int fullscreen_video_x_;
-  int fullscreen_video_y_;
-  int fullscreen_video_width_;
-  int fullscreen_video_height_;
-  bool fullscreen_ = false;
-  size_t num_src_pads_ = 0;
-  class MixerBin *mixer_;
+  // Branches feeding an appsink, see InferencerBin::MakeInputBranch().
+  const std::string kRgbInputBranch =
+      "videoconvert ! videoscale ! video/x-raw,width=$0,height=$1,format=RGB";
+  const std::string kYuvInputBranch = "video/x-raw,format=(string){NV12,I420}";
 
+class InferencerBin : public Bin {
  private:
-  const std::string inferencer_bin_src_ = kInferencerBinSrc;
-  static const int kSvgWidth = TILE_WIDTH;
-  static const int kSvgHeight = TILE_HEIGHT;
-  static const char kSvgHeaderTemplate[];
-  static const char kSvgFooter[];
-  static const char kSvgBox[];
-  static const char kSvgText[];
-  static const std::string kSvgHeader;
-
   // DmaBuffer and DmaBufferAllocator are helper classes for pipelined inferencer integration
   class DmaAllocator;
   class DmaBuffer : public coral::Buffer {
    public:
-    DmaBuffer(GstSample *sample, size_t requested_bytes)
-        :
-        sample_(CHECK_NOTNULL(sample)),
-        requested_bytes_(requested_bytes) {
-    }
+    DmaBuffer() = default;
 
-    // For cases where we can't use DMABuf (like most x64 systems), return the
-    // sample. This allows the pipeline runner to see there is no file descriptor
-    // and instead rely on inefficient CPU mapping. Ideally this can optimized in
-    // the future.
+    // Frames with an fd return nullptr, so the pipeline runner maps them
+    // with MapToHost() instead. For cases where we can't use an fd, return
+    // the mapped sample, mapped once and unmapped when freed.
     void* ptr() override {
-      GstMapInfo info;
-      GstBuffer *buffer = CHECK_NOTNULL(gst_sample_get_buffer(sample_));
-      CHECK(gst_buffer_map(buffer, &info, GST_MAP_READ));
-      data_ = reinterpret_cast<void*>(info.data);
+      if (fd() >= 0) {
+        return nullptr;
+      }
+      if (!data_) {
+        TraceSpan span("map");
+        auto start_ns = Tracer::Now();
+        GstBuffer *buffer = CHECK_NOTNULL(gst_sample_get_buffer(sample_));
+        CHECK(gst_buffer_map(buffer, &map_info_, GST_MAP_READ));
+        data_ = reinterpret_cast<void*>(map_info_.data);
+        if (map_latency_) {
+          map_latency_->ObserveNs(Tracer::Now() - start_ns);
+        }
+      }
       return data_;
     }
 
     void* MapToHost() override {
-      if (!handle_) {
-        handle_ = mmap(nullptr, requested_bytes_, PROT_READ, MAP_PRIVATE, fd(),
-        /*offset=*/0);
+      if (!handle_ && fd() >= 0) {
+        TraceSpan span("map");
+        auto start_ns = Tracer::Now();
+        // The frame starts offset bytes into the fd, past the prefix of the
+        // memory. mmap wants a page aligned offset, so the mapping starts at
+        // the page holding the frame.
+        GstBuffer *buf = gst_sample_get_buffer(sample_);
+        const size_t offset = gst_buffer_peek_memory(buf, 0)->offset;
+        const size_t page_size = sysconf(_SC_PAGESIZE);
+        handle_offset_ = offset % page_size;
+        handle_bytes_ = handle_offset_ + requested_bytes_;
+        handle_ = mmap(nullptr, handle_bytes_, PROT_READ, MAP_PRIVATE, fd(),
+                       offset - handle_offset_);
         if (handle_ == MAP_FAILED) {
           handle_ = nullptr;
         }
+        if (map_latency_) {
+          map_latency_->ObserveNs(Tracer::Now() - start_ns);
+        }
       }
-      return handle_;
+      return handle_ ? static_cast<uint8_t*>(handle_) + handle_offset_ :
+          nullptr;
     }
 
     bool UnmapFromHost() override {
-      if (munmap(handle_, requested_bytes_) != 0) {
+      if (!handle_) {
+        return true;
+      }
+      if (munmap(handle_, handle_bytes_) != 0) {
         return false;
       }
+      handle_ = nullptr;
       return true;
     }
 
+    // Valid for dmabufs and for the memfd frames of MemfdAllocator.
     int fd() {
       if (fd_ == -1) {
         GstBuffer *buf = CHECK_NOTNULL(gst_sample_get_buffer(sample_));
         GstMemory *mem = gst_buffer_peek_memory(buf, 0);
-        if (gst_is_dmabuf_memory(mem)) {
-          fd_ = gst_dmabuf_memory_get_fd(mem);
+        if (gst_buffer_n_memory(buf) == 1 && gst_is_fd_memory(mem)) {
+          fd_ = gst_fd_memory_get_fd(mem);
         }
       }
       return fd_;
@@ -147,57 +144,285 @@ class InferencerBin : public Bin {
 
    private:
     friend class DmaAllocator;
+    // Takes ownership of sample.
+    void Reset(GstSample *sample, size_t requested_bytes,
+               Histogram *map_latency) {
+      sample_ = CHECK_NOTNULL(sample);
+      requested_bytes_ = requested_bytes;
+      map_latency_ = map_latency;
+    }
+    // Releases the mappings and the sample so the buffer can be reused.
+    void Release() {
+      UnmapFromHost();
+      if (data_) {
+        gst_buffer_unmap(gst_sample_get_buffer(sample_), &map_info_);
+        data_ = nullptr;
+      }
+      if (sample_) {
+        gst_sample_unref(sample_);
+        sample_ = nullptr;
+      }
+      fd_ = -1;
+    }
+
     GstSample *sample_ = nullptr;
     size_t requested_bytes_ = 0;
+    Histogram *map_latency_ = nullptr;
 
     // DMA Buffer variables
     int fd_ = -1;
     void *handle_ = nullptr;
+    size_t handle_offset_ = 0;
+    size_t handle_bytes_ = 0;
 
     // Legacy CPU variables
     void *data_ = nullptr;
+    GstMapInfo map_info_;
 
   };
 
+  // Hands out DmaBuffers from a free list. The runner holds at most a few
+  // frames, so the list only grows past kInitialBuffers if it falls behind.
+  // The appsink samples are collected in a small ring as they arrive so
+  // Alloc() never waits for the appsink.
   class DmaAllocator : public coral::Allocator {
    public:
-    DmaAllocator() = default;
-    DmaAllocator(GstElement *sink)
-        :
-        sink_(CHECK_NOTNULL(sink)) {
+    DmaAllocator() {
+      for (size_t i = 0; i < kInitialBuffers; ++i) {
+        buffers_.push_back(std::make_unique<DmaBuffer>());
+        free_buffers_.push_back(buffers_.back().get());
+      }
+    }
+    ~DmaAllocator() {
+      Stop();
+      while (num_samples_ > 0) {
+        gst_sample_unref(PopSample());
+      }
     }
 
+    // Must only be called after WaitForSample() returned true.
     coral::Buffer* Alloc(size_t size_bytes) override {
       GstSample *sample;
-      g_signal_emit_by_name(sink_, "pull-sample", &sample);
-      return new DmaBuffer(sample, size_bytes);
+      DmaBuffer *buffer;
+      {
+        absl::MutexLock lock(&mutex_);
+        CHECK_GT(num_samples_, 0);
+        sample = PopSample();
+        if (free_buffers_.empty()) {
+          buffers_.push_back(std::make_unique<DmaBuffer>());
+          free_buffers_.push_back(buffers_.back().get());
+        }
+        buffer = free_buffers_.back();
+        free_buffers_.pop_back();
+      }
+      if (auto *gst_buffer = gst_sample_get_buffer(sample)) {
+        Tracer::SetContextPts(GST_BUFFER_PTS(gst_buffer));
+      }
+      buffer->Reset(sample, size_bytes, map_latency_);
+      return buffer;
     }
 
     void Free(coral::Buffer *buffer) override {
-      auto *sample = static_cast<DmaBuffer*>(buffer)->sample_;
-      if (sample) {
-        gst_sample_unref(sample);
+      auto *dma_buffer = static_cast<DmaBuffer*>(buffer);
+      dma_buffer->Release();
+      absl::MutexLock lock(&mutex_);
+      free_buffers_.push_back(dma_buffer);
+    }
+
+    // Takes ownership of sample. When the ring is full its oldest sample is
+    // dropped, the TPUs should always get the latest frame.
+    void PushSample(GstSample *sample) {
+      if (!sample) {
+        return;
       }
+      absl::MutexLock lock(&mutex_);
+      if (num_samples_ == kRingSize) {
+        gst_sample_unref(PopSample());
+        if (dropped_) {
+          dropped_->Increment();
+        }
+      }
+      samples_[(head_ + num_samples_) % kRingSize] = sample;
+      num_samples_++;
+      cond_.Signal();
+    }
+
+    // Blocks until Alloc() has a sample to return, returns false once
+    // stopped.
+    bool WaitForSample() {
+      absl::MutexLock lock(&mutex_);
+      while (!stopped_ && num_samples_ == 0) {
+        cond_.Wait(&mutex_);
+      }
+      return !stopped_;
+    }
 
-      delete buffer;
+    void Stop() {
+      absl::MutexLock lock(&mutex_);
+      stopped_ = true;
+      cond_.SignalAll();
     }
 
-    void UpdateAppSink(GstElement *sink) {
-      CHECK_NOTNULL(sink);
-      sink_ = sink;
+    // Counts the samples dropped from the ring.
+    void SetDroppedCounter(Counter *dropped) {
+      dropped_ = dropped;
+    }
+    // Records how long mapping each frame for the runner takes.
+    void SetMapLatency(Histogram *map_latency) {
+      map_latency_ = map_latency;
     }
 
    private:
-    GstElement *sink_ = nullptr;
+    static const size_t kInitialBuffers = 8;
+    static const size_t kRingSize = 2;
+
+    GstSample* PopSample() {
+      auto *sample = samples_[head_];
+      head_ = (head_ + 1) % kRingSize;
+      num_samples_--;
+      return sample;
+    }
+
+    Histogram *map_latency_ = nullptr;
+    Counter *dropped_ = nullptr;
+    absl::Mutex mutex_;
+    absl::CondVar cond_;
+    std::vector<std::unique_ptr<DmaBuffer>> buffers_;
+    std::vector<DmaBuffer*> free_buffers_;
+    std::array<GstSample*, kRingSize> samples_;
+    size_t head_ = 0;
+    size_t num_samples_ = 0;
+    bool stopped_ = false;
+  };
+
+  // Declared before inferencer_ so it is destroyed after it. The consumer
+  // thread of a pipelined inferencer frees the frames back to the allocator
+  // until the inferencer joins it.
+  DmaAllocator allocator_;
+
+ public:
+  InferencerBin(std::shared_ptr<InferencerBase> inferencer,
+                std::string video_file);
+  InferencerBin(InferencerBin &&other) = delete;
+  InferencerBin& operator=(const InferencerBin &other) = delete;
+  InferencerBin& operator=(InferencerBin &&other) = delete;
+  virtual ~InferencerBin();
+
+  const std::string& GetVideoFile() {
+    return video_file_;
+  }
+  int GetTraceStream() {
+    return trace_stream_;
+  }
+  std::string GetTpuPath() {
+    return inferencer_->GetTpuPath();
+  }
+  // Keep the aspect ratio of the frame when scaling it to the detection
+  // model input. Must be set before the pipeline starts.
+  void SetLetterbox(bool letterbox) {
+    letterbox_ = letterbox;
+  }
+  // An element showing frames of the stream dropped or was late with one.
+  void ReportQos() {
+    if (rate_controller_) {
+      rate_controller_->ReportQos();
+    }
+  }
+
+ protected:
+  // For the bins that build their own branches, see CascadeInferencerBin.
+  InferencerBin(std::shared_ptr<InferencerBase> inferencer)
+      :
+      inferencer_(inferencer),
+      svg_builder_(kSvgWidth, kSvgHeight) {
+  }
+  // Returns a reference to the svg for this frame, valid until the next call.
+  const std::string& ResultsToSvg(const std::vector<DetectionResult> &results);
+  void OutputInferenceResult(const std::string &output);
+  // Returns the caps or elements between the tee and the appsink for this
+  // inferencer. Most inferencers get the decoded YUV frame and convert it
+  // themselves with PrepareInput().
+  static std::string MakeInputBranch(InferencerBase &inferencer);
+  // Maps the YUV frame in sample for reading and describes it in image.
+  // Unmap frame with gst_video_frame_unmap() when done.
+  static bool MapYuvFrame(GstSample *sample, GstVideoFrame *frame,
+                          YuvImage *image);
+  // Converts and scales image straight into the input tensor of inferencer
+  // and records the letterbox.
+  static void PrepareInput(const YuvImage &image,
+                           FramePreprocessor &preprocessor,
+                           InferencerBase &inferencer, bool letterbox);
+  // Same for the YUV frame in sample. Returns false if the frame couldn't be
+  // mapped.
+  static bool PrepareInput(GstSample *sample, FramePreprocessor &preprocessor,
+                           InferencerBase &inferencer, bool letterbox);
+  // Whether to infer the frame that just reached the appsink, not while
+  // another stream is full screen and only as often as the rate controller
+  // wants.
+  bool DoInterpret();
+  // Sets the trace context of the streaming thread to this stream and the
+  // sample's pts and records its arrival.
+  void TraceAppsinkSample(GstSample *sample);
+  void SetupAllDims(std::string video_file);
+  void SetupBin(std::string bin_src, std::string video_file);
+  // Registers the metrics of the branch ending in appsink_<index>, whose
+  // leaky queue appq_<index> drops the frames inferencer can't keep up with.
+  void SetupMetrics(int index, InferencerBase &inferencer);
+  // Exports the fill level of the named queue in the bin.
+  void AddQueueLevelMetric(const std::string &queue_name);
+
+  std::shared_ptr<InferencerBase> inferencer_;
+  std::string video_file_;
+  int trace_stream_ = -1;
+  // Counters of an appsink branch, see SetupMetrics().
+  struct StreamMetrics {
+    Counter *inferred;
+    Counter *skipped;
+    Counter *dropped;
+    Histogram *latency;
   };
+  std::string metric_labels_;
+  Counter *decoded_ = nullptr;
+  std::vector<StreamMetrics> metrics_;
+  // Paces the inferences of the first appsink branch.
+  std::unique_ptr<RateController> rate_controller_;
+  GstElement *filter_0_;
+  GstElement *rsvg_overlay_;
+  GstElement *text_overlay_0_;
+  int tiled_video_x_;
+  int tiled_video_y_;
+  int tiled_video_width_;
+  int tiled_video_height_;
+  int fullscreen_video_x_;
+  int fullscreen_video_y_;
+  int fullscreen_video_width_;
+  int fullscreen_video_height_;
+  bool fullscreen_ = false;
+  size_t num_src_pads_ = 0;
+  class MixerBin *mixer_;
+  FramePreprocessor preprocessor_;
+  bool letterbox_ = false;
+
+ private:
+  const std::string inferencer_bin_src_ = kInferencerBinSrc;
+  static const int kSvgWidth = TILE_WIDTH;
+  static const int kSvgHeight = TILE_HEIGHT;
+  // Frames held by the leaky queue, the appsink and the TPU pipeline.
+  static const guint kMinPipelinedBuffers = 8;
+
+  // Hands the samples collected by the allocator to the TPU pipeline until
+  // the allocator is stopped.
+  void FeedPipeline();
 
   virtual GstFlowReturn AppsinkOnNewSample(GstElement *sink);
   GstPadProbeReturn QueueSinkPadCallback(GstPad *pad, GstPadProbeInfo *info);
-  void OutputSegmentation(
-      const std::shared_ptr<std::vector<uint8_t>> segmentation_mask);
+  // Hands the mask in the write slot of results_ to OnClientDraw().
+  void OutputSegmentation();
   virtual void SetFullScreenCaps(int src_pad);
   virtual void SetTiledViewCaps(int src_pad);
-  std::shared_ptr<std::vector<uint8_t>> segmentation_mask_ = nullptr;
+  // Written by the streaming thread, or FeedPipeline() for pipelined
+  // inferencers, the latest segmentation mask is read by the GL thread.
+  TripleBuffer<InferenceResult> results_;
   gboolean OnClientDraw(GstElement *filter, GLuint in_tex, GLuint width,
                         GLuint height, gpointer data);
   std::string MakeKeepOutSvg(Utility::Polygon keepout_polygon);
@@ -205,10 +430,10 @@ class InferencerBin : public Bin {
     return num_src_pads_;
   }
 
-  GstElement *decoder_;
-  DmaAllocator allocator_;
+  std::thread pipeline_feeder_;
   Utility::Polygon keepout_polygon_;
   std::string keepout_svg_ = "";
+  SvgBuilder svg_builder_;
   GstGLShader *shader_ = nullptr;
   friend class MixerBin;
 };
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * MemfdAllocator.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <gst/allocators/gstfdmemory.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "MemfdAllocator.h"
+
+typedef struct {
+  GstFdAllocator parent;
+} SzdMemfdAllocator;
+
+typedef struct {
+  GstFdAllocatorClass parent_class;
+} SzdMemfdAllocatorClass;
+
+G_DEFINE_TYPE(SzdMemfdAllocator, szd_memfd_allocator, GST_TYPE_FD_ALLOCATOR);
+
+static GstMemory* szd_memfd_allocator_alloc(GstAllocator *allocator,
+                                            gsize size,
+                                            GstAllocationParams *params) {
+  const gsize maxsize = size + params->prefix + params->padding;
+  int fd = memfd_create("szd-frame", MFD_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  if (ftruncate(fd, maxsize) != 0) {
+    close(fd);
+    return nullptr;
+  }
+  // The memory owns the fd and closes it when freed.
+  auto *memory = gst_fd_allocator_alloc(allocator, fd, maxsize,
+                                        GST_FD_MEMORY_FLAG_NONE);
+  gst_memory_resize(memory, params->prefix, size);
+  return memory;
+}
+
+static void szd_memfd_allocator_class_init(SzdMemfdAllocatorClass *klass) {
+  GST_ALLOCATOR_CLASS(klass)->alloc = szd_memfd_allocator_alloc;
+}
+
+static void szd_memfd_allocator_init(SzdMemfdAllocator *self) {
+  GST_ALLOCATOR(self)->mem_type = "memfd";
+  GST_OBJECT_FLAG_SET(self, GST_ALLOCATOR_FLAG_CUSTOM_ALLOC);
+}
+
+namespace szd {
+
+GstAllocator* MemfdAllocator::Get() {
+  static GstAllocator *allocator = GST_ALLOCATOR(
+      gst_object_ref_sink(g_object_new(szd_memfd_allocator_get_type(), NULL)));
+  return allocator;
+}
+
+GstPadProbeReturn MemfdAllocator::OnAllocationQuery(GstPad *pad,
+                                                    GstPadProbeInfo *info,
+                                                    guint min_buffers) {
+  auto query = gst_pad_probe_info_get_query(info);
+  if (GST_QUERY_TYPE(query) != GST_QUERY_ALLOCATION
+      || gst_query_get_n_allocation_pools(query) > 0) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  GstCaps *caps;
+  gboolean need_pool;
+  GstVideoInfo video_info;
+  gst_query_parse_allocation(query, &caps, &need_pool);
+  if (!caps || !gst_video_info_from_caps(&video_info, caps)) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  // The pool is shared with the upstream element through the query, which
+  // keeps it alive.
+  const guint size = GST_VIDEO_INFO_SIZE(&video_info);
+  auto pool = gst_buffer_pool_new();
+  auto config = gst_buffer_pool_get_config(pool);
+  gst_buffer_pool_config_set_params(config, caps, size, min_buffers, 0);
+  gst_buffer_pool_config_set_allocator(config, Get(), NULL);
+  if (!gst_buffer_pool_set_config(pool, config)) {
+    g_printerr("Failed to configure the memfd buffer pool\n");
+    gst_object_unref(pool);
+    return GST_PAD_PROBE_OK;
+  }
+  gst_query_add_allocation_pool(query, pool, size, min_buffers, 0);
+  gst_query_add_allocation_param(query, Get(), NULL);
+  gst_object_unref(pool);
+  return GST_PAD_PROBE_OK;
+}
+
+void MemfdAllocator::ProvideBufferPool(GstElement *sink, guint min_buffers) {
+  auto sink_pad = gst_element_get_static_pad(sink, "sink");
+  gst_pad_add_probe(
+      sink_pad,
+      static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM
+          | GST_PAD_PROBE_TYPE_PUSH),
+      reinterpret_cast<GstPadProbeCallback>(+[](GstPad *pad,
+                                                GstPadProbeInfo *info,
+                                                gpointer min_buffers) {
+        return OnAllocationQuery(pad, info, GPOINTER_TO_UINT(min_buffers));
+      }),
+      GUINT_TO_POINTER(min_buffers), NULL);
+  gst_object_unref(sink_pad);
+}
+
+} /* namespace szd */
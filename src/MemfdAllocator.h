@@ -0,0 +1,52 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * MemfdAllocator.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_MEMFDALLOCATOR_H_
+#define SRC_MEMFDALLOCATOR_H_
+
+#include <gst/gst.h>
+
+namespace szd {
+
+// A GstFdAllocator backing every memory with its own memfd. Frames
+// allocated from it have a file descriptor like dmabufs, also on systems
+// without dmabuf capable elements, so the TPU pipeline can map them itself
+// instead of going through gst_buffer_map.
+class MemfdAllocator {
+ public:
+  MemfdAllocator() = delete;
+
+  // Returns the shared allocator, transfer none.
+  static GstAllocator* Get();
+  // Answers the allocation queries reaching sink with a pool of at least
+  // min_buffers memfd backed buffers, so the elements upstream write their
+  // frames straight into them.
+  static void ProvideBufferPool(GstElement *sink, guint min_buffers);
+
+ private:
+  static GstPadProbeReturn OnAllocationQuery(GstPad *pad,
+                                             GstPadProbeInfo *info,
+                                             guint min_buffers);
+};
+
+} /* namespace szd */
+
+#endif /* SRC_MEMFDALLOCATOR_H_ */
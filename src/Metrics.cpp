@@ -0,0 +1,279 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Metrics.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "Metrics.h"
+
+namespace szd {
+// Buckets from 1 ms to 1 s, Edge TPU invokes are in the few ms range.
+static const std::vector<double> kLatencyBuckets = { 0.001, 0.002, 0.005,
+    0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0 };
+// How long a scraper may take to send its request or read the response.
+// Scrapes are served one at a time, an idle client can't hold up the next.
+static const int kClientTimeoutSec = 2;
+
+static std::string WithLabels(const std::string &name,
+                              const std::string &labels) {
+  return labels.empty() ? name : absl::StrCat(name, "{", labels, "}");
+}
+
+Histogram::Histogram(const std::vector<double> &bounds)
+    :
+    bounds_(bounds),
+    counts_(new std::atomic<uint64_t>[bounds.size() + 1]) {
+  for (auto bound : bounds_) {
+    bounds_ns_.push_back(bound * 1e9);
+  }
+  for (size_t i = 0; i <= bounds_.size(); ++i) {
+    counts_[i].store(0);
+  }
+}
+
+Histogram::~Histogram() {
+}
+
+void Histogram::ObserveNs(uint64_t ns) {
+  size_t bucket = 0;
+  while (bucket < bounds_ns_.size() && ns > bounds_ns_[bucket]) {
+    bucket++;
+  }
+  counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+  sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Histogram::Render(const std::string &name, const std::string &labels,
+                       std::string *out) const {
+  const std::string separator = labels.empty() ? "" : ",";
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i <= bounds_.size(); ++i) {
+    cumulative += counts_[i].load(std::memory_order_relaxed);
+    std::string le =
+        i < bounds_.size() ? absl::StrCat(bounds_[i]) : std::string("+Inf");
+    absl::StrAppend(out, name, "_bucket{", labels, separator, "le=\"", le,
+                    "\"} ", cumulative, "\n");
+  }
+  absl::StrAppend(out, WithLabels(absl::StrCat(name, "_sum"), labels), " ",
+                  sum_ns_.load(std::memory_order_relaxed) / 1e9, "\n");
+  absl::StrAppend(out, WithLabels(absl::StrCat(name, "_count"), labels), " ",
+                  count_.load(std::memory_order_relaxed), "\n");
+}
+
+MetricsRegistry& MetricsRegistry::GetInstance() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+MetricsRegistry::Family& MetricsRegistry::GetFamily(const std::string &name,
+                                                    const std::string &help,
+                                                    Type type) {
+  auto &family = families_[name];
+  if (family.help.empty()) {
+    family.help = help;
+    family.type = type;
+  }
+  return family;
+}
+
+Counter* MetricsRegistry::GetCounter(const std::string &name,
+                                     const std::string &help,
+                                     const std::string &labels, double scale) {
+  absl::MutexLock lock(&mutex_);
+  auto &family = GetFamily(name, help, kCounter);
+  auto &counter = family.counters[labels];
+  if (!counter) {
+    counter = std::make_unique<Counter>();
+    family.scales[labels] = scale;
+  }
+  return counter.get();
+}
+
+Gauge* MetricsRegistry::GetGauge(const std::string &name,
+                                 const std::string &help,
+                                 const std::string &labels) {
+  absl::MutexLock lock(&mutex_);
+  auto &gauge = GetFamily(name, help, kGauge).gauges[labels];
+  if (!gauge) {
+    gauge = std::make_unique<Gauge>();
+  }
+  return gauge.get();
+}
+
+Histogram* MetricsRegistry::GetLatencyHistogram(const std::string &name,
+                                                const std::string &help,
+                                                const std::string &labels) {
+  return GetLatencyHistogram(name, help, labels, kLatencyBuckets);
+}
+
+Histogram* MetricsRegistry::GetLatencyHistogram(
+    const std::string &name, const std::string &help,
+    const std::string &labels, const std::vector<double> &bounds) {
+  absl::MutexLock lock(&mutex_);
+  auto &histogram = GetFamily(name, help, kHistogram).histograms[labels];
+  if (!histogram) {
+    histogram = std::make_unique<Histogram>(bounds);
+  }
+  return histogram.get();
+}
+
+void MetricsRegistry::AddCallbackGauge(const std::string &name,
+                                       const std::string &help,
+                                       const std::string &labels,
+                                       std::function<double()> callback) {
+  absl::MutexLock lock(&mutex_);
+  GetFamily(name, help, kGauge).callbacks[labels] = callback;
+}
+
+std::string MetricsRegistry::Render() {
+  static const char *kTypeNames[] = { "counter", "gauge", "histogram" };
+  // Callbacks may take locks of their own, e.g. of the queues they read, so
+  // they are copied out and called once mutex_ is released. Each one comes
+  // after the text rendered before it.
+  std::vector<std::pair<std::string, std::function<double()>>> pieces;
+  std::string text;
+  {
+    absl::MutexLock lock(&mutex_);
+    for (const auto &entry : families_) {
+      const auto &name = entry.first;
+      const auto &family = entry.second;
+      absl::StrAppend(&text, "# HELP ", name, " ", family.help, "\n",
+                      "# TYPE ", name, " ", kTypeNames[family.type], "\n");
+      for (const auto &counter : family.counters) {
+        const double scale = family.scales.at(counter.first);
+        absl::StrAppend(&text, WithLabels(name, counter.first), " ");
+        if (scale == 1.0) {
+          absl::StrAppend(&text, counter.second->Get(), "\n");
+        } else {
+          absl::StrAppend(&text, counter.second->Get() * scale, "\n");
+        }
+      }
+      for (const auto &gauge : family.gauges) {
+        absl::StrAppend(&text, WithLabels(name, gauge.first), " ",
+                        gauge.second->Get(), "\n");
+      }
+      for (const auto &callback : family.callbacks) {
+        absl::StrAppend(&text, WithLabels(name, callback.first), " ");
+        pieces.emplace_back(std::move(text), callback.second);
+        text.clear();
+      }
+      for (const auto &histogram : family.histograms) {
+        histogram.second->Render(name, histogram.first, &text);
+      }
+    }
+  }
+  std::string out;
+  for (const auto &piece : pieces) {
+    absl::StrAppend(&out, piece.first, piece.second(), "\n");
+  }
+  absl::StrAppend(&out, text);
+  return out;
+}
+
+bool MetricsRegistry::WriteTextfile(const std::string &path) {
+  const std::string tmp_path = absl::StrCat(path, ".tmp");
+  {
+    std::ofstream out(tmp_path);
+    out << Render();
+    if (!out.good()) {
+      return false;
+    }
+  }
+  return rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+bool MetricsRegistry::StartHttpServer(int port) {
+  server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (server_fd_ < 0) {
+    return false;
+  }
+  int reuse = 1;
+  setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in address = { };
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  if (bind(server_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address))
+      != 0 || listen(server_fd_, 4) != 0) {
+    close(server_fd_);
+    server_fd_ = -1;
+    return false;
+  }
+  server_thread_ = std::thread([this] {
+    ServeHttp();
+  });
+  return true;
+}
+
+void MetricsRegistry::ServeHttp() {
+  int client;
+  while ((client = accept(server_fd_, nullptr, nullptr)) >= 0) {
+    timeval timeout = { kClientTimeoutSec, 0 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    // Every request gets the metrics, the request itself doesn't matter.
+    char request[1024];
+    if (recv(client, request, sizeof(request), 0) > 0) {
+      auto body = Render();
+      auto response = absl::StrCat(
+          "HTTP/1.0 200 OK\r\n"
+          "Content-Type: text/plain; version=0.0.4\r\n"
+          "Content-Length: ",
+          body.size(), "\r\n\r\n", body);
+      // A scraper that hangs up early must not raise SIGPIPE, which would
+      // end the process.
+      size_t written = 0;
+      ssize_t n;
+      while (written < response.size()
+          && (n = send(client, response.data() + written,
+                       response.size() - written, MSG_NOSIGNAL)) > 0) {
+        written += n;
+      }
+    }
+    close(client);
+  }
+}
+
+MetricsRegistry::MetricsRegistry() {
+}
+
+MetricsRegistry::~MetricsRegistry() {
+  if (server_fd_ >= 0) {
+    // Unblocks accept() so the server thread can finish.
+    shutdown(server_fd_, SHUT_RDWR);
+    close(server_fd_);
+    server_thread_.join();
+  }
+}
+
+} /* namespace szd */
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Metrics.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_METRICS_H_
+#define SRC_METRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+
+namespace szd {
+
+// Monotonic count. Values are scaled by the registered scale when exported,
+// so e.g. nanoseconds can be counted and exported as seconds.
+class Counter {
+ public:
+  void Increment(uint64_t n = 1) {
+    value_.fetch_add(n, std::memory_order_relaxed);
+  }
+  uint64_t Get() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint64_t> value_ { 0 };
+};
+
+class Gauge {
+ public:
+  void Set(int64_t value) {
+    value_.store(value, std::memory_order_relaxed);
+  }
+  void Add(int64_t n) {
+    value_.fetch_add(n, std::memory_order_relaxed);
+  }
+  int64_t Get() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64_t> value_ { 0 };
+};
+
+// Latency histogram with fixed bucket bounds in seconds.
+class Histogram {
+ public:
+  Histogram(const std::vector<double> &bounds);
+  Histogram() = delete;
+  Histogram(const Histogram &other) = delete;
+  Histogram(Histogram &&other) = delete;
+  Histogram& operator=(const Histogram &other) = delete;
+  Histogram& operator=(Histogram &&other) = delete;
+  virtual ~Histogram();
+
+  void ObserveNs(uint64_t ns);
+  uint64_t GetCount() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+  uint64_t GetSumNs() const {
+    return sum_ns_.load(std::memory_order_relaxed);
+  }
+  // Appends the _bucket, _sum and _count lines for this histogram.
+  void Render(const std::string &name, const std::string &labels,
+              std::string *out) const;
+
+ private:
+  std::vector<uint64_t> bounds_ns_;
+  std::vector<double> bounds_;
+  // One more bucket than bounds for +Inf, not cumulative.
+  std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+  std::atomic<uint64_t> sum_ns_ { 0 };
+  std::atomic<uint64_t> count_ { 0 };
+};
+
+// Process wide registry of metrics in the Prometheus text format. Metrics
+// are created once during setup, recording into them is lock and allocation
+// free. The text is served over HTTP on localhost and/or written to a file
+// for the node exporter textfile collector.
+class MetricsRegistry {
+ public:
+  static MetricsRegistry& GetInstance();
+  MetricsRegistry(const MetricsRegistry &other) = delete;
+  MetricsRegistry(MetricsRegistry &&other) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry &other) = delete;
+  MetricsRegistry& operator=(MetricsRegistry &&other) = delete;
+  virtual ~MetricsRegistry();
+
+  // labels are formatted as in the exposition format, e.g.
+  // stream="0",file="videos/garden.mp4". The same name and labels always
+  // return the same metric. Returned pointers live as long as the process.
+  Counter* GetCounter(const std::string &name, const std::string &help,
+                      const std::string &labels, double scale = 1.0);
+  Gauge* GetGauge(const std::string &name, const std::string &help,
+                  const std::string &labels);
+  Histogram* GetLatencyHistogram(const std::string &name,
+                                 const std::string &help,
+                                 const std::string &labels);
+  // For latencies far from the default buckets, bounds are in seconds.
+  Histogram* GetLatencyHistogram(const std::string &name,
+                                 const std::string &help,
+                                 const std::string &labels,
+                                 const std::vector<double> &bounds);
+  // A gauge that is computed when scraped, for values such as queue levels
+  // that are cheaper to read on demand than to track. Callbacks run without
+  // the registry locked, they may lock what they read.
+  void AddCallbackGauge(const std::string &name, const std::string &help,
+                        const std::string &labels,
+                        std::function<double()> callback);
+
+  std::string Render();
+  // Writes atomically through a temporary file, as the textfile collector
+  // requires.
+  bool WriteTextfile(const std::string &path);
+  // Serves Render() to any request on 127.0.0.1:port from a background
+  // thread, one client at a time with a timeout.
+  bool StartHttpServer(int port);
+
+ private:
+  enum Type {
+    kCounter,
+    kGauge,
+    kHistogram,
+  };
+  struct Family {
+    std::string help;
+    Type type;
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    std::map<std::string, double> scales;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges;
+    std::map<std::string, std::function<double()>> callbacks;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+  };
+
+  MetricsRegistry();
+  Family& GetFamily(const std::string &name, const std::string &help,
+                    Type type);
+  void ServeHttp();
+
+  absl::Mutex mutex_;
+  std::map<std::string, Family> families_;
+  int server_fd_ = -1;
+  std::thread server_thread_;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_METRICS_H_ */
@@ -0,0 +1,205 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * MetricsTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+#include "Metrics.h"
+
+namespace szd {
+
+static bool Contains(const std::string &text, const std::string &line) {
+  return text.find(line) != std::string::npos;
+}
+
+// Sends a request to the metrics server and returns the whole response.
+static std::string Scrape(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = { };
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address))
+      != 0) {
+    close(fd);
+    return "";
+  }
+  const std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+  EXPECT_EQ(write(fd, request.data(), request.size()),
+            static_cast<ssize_t>(request.size()));
+  std::string response;
+  char chunk[4096];
+  ssize_t n;
+  while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+    response.append(chunk, n);
+  }
+  close(fd);
+  return response;
+}
+
+// The port of a running server, shared by the tests since the server can't
+// be stopped.
+static int GetServerPort() {
+  static int port = [] {
+    int port = 19100;
+    while (!MetricsRegistry::GetInstance().StartHttpServer(port)
+        && port < 19200) {
+      port++;
+    }
+    return port;
+  }();
+  return port;
+}
+
+static int Connect(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = { };
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  EXPECT_EQ(
+      connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+  return fd;
+}
+
+TEST(MetricsTest, RendersEveryType) {
+  auto &registry = MetricsRegistry::GetInstance();
+  registry.GetCounter("test_frames_total", "Frames.", "stream=\"0\"")
+      ->Increment(3);
+  registry.GetCounter("test_busy_seconds_total", "Busy time.", "tpu=\"0\"",
+                      1e-9)->Increment(1500000000);
+  registry.GetGauge("test_queue_level", "Queue level.", "queue=\"a\"")->Set(
+      -2);
+  registry.AddCallbackGauge("test_callback", "Computed on scrape.", "", [] {
+    return 7.5;
+  });
+  auto *histogram = registry.GetLatencyHistogram("test_latency_seconds",
+                                                 "Latency.", "stream=\"0\"");
+  histogram->ObserveNs(1500000);
+  histogram->ObserveNs(3000000000);
+
+  const auto text = registry.Render();
+  EXPECT_TRUE(Contains(text, "# HELP test_frames_total Frames.\n"));
+  EXPECT_TRUE(Contains(text, "# TYPE test_frames_total counter\n"));
+  EXPECT_TRUE(Contains(text, "test_frames_total{stream=\"0\"} 3\n"));
+  EXPECT_TRUE(Contains(text, "test_busy_seconds_total{tpu=\"0\"} 1.5\n"));
+  EXPECT_TRUE(Contains(text, "# TYPE test_queue_level gauge\n"));
+  EXPECT_TRUE(Contains(text, "test_queue_level{queue=\"a\"} -2\n"));
+  EXPECT_TRUE(Contains(text, "test_callback 7.5\n"));
+  EXPECT_TRUE(Contains(text, "# TYPE test_latency_seconds histogram\n"));
+  // Buckets are cumulative, the 3 s observation only counts in +Inf.
+  EXPECT_TRUE(Contains(
+      text, "test_latency_seconds_bucket{stream=\"0\",le=\"0.001\"} 0\n"));
+  EXPECT_TRUE(Contains(
+      text, "test_latency_seconds_bucket{stream=\"0\",le=\"0.002\"} 1\n"));
+  EXPECT_TRUE(Contains(
+      text, "test_latency_seconds_bucket{stream=\"0\",le=\"1\"} 1\n"));
+  EXPECT_TRUE(Contains(
+      text, "test_latency_seconds_bucket{stream=\"0\",le=\"+Inf\"} 2\n"));
+  EXPECT_TRUE(Contains(text,
+                       "test_latency_seconds_sum{stream=\"0\"} 3.0015\n"));
+  EXPECT_TRUE(Contains(text, "test_latency_seconds_count{stream=\"0\"} 2\n"));
+}
+
+TEST(MetricsTest, SameNameAndLabelsShareAMetric) {
+  auto &registry = MetricsRegistry::GetInstance();
+  auto *a = registry.GetCounter("test_shared_total", "Shared.", "x=\"1\"");
+  auto *b = registry.GetCounter("test_shared_total", "Shared.", "x=\"1\"");
+  auto *c = registry.GetCounter("test_shared_total", "Shared.", "x=\"2\"");
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+}
+
+TEST(MetricsTest, CallbacksRunUnlocked) {
+  auto &registry = MetricsRegistry::GetInstance();
+  // Would deadlock if Render held the registry lock around callbacks.
+  registry.AddCallbackGauge("test_reentrant", "Reads the registry.", "",
+                            [&registry] {
+                              registry.GetCounter("test_touched_total",
+                                                  "Touched.", "")->Increment();
+                              return 1.0;
+                            });
+  EXPECT_TRUE(Contains(registry.Render(), "test_reentrant 1\n"));
+}
+
+TEST(MetricsTest, WritesTextfile) {
+  auto &registry = MetricsRegistry::GetInstance();
+  registry.GetCounter("test_textfile_total", "Textfile.", "")->Increment();
+  const std::string path = ::testing::TempDir() + "metrics_test.prom";
+  ASSERT_TRUE(registry.WriteTextfile(path));
+  std::ifstream in(path);
+  std::stringstream text;
+  text << in.rdbuf();
+  EXPECT_TRUE(Contains(text.str(), "test_textfile_total 1\n"));
+  EXPECT_FALSE(std::ifstream(path + ".tmp").good());
+}
+
+TEST(MetricsTest, ServesScrapes) {
+  auto &registry = MetricsRegistry::GetInstance();
+  registry.GetGauge("test_scraped", "Scraped.", "")->Set(42);
+  const int port = GetServerPort();
+  ASSERT_LT(port, 19200);
+  const auto response = Scrape(port);
+  EXPECT_EQ(response.compare(0, 15, "HTTP/1.0 200 OK"), 0);
+  EXPECT_TRUE(Contains(response, "text/plain; version=0.0.4"));
+  EXPECT_TRUE(Contains(response, "\r\n\r\n"));
+  EXPECT_TRUE(Contains(response, "test_scraped 42\n"));
+}
+
+TEST(MetricsTest, IdleClientDoesNotBlockScrapes) {
+  const int port = GetServerPort();
+  ASSERT_LT(port, 19200);
+  // Connects and never sends a request.
+  const int idle = Connect(port);
+  EXPECT_TRUE(Contains(Scrape(port), "HTTP/1.0 200 OK"));
+  close(idle);
+}
+
+TEST(MetricsTest, SurvivesClientHangingUp) {
+  auto &registry = MetricsRegistry::GetInstance();
+  // A response much larger than the socket buffers, sent in parts.
+  for (int i = 0; i < 200000; ++i) {
+    registry.GetGauge("test_padding", "Makes the response large.",
+                      absl::StrCat("i=\"", i, "\""));
+  }
+  const int port = GetServerPort();
+  ASSERT_LT(port, 19200);
+  const int fd = Connect(port);
+  const std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+  ASSERT_EQ(write(fd, request.data(), request.size()),
+            static_cast<ssize_t>(request.size()));
+  // Gone before the response, whose first part the client's kernel answers
+  // with a reset, the rest is sent to a broken connection.
+  close(fd);
+  // Still alive and serving.
+  EXPECT_TRUE(Contains(Scrape(port), "HTTP/1.0 200 OK"));
+}
+
+} /* namespace szd */
@@ -29,7 +29,7 @@
 #include <gst/gst.h>
 
 #include "MixerBin.h"
-#include "TwoModelInferencerBin.h"
+#include "Tracer.h"
 
 namespace szd {
 void MixerBin::TiledView() {
@@ -96,7 +96,15 @@ GstPadProbeReturn MixerBin::SrcPadCallback(GstPad *pad, GstPadProbeInfo *info) {
       if (g_str_equal(type, "key-press")) {
         auto key_pressed = gst_structure_get_string(s, "key");
         auto key = g_ascii_strtoll(key_pressed, NULL, 0);
-        if (key > 0 && key <= MAX_NUM_INPUTS) {
+        if (g_str_equal(key_pressed, "t")
+            && Tracer::GetInstance().IsEnabled()) {
+          // Dump the trace on demand, from the main loop rather than this
+          // streaming thread.
+          g_idle_add(+[](gpointer data) -> gboolean {
+            Tracer::GetInstance().WriteChromeTrace(kTraceFile);
+            return G_SOURCE_REMOVE;
+          }, nullptr);
+        } else if (key > 0 && key <= MAX_NUM_INPUTS) {
           FullScreen(key - 1);
         } else {
           TiledView();
@@ -139,6 +147,21 @@ bool MixerBin::LinkInput(InferencerBin &inputstream) {
         }),
         this, NULL);
     gst_element_add_pad(bin_, sink_pad);
+    if (Tracer::GetInstance().IsEnabled()) {
+      gst_pad_add_probe(
+          sink_pad,
+          GST_PAD_PROBE_TYPE_BUFFER,
+          reinterpret_cast<GstPadProbeCallback>(+[](
+              GstPad *pad, GstPadProbeInfo *info,
+              InferencerBin *stream) -> GstPadProbeReturn {
+            auto now = Tracer::Now();
+            Tracer::GetInstance().Record(
+                "mixer_input", stream->GetTraceStream(),
+                GST_BUFFER_PTS(gst_pad_probe_info_get_buffer(info)), now, now);
+            return GST_PAD_PROBE_OK;
+          }),
+          &inputstream, NULL);
+    }
 
     gst_object_unref(sink_pad_internal);
     gst_object_unref(mixer);
@@ -172,6 +195,24 @@ MixerBin::MixerBin() {
         return self->SrcPadCallback(pad, info);
       }),
       this, NULL);
+  if (Tracer::GetInstance().IsEnabled()) {
+    // Composition spans from the previous composed frame to this one.
+    gst_pad_add_probe(
+        source_pad,
+        GST_PAD_PROBE_TYPE_BUFFER,
+        reinterpret_cast<GstPadProbeCallback>(+[](
+            GstPad *pad, GstPadProbeInfo *info,
+            MixerBin *self) -> GstPadProbeReturn {
+          auto now = Tracer::Now();
+          Tracer::GetInstance().Record(
+              "compose", -1,
+              GST_BUFFER_PTS(gst_pad_probe_info_get_buffer(info)),
+              self->last_compose_ns_ ? self->last_compose_ns_ : now, now);
+          self->last_compose_ns_ = now;
+          return GST_PAD_PROBE_OK;
+        }),
+        this, NULL);
+  }
   gst_object_unref(mixer);
   gst_object_unref(source_pad);
 }
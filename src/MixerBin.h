@@ -32,6 +32,8 @@
 
 namespace szd {
 
+  // Written when 't' is pressed and at exit if tracing is enabled.
+  const char kTraceFile[] = "multi_video_streams_trace.json";
   const std::string kMixerBinSrc =
       "glvideomixer name=m background=black ! video/x-raw,width=$0,height=$1 ! videoconvert ! glimagesink";
 
@@ -46,7 +48,7 @@ class MixerBin : public Bin {
 
   bool LinkInput(class InferencerBin &inputstream);
   friend class InferencerBin;
-  friend class TwoModelInferencerBin;
+  friend class CascadeInferencerBin;
 
  private:
   struct InputConnectionRecord {
@@ -71,6 +73,7 @@ class MixerBin : public Bin {
   int num_sinks_ = 0;
   int fullscreen_stream_ = -1;
   bool fullscreen_ = false;
+  uint64_t last_compose_ns_ = 0;
 };
 
 } /* namespace szd */
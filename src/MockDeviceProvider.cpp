@@ -0,0 +1,143 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * MockDeviceProvider.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/substitute.h"
+
+#include "Metrics.h"
+#include "MockDeviceProvider.h"
+
+namespace szd {
+
+void MockEdgeTpu::Invoke(const void *model) {
+  absl::MutexLock lock(&mutex_);
+  int duration_us = config_.invoke_us;
+  if (config_.jitter_us > 0) {
+    duration_us += std::uniform_int_distribution<int>(-config_.jitter_us,
+                                                      config_.jitter_us)(
+        random_);
+  }
+  if (model != cached_model_) {
+    if (cached_model_) {
+      duration_us += config_.swap_penalty_us;
+      num_swaps_++;
+    }
+    cached_model_ = model;
+  }
+  if (duration_us > 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(duration_us));
+  }
+}
+
+uint64_t MockEdgeTpu::GetNumSwaps() {
+  absl::MutexLock lock(&mutex_);
+  return num_swaps_;
+}
+
+MockEdgeTpu::MockEdgeTpu(
+    const edgetpu::EdgeTpuManager::DeviceEnumerationRecord &record,
+    const MockTpuConfig &config, unsigned int seed)
+    :
+    record_(record),
+    config_(config),
+    random_(seed) {
+  type = kTfLiteEdgeTpuContext;
+  Refresh = [](TfLiteContext *context) {
+    return kTfLiteOk;
+  };
+}
+
+MockEdgeTpu::~MockEdgeTpu() {
+}
+
+std::vector<edgetpu::EdgeTpuManager::DeviceEnumerationRecord> MockDeviceProvider::EnumerateDevices() {
+  std::vector<edgetpu::EdgeTpuManager::DeviceEnumerationRecord> records;
+  for (const auto &device : devices_) {
+    records.push_back(device->GetDeviceEnumRecord());
+  }
+  return records;
+}
+
+std::shared_ptr<edgetpu::EdgeTpuContext> MockDeviceProvider::OpenDevice(
+    const edgetpu::EdgeTpuManager::DeviceEnumerationRecord &record) {
+  for (const auto &device : devices_) {
+    if (device->GetDeviceEnumRecord().path == record.path) {
+      return device;
+    }
+  }
+  return nullptr;
+}
+
+TfLiteRegistration* MockDeviceProvider::GetCustomOp() {
+  // The op's custom data is the compiled model, its address identifies the
+  // model for the parameter cache.
+  static TfLiteRegistration registration = {
+      [](TfLiteContext *context, const char *buffer, size_t length) -> void* {
+        return const_cast<char*>(buffer);
+      },
+      nullptr,
+      nullptr,
+      [](TfLiteContext *context, TfLiteNode *node) -> TfLiteStatus {
+        auto *device = static_cast<MockEdgeTpu*>(context->GetExternalContext(
+            context, kTfLiteEdgeTpuContext));
+        if (!device) {
+          return kTfLiteError;
+        }
+        device->Invoke(node->user_data);
+        for (int i = 0; i < node->outputs->size; ++i) {
+          auto &tensor = context->tensors[node->outputs->data[i]];
+          std::memset(tensor.data.raw, device->GetOutputFill(), tensor.bytes);
+        }
+        return kTfLiteOk;
+      } };
+  return &registration;
+}
+
+MockDeviceProvider::MockDeviceProvider(const MockTpuConfig &config) {
+  for (size_t i = 0; i < config.num_devices; ++i) {
+    devices_.push_back(
+        std::make_shared<MockEdgeTpu>(
+            edgetpu::EdgeTpuManager::DeviceEnumerationRecord {
+                edgetpu::DeviceType::kApexPci, absl::StrCat("/dev/mock_apex_",
+                                                            i) },
+            config, i));
+    auto *device = devices_.back().get();
+    MetricsRegistry::GetInstance().AddCallbackGauge(
+        "mock_tpu_model_swaps",
+        "Invokes that ran another model than the previous one on the "
+        "simulated TPU, co-compiled or not.",
+        absl::Substitute("tpu=\"$0\"", device->GetDeviceEnumRecord().path),
+        [device] {
+          return device->GetNumSwaps();
+        });
+  }
+}
+
+MockDeviceProvider::~MockDeviceProvider() {
+}
+
+} /* namespace szd */
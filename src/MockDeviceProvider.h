@@ -0,0 +1,107 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * MockDeviceProvider.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_MOCKDEVICEPROVIDER_H_
+#define SRC_MOCKDEVICEPROVIDER_H_
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+
+#include "DeviceProvider.h"
+
+namespace szd {
+
+struct MockTpuConfig {
+  size_t num_devices = 8;
+  int invoke_us = 5000;
+  // Every invoke takes invoke_us +- up to jitter_us.
+  int jitter_us = 500;
+  // Added when a device runs a different model than its previous invoke,
+  // like reloading the parameter cache of a real Edge TPU.
+  int swap_penalty_us = 2000;
+  // The Edge TPU op outputs are filled with this value, ops after it in the
+  // model still run on the CPU.
+  uint8_t output_fill = 0;
+};
+
+// A simulated Edge TPU. Invokes on the same device are serialized like on
+// the real hardware.
+class MockEdgeTpu : public edgetpu::EdgeTpuContext {
+ public:
+  MockEdgeTpu(const edgetpu::EdgeTpuManager::DeviceEnumerationRecord &record,
+              const MockTpuConfig &config, unsigned int seed);
+  MockEdgeTpu() = delete;
+  MockEdgeTpu(const MockEdgeTpu &other) = delete;
+  MockEdgeTpu(MockEdgeTpu &&other) = delete;
+  MockEdgeTpu& operator=(const MockEdgeTpu &other) = delete;
+  MockEdgeTpu& operator=(MockEdgeTpu &&other) = delete;
+  virtual ~MockEdgeTpu();
+
+  const edgetpu::EdgeTpuManager::DeviceEnumerationRecord& GetDeviceEnumRecord() const override {
+    return record_;
+  }
+  edgetpu::EdgeTpuManager::DeviceOptions GetDeviceOptions() const override {
+    return {};
+  }
+  bool IsReady() const override {
+    return true;
+  }
+  // Blocks for the simulated time of running model, any pointer unique to
+  // the model, on this device.
+  void Invoke(const void *model);
+  uint64_t GetNumSwaps();
+  uint8_t GetOutputFill() const {
+    return config_.output_fill;
+  }
+
+ private:
+  edgetpu::EdgeTpuManager::DeviceEnumerationRecord record_;
+  MockTpuConfig config_;
+  absl::Mutex mutex_;
+  std::mt19937 random_;
+  const void *cached_model_ = nullptr;
+  uint64_t num_swaps_ = 0;
+};
+
+// Provides MockTpuConfig::num_devices simulated Edge TPUs, so scheduling,
+// pipelining and backpressure can be exercised without the hardware.
+class MockDeviceProvider : public DeviceProvider {
+ public:
+  MockDeviceProvider(const MockTpuConfig &config);
+  MockDeviceProvider() = delete;
+  virtual ~MockDeviceProvider();
+
+  std::vector<edgetpu::EdgeTpuManager::DeviceEnumerationRecord> EnumerateDevices() override;
+  std::shared_ptr<edgetpu::EdgeTpuContext> OpenDevice(
+      const edgetpu::EdgeTpuManager::DeviceEnumerationRecord &record) override;
+  TfLiteRegistration* GetCustomOp() override;
+
+ private:
+  std::vector<std::shared_ptr<MockEdgeTpu>> devices_;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_MOCKDEVICEPROVIDER_H_ */
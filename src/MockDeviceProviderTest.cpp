@@ -0,0 +1,210 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * MockDeviceProviderTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tensorflow/lite/builtin_ops.h"
+#include "tensorflow/lite/interpreter.h"
+
+#include "MockDeviceProvider.h"
+
+namespace szd {
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+// A graph of just the Edge TPU op, as a compiled model whose layers all run
+// on the TPU. model tells models apart for the parameter cache.
+static std::unique_ptr<tflite::Interpreter> MakeInterpreter(
+    MockDeviceProvider &provider, edgetpu::EdgeTpuContext *device,
+    const char *model) {
+  auto interpreter = std::make_unique<tflite::Interpreter>();
+  EXPECT_EQ(interpreter->AddTensors(2), kTfLiteOk);
+  EXPECT_EQ(interpreter->SetInputs( { 0 }), kTfLiteOk);
+  EXPECT_EQ(interpreter->SetOutputs( { 1 }), kTfLiteOk);
+  TfLiteQuantizationParams quantization = { 1.0f, 0 };
+  EXPECT_EQ(
+      interpreter->SetTensorParametersReadWrite(0, kTfLiteUInt8, "input",
+                                                { 1, 8, 8, 3 }, quantization),
+      kTfLiteOk);
+  EXPECT_EQ(
+      interpreter->SetTensorParametersReadWrite(1, kTfLiteUInt8, "output",
+                                                { 1, 16 }, quantization),
+      kTfLiteOk);
+  // Registered the way the op resolver registers the real op.
+  static TfLiteRegistration registration;
+  registration = *provider.GetCustomOp();
+  registration.builtin_code = kTfLiteBuiltinCustom;
+  registration.custom_name = edgetpu::kCustomOp;
+  EXPECT_EQ(
+      interpreter->AddNodeWithParameters( { 0 }, { 1 }, model,
+                                         strlen(model) + 1, nullptr,
+                                         &registration),
+      kTfLiteOk);
+  interpreter->SetExternalContext(kTfLiteEdgeTpuContext, device);
+  EXPECT_EQ(interpreter->AllocateTensors(), kTfLiteOk);
+  return interpreter;
+}
+
+TEST(MockDeviceProviderTest, EnumeratesAndOpensDevices) {
+  MockTpuConfig config;
+  config.num_devices = 3;
+  MockDeviceProvider provider(config);
+  const auto records = provider.EnumerateDevices();
+  ASSERT_EQ(records.size(), 3u);
+  for (const auto &record : records) {
+    auto device = provider.OpenDevice(record);
+    ASSERT_NE(device, nullptr);
+    EXPECT_EQ(device->GetDeviceEnumRecord().path, record.path);
+    EXPECT_TRUE(device->IsReady());
+  }
+  EXPECT_EQ(provider.OpenDevice( { edgetpu::DeviceType::kApexPci,
+                                    "/dev/apex_99" }),
+            nullptr);
+}
+
+TEST(MockDeviceProviderTest, InvokeTakesConfiguredTime) {
+  MockTpuConfig config;
+  config.num_devices = 1;
+  config.invoke_us = 20000;
+  config.jitter_us = 5000;
+  MockEdgeTpu device( { edgetpu::DeviceType::kApexPci, "/dev/mock_apex_0" },
+                     config, 0);
+  int model;
+  for (int i = 0; i < 5; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    device.Invoke(&model);
+    const double seconds = SecondsSince(start);
+    EXPECT_GE(seconds, 0.015);
+    EXPECT_LT(seconds, 0.1);
+  }
+  EXPECT_EQ(device.GetNumSwaps(), 0);
+}
+
+TEST(MockDeviceProviderTest, ChargesSwapPenalty) {
+  MockTpuConfig config;
+  config.num_devices = 1;
+  config.invoke_us = 1000;
+  config.jitter_us = 0;
+  config.swap_penalty_us = 20000;
+  MockEdgeTpu device( { edgetpu::DeviceType::kApexPci, "/dev/mock_apex_0" },
+                     config, 0);
+  int detector, classifier;
+  device.Invoke(&detector);
+  auto start = std::chrono::steady_clock::now();
+  device.Invoke(&detector);
+  EXPECT_LT(SecondsSince(start), 0.02);
+  EXPECT_EQ(device.GetNumSwaps(), 0);
+
+  start = std::chrono::steady_clock::now();
+  device.Invoke(&classifier);
+  EXPECT_GE(SecondsSince(start), 0.021);
+  device.Invoke(&detector);
+  EXPECT_EQ(device.GetNumSwaps(), 2);
+}
+
+TEST(MockDeviceProviderTest, SerializesInvokesOnADevice) {
+  MockTpuConfig config;
+  config.num_devices = 1;
+  config.invoke_us = 5000;
+  config.jitter_us = 0;
+  MockEdgeTpu device( { edgetpu::DeviceType::kApexPci, "/dev/mock_apex_0" },
+                     config, 0);
+  int model;
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&device, &model] {
+      for (int j = 0; j < 5; ++j) {
+        device.Invoke(&model);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_GE(SecondsSince(start), 20 * 0.005);
+}
+
+TEST(MockDeviceProviderTest, CustomOpFillsOutputs) {
+  MockTpuConfig config;
+  config.num_devices = 1;
+  config.invoke_us = 0;
+  config.jitter_us = 0;
+  config.output_fill = 0x5a;
+  MockDeviceProvider provider(config);
+  auto device = provider.OpenDevice(provider.EnumerateDevices()[0]);
+  auto interpreter = MakeInterpreter(provider, device.get(), "model");
+  ASSERT_EQ(interpreter->Invoke(), kTfLiteOk);
+  const auto *output = interpreter->typed_output_tensor<uint8_t>(0);
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(output[i], 0x5a);
+  }
+}
+
+// Streams invoking back to back on interpreters spread over the devices,
+// as the demo does. The throughput is bound by the simulated devices, not
+// the host.
+TEST(MockDeviceProviderTest, LoadScalesWithDevices) {
+  const int kStreams = 16;
+  const int kInvokesPerStream = 20;
+  MockTpuConfig config;
+  config.num_devices = 8;
+  config.invoke_us = 4000;
+  config.jitter_us = 400;
+  MockDeviceProvider provider(config);
+  const auto records = provider.EnumerateDevices();
+  std::vector<std::unique_ptr<tflite::Interpreter>> interpreters;
+  for (int i = 0; i < kStreams; ++i) {
+    auto device = provider.OpenDevice(records[i % records.size()]);
+    interpreters.push_back(MakeInterpreter(provider, device.get(), "model"));
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (auto &interpreter : interpreters) {
+    threads.emplace_back([&interpreter] {
+      for (int j = 0; j < kInvokesPerStream; ++j) {
+        EXPECT_EQ(interpreter->Invoke(), kTfLiteOk);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  const double fps = kStreams * kInvokesPerStream / SecondsSince(start);
+  const double ideal_fps = config.num_devices * 1e6 / config.invoke_us;
+  printf("%d streams on %zu mock TPUs: %.0f inferences/s, %.0f%% of the "
+         "devices' capacity\n",
+         kStreams, config.num_devices, fps, 100 * fps / ideal_fps);
+  EXPECT_LE(fps, ideal_fps * 1.2);
+  EXPECT_GE(fps, ideal_fps * 0.5);
+}
+
+} /* namespace szd */
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * ModelRegistry.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+
+#include "Metrics.h"
+#include "ModelRegistry.h"
+
+namespace szd {
+
+ModelRegistry& ModelRegistry::GetInstance() {
+  static ModelRegistry registry;
+  return registry;
+}
+
+std::shared_ptr<tflite::FlatBufferModel> ModelRegistry::Get(
+    const std::string &path) {
+  char real_path[PATH_MAX];
+  struct stat status;
+  if (!realpath(path.c_str(), real_path) || stat(real_path, &status) != 0) {
+    return nullptr;
+  }
+  const auto key = absl::StrCat(real_path, "@", status.st_mtim.tv_sec, ".",
+                                status.st_mtim.tv_nsec);
+
+  absl::MutexLock lock(&mutex_);
+  PruneExpired();
+  auto &entry = models_[key];
+  auto model = entry.model.lock();
+  if (!model) {
+    // Loaded under the lock so two streams starting together don't both
+    // map the file.
+    model = std::shared_ptr<tflite::FlatBufferModel>(
+        tflite::FlatBufferModel::BuildFromFile(real_path));
+    if (!model) {
+      models_.erase(key);
+      return nullptr;
+    }
+    entry.model = model;
+    entry.bytes = model->allocation() ? model->allocation()->bytes() : 0;
+    entry.users = std::make_shared<std::atomic<size_t>>(0);
+  }
+  // The reference returned keeps the model alive and counts its user until
+  // it is released.
+  auto users = entry.users;
+  users->fetch_add(1);
+  return std::shared_ptr<tflite::FlatBufferModel>(
+      model.get(), [model, users](tflite::FlatBufferModel*) {
+        users->fetch_sub(1);
+      });
+}
+
+void ModelRegistry::PruneExpired() {
+  for (auto it = models_.begin(); it != models_.end();) {
+    if (it->second.model.expired()) {
+      it = models_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+size_t ModelRegistry::GetMappedBytes() {
+  absl::MutexLock lock(&mutex_);
+  size_t mapped = 0;
+  for (const auto &model : models_) {
+    if (*model.second.users > 0) {
+      mapped += model.second.bytes;
+    }
+  }
+  return mapped;
+}
+
+size_t ModelRegistry::GetDeduplicatedBytes() {
+  absl::MutexLock lock(&mutex_);
+  size_t deduplicated = 0;
+  for (const auto &model : models_) {
+    const size_t users = *model.second.users;
+    if (users > 1) {
+      deduplicated += (users - 1) * model.second.bytes;
+    }
+  }
+  return deduplicated;
+}
+
+ModelRegistry::ModelRegistry() {
+  auto &metrics = MetricsRegistry::GetInstance();
+  metrics.AddCallbackGauge(
+      "model_mapped_bytes",
+      "Bytes of the model files in use, each file mapped once.", "", [this] {
+        return static_cast<double>(GetMappedBytes());
+      });
+  metrics.AddCallbackGauge(
+      "model_deduplicated_bytes",
+      "Model file bytes the inferencers would have mapped loading their "
+      "models on their own, less the bytes mapped. Address space, the page "
+      "cache holds a file once anyway.",
+      "", [this] {
+        return static_cast<double>(GetDeduplicatedBytes());
+      });
+}
+
+ModelRegistry::~ModelRegistry() {
+}
+
+} /* namespace szd */
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * ModelRegistry.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_MODELREGISTRY_H_
+#define SRC_MODELREGISTRY_H_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/lite/model.h"
+
+namespace szd {
+
+// Process wide cache of the models in use. Inferencers loading the same
+// file, as it was on disk, share one memory mapped FlatBufferModel. The
+// registry only holds weak references, a model is unmapped when the last
+// reference Get() returned for it is released.
+class ModelRegistry {
+ public:
+  static ModelRegistry& GetInstance();
+  ModelRegistry(const ModelRegistry &other) = delete;
+  ModelRegistry(ModelRegistry &&other) = delete;
+  ModelRegistry& operator=(const ModelRegistry &other) = delete;
+  ModelRegistry& operator=(ModelRegistry &&other) = delete;
+  virtual ~ModelRegistry();
+
+  // Returns nullptr if the model can't be loaded. The model must outlive
+  // the interpreters built from it. Every call returns a reference of its
+  // own, held by one user of the model.
+  std::shared_ptr<tflite::FlatBufferModel> Get(const std::string &path);
+  // Bytes of the model files in use, each mapped once.
+  size_t GetMappedBytes();
+  // Bytes the users of the models in use would have mapped loading them on
+  // their own, less the bytes mapped. The pages of a file are in the page
+  // cache once however often it is mapped, so this is address space and
+  // mapping work more than resident memory.
+  size_t GetDeduplicatedBytes();
+
+ private:
+  struct Entry {
+    std::weak_ptr<tflite::FlatBufferModel> model;
+    size_t bytes;
+    // References Get() returned that are still held. Released without the
+    // registry lock.
+    std::shared_ptr<std::atomic<size_t>> users;
+  };
+
+  ModelRegistry();
+  // Drops the entries of models no inferencer uses any more, including the
+  // ones of files since changed on disk. Called with mutex_ held.
+  void PruneExpired();
+
+  absl::Mutex mutex_;
+  // Keyed by the real path and modification time, a model that changed on
+  // disk is loaded again.
+  std::map<std::string, Entry> models_;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_MODELREGISTRY_H_ */
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * OutputDecoders.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+
+#include "OutputDecoders.h"
+
+namespace szd {
+
+// Class scores are given per pixel when the last dimension isn't 1.
+static bool HasClassScores(const TfLiteTensor &tensor) {
+  const auto *dims = tensor.dims;
+  return dims->size == 4 && dims->data[3] > 1;
+}
+
+std::string GetTypeName(TfLiteType type) {
+  switch (type) {
+    case kTfLiteFloat32:
+      return "float32";
+    case kTfLiteUInt8:
+      return "uint8";
+    case kTfLiteInt8:
+      return "int8";
+    case kTfLiteInt32:
+      return "int32";
+    case kTfLiteInt64:
+      return "int64";
+    default:
+      return absl::StrCat("type", type);
+  }
+}
+
+TopKDecoder SelectTopKDecoder(const TfLiteTensor &tensor, std::string *name) {
+  *name = absl::StrCat("top_k_", GetTypeName(tensor.type));
+  switch (tensor.type) {
+    case kTfLiteFloat32:
+      return &DecodeTopK<float>;
+    case kTfLiteUInt8:
+      CHECK_GT(tensor.params.scale, 0.0f) << "Scores aren't quantized";
+      return &DecodeTopK<uint8_t>;
+    case kTfLiteInt8:
+      CHECK_GT(tensor.params.scale, 0.0f) << "Scores aren't quantized";
+      return &DecodeTopK<int8_t>;
+    default:
+      LOG(FATAL) << "Unsupported classification output type " << tensor.type;
+  }
+  return nullptr;
+}
+
+MaskDecoder SelectMaskDecoder(const TfLiteTensor &tensor, std::string *name) {
+  if (HasClassScores(tensor)) {
+    *name = absl::StrCat("argmax_", GetTypeName(tensor.type));
+    switch (tensor.type) {
+      case kTfLiteFloat32:
+        return &DecodeArgmaxMask<float>;
+      case kTfLiteUInt8:
+        return &DecodeArgmaxMask<uint8_t>;
+      case kTfLiteInt8:
+        return &DecodeArgmaxMask<int8_t>;
+      default:
+        LOG(FATAL) << "Unsupported segmentation score type " << tensor.type;
+    }
+  } else {
+    *name = absl::StrCat("class_ids_", GetTypeName(tensor.type));
+    switch (tensor.type) {
+      case kTfLiteInt64:
+        return &DecodeClassMask<int64_t>;
+      case kTfLiteInt32:
+        return &DecodeClassMask<int32_t>;
+      case kTfLiteUInt8:
+        return &DecodeClassMask<uint8_t>;
+      default:
+        LOG(FATAL) << "Unsupported segmentation output type " << tensor.type;
+    }
+  }
+  return nullptr;
+}
+
+size_t GetMaskSize(const TfLiteTensor &tensor) {
+  const auto *dims = tensor.dims;
+  size_t size = 1;
+  for (int i = 0; i < (HasClassScores(tensor) ? 3 : dims->size); ++i) {
+    size *= dims->data[i];
+  }
+  return size;
+}
+
+} /* namespace szd */
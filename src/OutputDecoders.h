@@ -0,0 +1,156 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * OutputDecoders.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_OUTPUTDECODERS_H_
+#define SRC_OUTPUTDECODERS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "tensorflow/lite/c/common.h"
+
+namespace szd {
+
+// Output decoders are compiled for the element type of the model outputs.
+// An inferencer selects the instantiation matching its model once when the
+// model is loaded and calls it through a function pointer on every frame, so
+// the loops over the outputs have no per element type checks or conversions.
+
+// Reads elements of type T as the real values they are quantized from.
+template<typename T>
+struct Dequantizer {
+  explicit Dequantizer(const TfLiteTensor &tensor)
+      :
+      scale(tensor.params.scale),
+      zero_point(tensor.params.zero_point) {
+  }
+  float operator()(T value) const {
+    return (static_cast<float>(value) - zero_point) * scale;
+  }
+  // The raw value x is quantized to, as a float so it compares exactly
+  // with any T.
+  float Quantize(float x) const {
+    return x / scale + zero_point;
+  }
+
+  float scale;
+  int zero_point;
+};
+
+template<>
+struct Dequantizer<float> {
+  explicit Dequantizer(const TfLiteTensor &tensor) {
+  }
+  float operator()(float value) const {
+    return value;
+  }
+  float Quantize(float x) const {
+    return x;
+  }
+};
+
+struct ClassScore {
+  int id;
+  float score;
+};
+
+// Writes the k classes scoring at least threshold, highest first, from the
+// scores of a classification model to out, and returns how many there were.
+// Scores are compared still quantized, only the ones kept are dequantized.
+template<typename T>
+size_t DecodeTopK(const TfLiteTensor &tensor, float threshold, size_t k,
+                  ClassScore *out) {
+  const Dequantizer<T> dequantize(tensor);
+  const T *scores = reinterpret_cast<const T*>(tensor.data.raw);
+  const size_t n = tensor.bytes / sizeof(T);
+  const float raw_threshold = dequantize.Quantize(threshold);
+  size_t found = 0;
+  if (k == 0) {
+    return 0;
+  }
+  // Kept in out sorted by raw score, k is a handful at most.
+  for (size_t i = 0; i < n; ++i) {
+    const float score = scores[i];
+    if (!(score >= raw_threshold)
+        || (found == k && !(score > out[k - 1].score))) {
+      continue;
+    }
+    size_t j = found < k ? found++ : k - 1;
+    for (; j > 0 && out[j - 1].score < score; --j) {
+      out[j] = out[j - 1];
+    }
+    out[j] = { static_cast<int>(i), score };
+  }
+  for (size_t j = 0; j < found; ++j) {
+    out[j].score = dequantize(static_cast<T>(out[j].score));
+  }
+  return found;
+}
+
+// Writes the class of each pixel of a segmentation model that outputs class
+// ids, [1, height, width] with the argmax in the graph, to mask.
+template<typename T>
+void DecodeClassMask(const TfLiteTensor &tensor, uint8_t *mask) {
+  const T *ids = reinterpret_cast<const T*>(tensor.data.raw);
+  const size_t n = tensor.bytes / sizeof(T);
+  for (size_t i = 0; i < n; ++i) {
+    mask[i] = static_cast<uint8_t>(ids[i]);
+  }
+}
+
+// Writes the class of each pixel of a segmentation model that outputs a
+// score per class, [1, height, width, classes], to mask. Quantization keeps
+// the order of the scores, so the argmax is taken on the raw values.
+template<typename T>
+void DecodeArgmaxMask(const TfLiteTensor &tensor, uint8_t *mask) {
+  const T *scores = reinterpret_cast<const T*>(tensor.data.raw);
+  const size_t classes = tensor.dims->data[tensor.dims->size - 1];
+  const size_t n = tensor.bytes / sizeof(T) / classes;
+  for (size_t i = 0; i < n; ++i, scores += classes) {
+    uint8_t best_id = 0;
+    T best = scores[0];
+    for (size_t c = 1; c < classes; ++c) {
+      if (scores[c] > best) {
+        best = scores[c];
+        best_id = c;
+      }
+    }
+    mask[i] = best_id;
+  }
+}
+
+typedef size_t (*TopKDecoder)(const TfLiteTensor &tensor, float threshold,
+                              size_t k, ClassScore *out);
+typedef void (*MaskDecoder)(const TfLiteTensor &tensor, uint8_t *mask);
+
+// The instantiations for the type and shape of tensor. name is set to what
+// the decoder is called in the metrics. Unsupported outputs are fatal.
+TopKDecoder SelectTopKDecoder(const TfLiteTensor &tensor, std::string *name);
+MaskDecoder SelectMaskDecoder(const TfLiteTensor &tensor, std::string *name);
+// Pixels in the mask of a segmentation model output.
+size_t GetMaskSize(const TfLiteTensor &tensor);
+// Lower case, as used in the decoder names.
+std::string GetTypeName(TfLiteType type);
+
+} /* namespace szd */
+
+#endif /* SRC_OUTPUTDECODERS_H_ */
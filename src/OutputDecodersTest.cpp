@@ -0,0 +1,230 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * OutputDecodersTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "OutputDecoders.h"
+#include "RawDetectionDecoder.h"
+
+namespace szd {
+
+// Frames decoded per benchmark, enough for the per frame cost to settle.
+static const int kFrames = 200;
+
+// Decodes kFrames frames with decode and prints the cost of one.
+template<typename F>
+static double Benchmark(const std::string &name, F decode) {
+  decode();
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kFrames; ++i) {
+    decode();
+  }
+  const double us = std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - start).count() / kFrames;
+  printf("%-24s %9.1f us/frame\n", name.c_str(), us);
+  return us;
+}
+
+// An output tensor of type T and shape dims over data, with random values.
+template<typename T>
+class FakeOutput {
+ public:
+  FakeOutput(TfLiteType type, const std::vector<int> &dims, float scale,
+             int zero_point) {
+    size_t n = 1;
+    dims_ = TfLiteIntArrayCreate(dims.size());
+    for (size_t i = 0; i < dims.size(); ++i) {
+      dims_->data[i] = dims[i];
+      n *= dims[i];
+    }
+    data_.resize(n);
+    std::mt19937 random(n);
+    std::uniform_int_distribution<int> values(0, 100);
+    for (auto &value : data_) {
+      value = static_cast<T>(values(random));
+    }
+    tensor_.type = type;
+    tensor_.data.raw = reinterpret_cast<char*>(data_.data());
+    tensor_.dims = dims_;
+    tensor_.params.scale = scale;
+    tensor_.params.zero_point = zero_point;
+    tensor_.bytes = n * sizeof(T);
+  }
+  FakeOutput(const FakeOutput &other) = delete;
+  FakeOutput& operator=(const FakeOutput &other) = delete;
+  ~FakeOutput() {
+    TfLiteIntArrayFree(dims_);
+  }
+
+  const TfLiteTensor& tensor() const {
+    return tensor_;
+  }
+  std::vector<T>& data() {
+    return data_;
+  }
+
+ private:
+  TfLiteIntArray *dims_;
+  std::vector<T> data_;
+  TfLiteTensor tensor_ = { };
+};
+
+// Top 5 of the 1001 classes of the MobileNet classifiers.
+template<typename T>
+static void BenchmarkTopK(TfLiteType type, float scale, int zero_point) {
+  FakeOutput<T> output(type, { 1, 1001 }, scale, zero_point);
+  std::string name;
+  const TopKDecoder decode = SelectTopKDecoder(output.tensor(), &name);
+  ClassScore top[5];
+  size_t found = 0;
+  Benchmark(name, [&] {
+    found = decode(output.tensor(), 0.0f, 5, top);
+  });
+  ASSERT_EQ(found, 5u);
+  for (size_t i = 1; i < found; ++i) {
+    EXPECT_GE(top[i - 1].score, top[i].score);
+  }
+}
+
+TEST(OutputDecodersTest, TopKFloat) {
+  BenchmarkTopK<float>(kTfLiteFloat32, 0.0f, 0);
+}
+
+TEST(OutputDecodersTest, TopKUInt8) {
+  BenchmarkTopK<uint8_t>(kTfLiteUInt8, 1.0f / 256, 0);
+}
+
+TEST(OutputDecodersTest, TopKInt8) {
+  BenchmarkTopK<int8_t>(kTfLiteInt8, 1.0f / 256, -128);
+}
+
+// The 513x513 masks of DeepLab with the argmax in the graph.
+template<typename T>
+static void BenchmarkClassMask(TfLiteType type) {
+  FakeOutput<T> output(type, { 1, 513, 513 }, 0.0f, 0);
+  std::string name;
+  const MaskDecoder decode = SelectMaskDecoder(output.tensor(), &name);
+  std::vector<uint8_t> mask(GetMaskSize(output.tensor()));
+  Benchmark(name, [&] {
+    decode(output.tensor(), mask.data());
+  });
+  EXPECT_EQ(mask[1000], static_cast<uint8_t>(output.data()[1000]));
+}
+
+TEST(OutputDecodersTest, ClassMaskInt64) {
+  BenchmarkClassMask<int64_t>(kTfLiteInt64);
+}
+
+TEST(OutputDecodersTest, ClassMaskInt32) {
+  BenchmarkClassMask<int32_t>(kTfLiteInt32);
+}
+
+TEST(OutputDecodersTest, ClassMaskUInt8) {
+  BenchmarkClassMask<uint8_t>(kTfLiteUInt8);
+}
+
+// The 21 class scores per pixel of DeepLab exported without the argmax.
+template<typename T>
+static void BenchmarkArgmaxMask(TfLiteType type, float scale,
+                                int zero_point) {
+  FakeOutput<T> output(type, { 1, 257, 257, 21 }, scale, zero_point);
+  std::string name;
+  const MaskDecoder decode = SelectMaskDecoder(output.tensor(), &name);
+  std::vector<uint8_t> mask(GetMaskSize(output.tensor()));
+  ASSERT_EQ(mask.size(), 257u * 257u);
+  Benchmark(name, [&] {
+    decode(output.tensor(), mask.data());
+  });
+  const T *scores = output.data().data() + 1000 * 21;
+  EXPECT_EQ(mask[1000], std::max_element(scores, scores + 21) - scores);
+}
+
+TEST(OutputDecodersTest, ArgmaxMaskFloat) {
+  BenchmarkArgmaxMask<float>(kTfLiteFloat32, 0.0f, 0);
+}
+
+TEST(OutputDecodersTest, ArgmaxMaskUInt8) {
+  BenchmarkArgmaxMask<uint8_t>(kTfLiteUInt8, 1.0f / 256, 0);
+}
+
+TEST(OutputDecodersTest, ArgmaxMaskInt8) {
+  BenchmarkArgmaxMask<int8_t>(kTfLiteInt8, 1.0f / 256, -128);
+}
+
+// The 1917 anchors and 91 classes of SSD MobileNet exported without the
+// postprocess op, a few anchors above the threshold.
+template<typename T>
+static void BenchmarkRawSsd(const std::string &name, TensorFormat::Type type,
+                            float scale, int zero_point) {
+  const size_t kAnchors = 1917;
+  const size_t kClasses = 91;
+  const std::string anchors_path = ::testing::TempDir()
+      + "output_decoders_anchors.csv";
+  {
+    std::ofstream anchors(anchors_path);
+    for (size_t i = 0; i < kAnchors; ++i) {
+      anchors << (i % 19 + 0.5f) / 19 << "," << (i / 19 % 19 + 0.5f) / 19
+              << ",0.2,0.2\n";
+    }
+  }
+  TensorFormat format;
+  format.type = type;
+  format.scale = scale;
+  format.zero_point = zero_point;
+  // Logits of -5 everywhere but on every hundredth anchor.
+  const T low = static_cast<T>(-5.0f / scale + zero_point);
+  const T high = static_cast<T>(2.0f / scale + zero_point);
+  std::vector<T> boxes(kAnchors * 4, static_cast<T>(zero_point));
+  std::vector<T> scores(kAnchors * kClasses, low);
+  for (size_t i = 0; i < kAnchors; i += 100) {
+    scores[i * kClasses + 1 + i % (kClasses - 1)] = high;
+  }
+  RawDetectionDecoder decoder(anchors_path, kClasses, format, format,
+                              RawDetectionDecoder::kLogits, 0.5f);
+  size_t found = 0;
+  Benchmark(name, [&] {
+    found = decoder.Decode(boxes.data(), scores.data(), -1).size();
+  });
+  EXPECT_EQ(found, (kAnchors + 99) / 100);
+}
+
+TEST(OutputDecodersTest, RawSsdFloat) {
+  BenchmarkRawSsd<float>("raw_ssd_float32", TensorFormat::kFloat32, 1.0f, 0);
+}
+
+TEST(OutputDecodersTest, RawSsdUInt8) {
+  BenchmarkRawSsd<uint8_t>("raw_ssd_uint8", TensorFormat::kUInt8, 0.1f, 128);
+}
+
+TEST(OutputDecodersTest, RawSsdInt8) {
+  BenchmarkRawSsd<int8_t>("raw_ssd_int8", TensorFormat::kInt8, 0.1f, 0);
+}
+
+} /* namespace szd */
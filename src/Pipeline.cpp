@@ -25,25 +25,54 @@
 #endif
 
 #include <functional>
+#include <future>
 #include <string>
+#include <utility>
 
 #include <glib.h>
 #include <gst/gst.h>
 
+#include "absl/strings/str_cat.h"
+
+#include "CascadeInferencerBin.h"
 #include "ClassificationInferencer.h"
 #include "DetectionInferencer.h"
 #include "InferencerBin.h"
 #include "ManufacturingInferencer.h"
+#include "Metrics.h"
 #include "MixerBin.h"
+#include "MockDeviceProvider.h"
 #include "Pipeline.h"
 #include "PipelinedInferencer.h"
 #include "SegmentationInferencer.h"
-#include "TwoModelInferencerBin.h"
+#include "SourceBin.h"
+#include "StartupTimeline.h"
+#include "ThreadPlacement.h"
+#include "TiledInferencerBin.h"
+#include "TpuScheduler.h"
+#include "Tracer.h"
+#include "VideoInfoCache.h"
 
 namespace szd {
 
+void Pipeline::ReportQos(GstMessage *msg) {
+  // Elements in a stream's bin only handle its frames, the ones after the
+  // mixer handle the frames of all streams.
+  for (auto &infbin : inferencer_bins_) {
+    if (gst_object_has_as_ancestor(GST_MESSAGE_SRC(msg),
+                                   GST_OBJECT(infbin->GetBin()))) {
+      infbin->ReportQos();
+      return;
+    }
+  }
+  for (auto &infbin : inferencer_bins_) {
+    infbin->ReportQos();
+  }
+}
+
 gboolean Pipeline::BusWatcher(GstBus *bus, GstMessage *msg, gpointer data) {
-  auto loop = reinterpret_cast<Pipeline::user_data*>(data)->loop;
+  auto ud = reinterpret_cast<Pipeline::user_data*>(data);
+  auto loop = ud->loop;
 
   switch (GST_MESSAGE_TYPE(msg)) {
     case GST_MESSAGE_EOS:
@@ -63,6 +92,10 @@ gboolean Pipeline::BusWatcher(GstBus *bus, GstMessage *msg, gpointer data) {
       g_main_loop_quit(loop);
       break;
     }
+    case GST_MESSAGE_QOS:
+      // An element dropped or was late with a frame, the display stutters.
+      ud->pipeline->ReportQos(msg);
+      break;
     default:
       break;
   }
@@ -72,15 +105,40 @@ gboolean Pipeline::BusWatcher(GstBus *bus, GstMessage *msg, gpointer data) {
 
 Pipeline::Pipeline(int argc, char **argv) {
   gst_init(&argc, &argv);
+  if (kEnableTracing) {
+    Tracer::GetInstance().Enable();
+  }
   pipeline_ = gst_pipeline_new("video-player");
   loop_ = g_main_loop_new(NULL, FALSE);
   bus_ = gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
-  ud_ = { loop_ };
+  ud_ = { loop_, this };
   bus_watch_id_ = gst_bus_add_watch(bus_, BusWatcher,
                                     reinterpret_cast<void*>(&ud_));
+  if (!kThreadPolicies.empty()) {
+    gst_bus_set_sync_handler(bus_, ThreadPlacement::OnBusSync, NULL, NULL);
+  }
   mixer_ = std::make_shared<MixerBin>();
+  sources_ = std::make_shared<SourceRegistry>(pipeline_,
+                                              kCacheDecodedFrames);
   gst_object_unref(bus_);
 
+  if (kUseMockTpus) {
+    DeviceProvider::Set(std::make_shared<MockDeviceProvider>(MockTpuConfig()));
+  }
+  InferencerBase::SetWarmUpInvokes(kWarmUpInvokes);
+  // Their invokes on the shared TPU don't reload its parameter cache.
+  TpuScheduler::SetCoCompiled({ kCoCompiledModel1, kCoCompiledModel2 });
+
+  // The videos are discovered while the models load, each model loads on a
+  // thread of its own.
+  StartupTimeline timeline;
+  if (kVideoInfoCacheFile) {
+    VideoInfoCache::GetInstance().SetCacheFile(kVideoInfoCacheFile);
+  }
+  auto videos_discovered = timeline.Start("discover_videos", [this] {
+    VideoInfoCache::GetInstance().Prefetch(kVideoStreams);
+  });
+
 #if NO_INFERENCING
   auto piplined_inferencer = std::make_shared<InferencerBase>();
   auto seg_inferencer = std::make_shared<InferencerBase>();
@@ -90,44 +148,134 @@ Pipeline::Pipeline(int argc, char **argv) {
   auto det_inferencer_mnv2_2 = std::make_shared<InferencerBase>();
 
 #else
-  auto piplined_inferencer = std::make_shared<PipelinedInferencer>(
-      kPipelinedModel, kPipelinedLabels, kPipelinedObject, kThreshold,
-      kPipelinedNumTPUs);
-  auto seg_inferencer = std::make_shared<SegmentationInferencer>(
-      kSegmentationModel, kSegmentationLabels, kSegmentationObject, kThreshold);
-  auto mfg_inferencer = std::make_shared<ManufacturingInferencer>(
-      kManufacturingModel, kManufacturingLabels, kThreshold,
-      kManufacuringPolygon);
-  auto det_to_class_inferencer = std::make_shared<DetectionInferencer>(
-      kCoCompiledModel1, kCoCompiledLabels1, kThreshold, kCoCompiledObject);
-  auto class_inferencer = std::make_shared<ClassificationInferencer>(
-      kCoCompiledModel2, kCoCompiledLabels2, kThreshold,
-      *det_to_class_inferencer);
-  auto det_inferencer_mnv2_2 = std::make_shared<DetectionInferencer>(
-      kDetectionModel, kDetectionLabels, kThreshold, kAnyObject);
-#endif
-
-  // Put together the Gstreamer Pipeline
-  gst_bin_add(GST_BIN(pipeline_), mixer_->GetBin());
-  int i = 0;
-  std::vector<std::shared_ptr<InferencerBase>> inferencers =
-      { piplined_inferencer, seg_inferencer, mfg_inferencer,
-          det_inferencer_mnv2_2 };
-  for (auto inferencer : inferencers) {
-    inferencer_bins_.push_back(
-        std::make_shared<InferencerBin>(inferencer, kVideoStreams[i]));
-    i += 1;
+  timeline.Run("open_tpus", [] {
+    InferencerBase::OpenAllTpus();
+  });
+  auto piplined_loaded = timeline.Start("load_pipelined", [this] {
+    return std::make_shared<PipelinedInferencer>(kPipelinedModel,
+                                                 kPipelinedLabels,
+                                                 kPipelinedObject, kThreshold,
+                                                 kPipelinedNumTPUs);
+  });
+  auto seg_loaded = timeline.Start("load_segmentation", [this] {
+    return std::make_shared<SegmentationInferencer>(kSegmentationModel,
+                                                    kSegmentationLabels,
+                                                    kSegmentationObject,
+                                                    kThreshold);
+  });
+  auto mfg_loaded = timeline.Start("load_manufacturing", [this] {
+    return std::make_shared<ManufacturingInferencer>(kManufacturingModel,
+                                                     kManufacturingLabels,
+                                                     kThreshold,
+                                                     kManufacuringPolygon);
+  });
+  // The classifier shares the TPU of the detector it is co-compiled with.
+  auto co_compiled_loaded = timeline.Start("load_co_compiled", [this] {
+    auto detector = std::make_shared<DetectionInferencer>(kCoCompiledModel1,
+                                                          kCoCompiledLabels1,
+                                                          kThreshold,
+                                                          kCoCompiledObject);
+    auto classifier = std::make_shared<ClassificationInferencer>(
+        kCoCompiledModel2, kCoCompiledLabels2, kThreshold, *detector);
+    return std::make_pair(detector, classifier);
+  });
+  auto det_loaded = timeline.Start("load_detection", [this] {
+    return std::make_shared<DetectionInferencer>(kDetectionModel,
+                                                 kDetectionLabels, kThreshold,
+                                                 kAnyObject);
+  });
+  std::vector<std::future<std::shared_ptr<DetectionInferencer>>> tiles_loaded;
+  for (size_t j = 1; j < kTiledDetectionNumTPUs; j++) {
+    tiles_loaded.push_back(
+        timeline.Start(absl::StrCat("load_tile_detection_", j), [this] {
+          return std::make_shared<DetectionInferencer>(kDetectionModel,
+                                                       kDetectionLabels,
+                                                       kThreshold,
+                                                       kAnyObject);
+        }));
   }
 
-  inferencer_bins_.push_back(
-      std::make_shared<TwoModelInferencerBin>(det_to_class_inferencer,
-                                              class_inferencer,
-                                              kVideoStreams[i++]));
-  for (auto infbin : inferencer_bins_) {
-    CHECK(gst_bin_add(GST_BIN(pipeline_),infbin->GetBin()));
-    CHECK(mixer_->LinkInput(*infbin));
+  auto piplined_inferencer = piplined_loaded.get();
+  auto seg_inferencer = seg_loaded.get();
+  auto mfg_inferencer = mfg_loaded.get();
+  auto co_compiled = co_compiled_loaded.get();
+  auto det_to_class_inferencer = co_compiled.first;
+  auto class_inferencer = co_compiled.second;
+  auto det_inferencer_mnv2_2 = det_loaded.get();
+#endif
+  std::vector<std::shared_ptr<InferencerBase>> tile_inferencers;
+  if (kTiledDetectionNumTPUs > 0) {
+    tile_inferencers.push_back(det_inferencer_mnv2_2);
+  }
+#if !NO_INFERENCING
+  for (auto &tile_loaded : tiles_loaded) {
+    tile_inferencers.push_back(tile_loaded.get());
   }
+#endif
+  videos_discovered.get();
+
+  // Applies the class filter of stream to its detection models.
+  auto set_class_filter = [this](size_t stream,
+      const std::shared_ptr<InferencerBase> &inferencer) {
+    auto detector = std::dynamic_pointer_cast<DetectionInferencer>(inferencer);
+    if (detector && stream < kClassFilters.size()) {
+      detector->SetClassFilter(kClassFilters[stream]);
+    }
+  };
+
+  // Adds the bin of the video at index video of kVideoStreams and applies
+  // the scheduling and thread policies of that video to it.
+  auto add_bin = [this](size_t video, std::shared_ptr<InferencerBin> bin) {
+    const int stream = bin->GetTraceStream();
+    if (video < kStreamPolicies.size()) {
+      TpuScheduler::SetStreamPolicy(stream, kStreamPolicies[video]);
+    }
+    ThreadPlacement::SetPolicy(
+        stream,
+        video < kThreadPolicies.size() ? kThreadPolicies[video] :
+            kDefaultThreadPolicy,
+        bin->GetTpuPath());
+    ThreadPlacement::AddBin(bin->GetBin(), stream);
+    inferencer_bins_.push_back(bin);
+  };
 
+  // Put together the Gstreamer Pipeline
+  timeline.Run("build_bins", [&] {
+    gst_bin_add(GST_BIN(pipeline_), mixer_->GetBin());
+    size_t i = 0;
+    std::vector<std::shared_ptr<InferencerBase>> inferencers =
+        { piplined_inferencer, seg_inferencer, mfg_inferencer };
+    if (tile_inferencers.empty()) {
+      inferencers.push_back(det_inferencer_mnv2_2);
+    }
+    for (auto inferencer : inferencers) {
+      set_class_filter(i, inferencer);
+      add_bin(i, std::make_shared<InferencerBin>(inferencer, kVideoStreams[i]));
+      i += 1;
+    }
+    if (!tile_inferencers.empty()) {
+      for (auto &inferencer : tile_inferencers) {
+        set_class_filter(i, inferencer);
+      }
+      add_bin(i, std::make_shared<TiledInferencerBin>(tile_inferencers,
+                                                      kVideoStreams[i],
+                                                      kTiledFrameBudgetNs));
+      i += 1;
+    }
+
+    set_class_filter(i, det_to_class_inferencer);
+    std::vector<CascadeStage> stages = { { det_to_class_inferencer },
+        { class_inferencer, { }, 0.0f, kClassifiedPerFrame } };
+    add_bin(i, std::make_shared<CascadeInferencerBin>(stages,
+                                                      kVideoStreams[i]));
+    for (auto infbin : inferencer_bins_) {
+      infbin->SetLetterbox(kLetterboxInput);
+      CHECK(gst_bin_add(GST_BIN(pipeline_),infbin->GetBin()));
+      CHECK(mixer_->LinkInput(*infbin));
+      CHECK(sources_->Link(*infbin));
+    }
+  });
+  timeline.Print();
 }
 
 Pipeline::~Pipeline() {
@@ -143,17 +291,40 @@ void Pipeline::Run() {
   // Wait for pipeline to reach PLAYING
   gst_element_get_state(pipeline_, NULL, NULL, GST_CLOCK_TIME_NONE);
 
-  for (auto infbin : inferencer_bins_) {
-    infbin->Rewind();
-  }
+  sources_->Rewind();
 
   GST_DEBUG_BIN_TO_DOT_FILE_WITH_TS(GST_BIN (pipeline_),
                                     GST_DEBUG_GRAPH_SHOW_ALL,
                                     "myplayer_after_play");
 
+  auto &metrics = MetricsRegistry::GetInstance();
+  if (kMetricsPort && !metrics.StartHttpServer(kMetricsPort)) {
+    g_printerr("Failed to serve metrics on port %d\n", kMetricsPort);
+  }
+  if (kMetricsTextfile) {
+    metrics_timeout_id_ = g_timeout_add_seconds(
+        kMetricsTextfileIntervalSec,
+        reinterpret_cast<GSourceFunc>(+[](Pipeline *self) -> gboolean {
+          if (!MetricsRegistry::GetInstance().WriteTextfile(
+              self->kMetricsTextfile)) {
+            g_printerr("Failed to write metrics to %s\n",
+                       self->kMetricsTextfile);
+          }
+          return TRUE;
+        }),
+        this);
+  }
+
   g_main_loop_run(loop_);
 
   gst_element_set_state(pipeline_, GST_STATE_NULL);
+  if (Tracer::GetInstance().IsEnabled()) {
+    Tracer::GetInstance().WriteChromeTrace(kTraceFile);
+  }
+  if (metrics_timeout_id_) {
+    g_source_remove(metrics_timeout_id_);
+    metrics.WriteTextfile(kMetricsTextfile);
+  }
 
   gst_object_unref(GST_OBJECT(pipeline_));
   g_source_remove(bus_watch_id_);
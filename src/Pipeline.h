@@ -25,7 +25,11 @@
 
 #include <vector>
 
+#include "DetectionInferencer.h"
 #include "InferencerBin.h"
+#include "SourceBin.h"
+#include "ThreadPlacement.h"
+#include "TpuScheduler.h"
 
 namespace szd {
 
@@ -64,26 +68,87 @@ class Pipeline {
   const char *kCoCompiledModel2 =
       "models/mobilenet_v2_1.0_224_inat_bird_quant_edgetpu.tflite";
   const char *kCoCompiledLabels2 = "models/birds_labels.txt";
+  // Birds classified per frame, the highest scoring detections first.
+  const size_t kClassifiedPerFrame = 8;
 
   const char *kDetectionModel =
       "models/ssd_mobilenet_v2_coco_quant_postprocess_edgetpu.tflite";
   const char *kDetectionLabels = "models/coco_labels.txt";
+  // Run the detection stream on overlapping tiles of the full frame spread
+  // over this many TPUs, see TiledInferencerBin. Every TPU past the first
+  // must be available beyond the 8 the demo needs, 0 to disable.
+  const size_t kTiledDetectionNumTPUs = 0;
+  // TPU time a tiled frame may take, more tiles are inferred as long as
+  // they fit.
+  const uint64_t kTiledFrameBudgetNs = 100000000;
+  // How the streams, indexed like kVideoStreams, share a TPU when they run
+  // on the same one: weight, minimum inferences per second and the deadline
+  // in ns after which a waiting frame is dropped. The safety zone camera is
+  // never dropped and keeps its rate, the bird cameras give way. Streams
+  // past the end get the default policy. In the default layout every stream
+  // has TPUs of its own, so these only take effect once streams are moved
+  // onto a shared TPU. The segments of the pipelined model run on TPUs of
+  // their own and are not scheduled.
+  const std::vector<StreamPolicy> kStreamPolicies = { { }, { },
+      { 4.0, 15.0, 0 }, { }, { 1.0, 0.0, 200000000 },
+      { 1.0, 0.0, 200000000 } };
+  // Classes the detection model of each stream reports, indexed like
+  // kVideoStreams, see DetectionInferencer::ClassFilter. The default filter
+  // reports the detection object of the model. The garden camera detects
+  // all classes but leaves out the furniture and plants always in view.
+  const std::vector<DetectionInferencer::ClassFilter> kClassFilters = { { },
+      { }, { }, { { }, { }, { "bench", "chair", "potted plant" } } };
+  // CPUs and priorities of the threads of each stream, indexed like
+  // kVideoStreams, see ThreadPlacement. E.g. on a 16 core host, to keep each
+  // stream on a pair of cores near its TPU with real-time inference:
+  //   { { { 0 }, { 1 }, true, 10 }, { { 2 }, { 3 }, true, 10 }, ... }
+  // Streams past the end get kDefaultThreadPolicy.
+  const std::vector<ThreadPolicy> kThreadPolicies = { };
+  // Leaves the threads of streams without a policy where the kernel puts
+  // them, pinning is opt-in through kThreadPolicies.
+  const ThreadPolicy kDefaultThreadPolicy = { { }, { }, false, 0 };
 
   const float kThreshold = 0.5;
+  // Keep the aspect ratio of the videos when scaling them for detection.
+  const bool kLetterboxInput = false;
+  // Decode each video once into memory at startup and replay it from there,
+  // useful for repeatable benchmarks.
+  const bool kCacheDecodedFrames = false;
+  // Record per stage timing spans, see Tracer.
+  const bool kEnableTracing = false;
+  // Invokes on synthetic input run by every interpreter when it is created,
+  // so the first frames of the streams don't pay for loading the model.
+  const int kWarmUpInvokes = 3;
+  // Run the models on simulated Edge TPUs, see MockDeviceProvider.
+  const bool kUseMockTpus = false;
+  // Serve Prometheus metrics on 127.0.0.1 at this port, 0 to disable.
+  const int kMetricsPort = 0;
+  // Rewrite the metrics to this file every kMetricsTextfileIntervalSec for
+  // the node exporter textfile collector, nullptr to disable.
+  const char *kMetricsTextfile = nullptr;
+  const guint kMetricsTextfileIntervalSec = 10;
+  // Where the sizes of the videos are kept between runs, nullptr to
+  // discover them on every start.
+  const char *kVideoInfoCacheFile = "videos/.video_info_cache";
   const char *kAnyObject = "all";
   std::vector<std::shared_ptr<InferencerBin>> inferencer_bins_;
   std::shared_ptr<MixerBin> mixer_;
+  std::shared_ptr<SourceRegistry> sources_;
 
   struct user_data {
     GMainLoop *loop;
+    Pipeline *pipeline;
   };
 
   static gboolean BusWatcher(GstBus *bus, GstMessage *msg, gpointer data);
+  // Passes a QoS message to the streams whose frames it is about.
+  void ReportQos(GstMessage *msg);
 
   GstBus *bus_;
   GMainLoop *loop_;
   GstElement *pipeline_;
   guint bus_watch_id_;
+  guint metrics_timeout_id_ = 0;
   user_data ud_;
 };
 
@@ -19,73 +19,99 @@
  *  Created on: Apr 16, 2021
  *      Author: pnordstrom
  */
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/substitute.h"
 #include "coral/tflite_utils.h"
 
+#include "ModelRegistry.h"
 #include "PipelinedInferencer.h"
+#include "ThreadPlacement.h"
 
 namespace szd {
 
 void PipelinedInferencer::InterpretFrame(const uint8_t *pixels,
                                          size_t pixel_length, size_t width,
                                          size_t height, size_t stride,
-                                         std::shared_ptr<void> &return_data) {
-  coral::PipelineTensor input_buffer;
-  std::string boxlist;
-  std::string labellist;
-  std::string svg;
+                                         InferenceResult &result) {
+  if (!running_) {
+    // Checked before Alloc takes the frame, nothing would free it once the
+    // runner is stopped.
+    result.Clear();
+    result.dropped = true;
+    return;
+  }
 
   const TfLiteTensor *input_tensor = interpreter_->input_tensor(0);
 
   auto alloc = runner_->GetInputTensorAllocator();
+  coral::PipelineTensor input_buffer;
   input_buffer.buffer = alloc->Alloc(input_tensor->bytes);
 
   input_buffer.type = input_tensor->type;
   input_buffer.bytes = input_tensor->bytes;
   input_buffer.name = input_tensor->name;
 
-  if (running_) {
-    CHECK(runner_->Push( { input_buffer }).ok());
-    mutex_.Lock();
-    frames_in_tpu_queue++;
-    while (frames_in_tpu_queue >= kMaxQueueSize) {
-      cond_.Wait(&mutex_);
-    }
-
-    auto results = std::make_shared<std::vector<DetectionResult>>(results_);
-    mutex_.Unlock();
-
-    return_data = results;
+  TraceSpan span("push");
+  mutex_.Lock();
+  // Frames leave the runner in the order they were pushed. They are
+  // counted before the push so the consumer never pops an unknown frame.
+  pending_frames_[(pending_head_ + frames_in_tpu_queue) % kMaxQueueSize] = {
+      Tracer::GetContext(), Tracer::Now() };
+  frames_in_tpu_queue++;
+  if (in_flight_) {
+    in_flight_->Set(frames_in_tpu_queue);
+  }
+  mutex_.Unlock();
+  CHECK(runner_->Push( { input_buffer }).ok());
+  mutex_.Lock();
+  while (frames_in_tpu_queue >= kMaxQueueSize) {
+    cond_.Wait(&mutex_);
   }
-  return;
+
+  // Copied into the capacity the caller's result already has.
+  result.Clear();
+  result.detections = results_;
+  mutex_.Unlock();
 }
 
 void PipelinedInferencer::ConsumeRunner() {
   std::vector<coral::PipelineTensor> output_tensors;
   while (runner_->Pop(&output_tensors).ok() && running_) {
     mutex_.Lock();
+    const auto &pending = pending_frames_[pending_head_];
+    const auto pop_ns = Tracer::Now();
+    // The metrics are only there once a bin has set them up.
+    if (latency_) {
+      latency_->ObserveNs(pop_ns - pending.push_ns);
+    }
+    Tracer::SetContext(pending.context.stream, pending.context.pts);
+    ThreadPlacement::Enter(pending.context.stream,
+                           ThreadPlacement::kInference);
+    Tracer::GetInstance().Record("tpu_pipeline", pending.push_ns, pop_ns);
+    pending_head_ = (pending_head_ + 1) % kMaxQueueSize;
     frames_in_tpu_queue--;
+    if (in_flight_) {
+      in_flight_->Set(frames_in_tpu_queue);
+    }
     cond_.SignalAll();
-    std::vector<std::vector<float>> output_data;
-    const size_t num_outputs = output_tensors.size();
-    CHECK_EQ(num_outputs, 4);
-    output_data.resize(num_outputs);
-
-    for (size_t i = 0; i < num_outputs; ++i) {
-      const auto *out_tensor = reinterpret_cast<float*>(output_tensors[i].buffer
-          ->ptr());
-      CHECK_NOTNULL(out_tensor);
-      if (output_tensors[i].type == kTfLiteFloat32) {  // detection model out is Float32
-        const size_t num_values = output_tensors[i].bytes / sizeof(float);
-
-        output_data[i].resize(num_values);
-        for (size_t j = 0; j < num_values; ++j) {
-          output_data[i][j] = out_tensor[j];
-        }
+    if (raw_decoder_) {
+      DecodeRawOutputs(output_tensors[raw_boxes_index_].buffer->ptr(),
+                       output_tensors[raw_scores_index_].buffer->ptr(),
+                       &results_);
+    } else {
+      CHECK_EQ(output_tensors.size(), 4);
+      const float *outputs[4];
+      for (size_t i = 0; i < 4; ++i) {
+        // Checked to be Float32 when the model was loaded.
+        outputs[i] = reinterpret_cast<const float*>(
+            CHECK_NOTNULL(output_tensors[i].buffer->ptr()));
       }
+      ParseOutputs(outputs[0], outputs[1], outputs[2], outputs[3], &results_);
     }
-    results_ = ParseOutputs(output_data);
     mutex_.Unlock();
 
     for (const auto& tensor : output_tensors) {
@@ -95,11 +121,19 @@ void PipelinedInferencer::ConsumeRunner() {
   }
 }
 
-void PipelinedInferencer::InitializePipelineRunner(
-    coral::Allocator *allocator,
-    std::function<void(const std::string)> output_cb) {
+void PipelinedInferencer::SetupMetrics(const std::string &labels) {
+  auto &registry = MetricsRegistry::GetInstance();
+  in_flight_ = registry.GetGauge("pipeline_frames_in_flight",
+                                 "Frames pushed to the TPU pipeline and not "
+                                 "popped yet.",
+                                 labels);
+  latency_ = registry.GetLatencyHistogram(
+      "inference_latency_seconds", "Time from input to model results.",
+      labels);
+}
 
-  output_cb_ = output_cb;
+void PipelinedInferencer::InitializePipelineRunner(
+    coral::Allocator *allocator) {
   std::vector<tflite::Interpreter*> runner_interpreters(num_tpus_);
 
   for (size_t i = 0; i < num_tpus_; ++i) {
@@ -129,9 +163,6 @@ PipelinedInferencer::PipelinedInferencer(const std::string &model_path_base,
 
   for (size_t i = 0; i < num_tpus_; ++i) {
     CHECK_NOTNULL(tpu_contexts_[i]);
-    if (tpu_contexts_[i]->GetDeviceEnumRecord().type
-        == edgetpu::DeviceType::kApexPci) {
-    }
   }
 
   for (size_t i = 0; i < num_tpus_; ++i) {
@@ -143,15 +174,30 @@ PipelinedInferencer::PipelinedInferencer(const std::string &model_path_base,
 
   for (size_t i = 0; i < num_tpus_; ++i) {
     models_.push_back(
-        CHECK_NOTNULL(
-            tflite::FlatBufferModel::BuildFromFile(
-                model_path_segments[i].c_str())));
+        ModelRegistry::GetInstance().Get(model_path_segments[i]));
+    CHECK(models_[i]) << "Can't load " << model_path_segments[i];
     segment_interpreters_[i] = InitializeInterpreter(models_[i].get(),
                                                      tpu_contexts_[i].get(),
                                                      &error_reporter_);
   }
 
-  Initialize(model_path_segments[0], label_path, detection_object);
+  // The first segment is warmed up below with the others, on the
+  // interpreter the pipeline runs.
+  Initialize(model_path_segments[0], label_path, detection_object, false);
+  // Each segment warms up on its own TPU, all at the same time.
+  std::vector<std::thread> warm_ups;
+  for (size_t i = 0; i < num_tpus_; ++i) {
+    warm_ups.emplace_back([this, i, &model_path_segments] {
+      WarmUp(*segment_interpreters_[i], model_path_segments[i],
+             *tpu_contexts_[i]);
+    });
+  }
+  for (auto &warm_up : warm_ups) {
+    warm_up.join();
+  }
+  SetupOutputDecoding(*segment_interpreters_.back(),
+                      model_path_segments.back(),
+                      absl::StrCat(model_path_base, "_anchors.csv"));
   running_ = true;
 }
 
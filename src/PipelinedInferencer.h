@@ -23,13 +23,20 @@
 #ifndef PIPELINEDINFERENCER_H_
 #define PIPELINEDINFERENCER_H_
 
+#include <array>
+
 #include "coral/pipeline/pipelined_model_runner.h"
 
 #include "DetectionInferencer.h"
 #include "InferencerBase.h"
+#include "Metrics.h"
+#include "Tracer.h"
 
 namespace szd {
 
+// Runs the segments of a model on TPUs of their own with the coral
+// pipeline runner. Its invokes don't go through TpuScheduler, the TPUs must
+// not be shared with other inferencers.
 class PipelinedInferencer : public DetectionInferencer {
  public:
   PipelinedInferencer() = delete;
@@ -41,13 +48,12 @@ class PipelinedInferencer : public DetectionInferencer {
 
   void InterpretFrame(const uint8_t *pixels, size_t pixel_length, size_t width,
                       size_t height, size_t stride,
-                      std::shared_ptr<void> &return_data) override;
+                      InferenceResult &result) override;
   InferencerType GetInferencerType() override {
     return kPipelined;
   }
-  void InitializePipelineRunner(
-      coral::Allocator *allocator,
-      std::function<void(const std::string)> output_cb) override;
+  void SetupMetrics(const std::string &labels) override;
+  void InitializePipelineRunner(coral::Allocator *allocator) override;
 
   PipelinedInferencer(const std::string &model_path_base,
                       const std::string &label_path,
@@ -65,13 +71,22 @@ class PipelinedInferencer : public DetectionInferencer {
   }
 
   std::unique_ptr<coral::PipelinedModelRunner> runner_;
-  std::vector<std::unique_ptr<tflite::FlatBufferModel>> models_;
+  std::vector<std::shared_ptr<tflite::FlatBufferModel>> models_;
   std::vector<std::unique_ptr<tflite::Interpreter>> segment_interpreters_;
   std::vector<DetectionResult> results_;
   absl::Mutex mutex_;
   absl::CondVar cond_;
   int frames_in_tpu_queue = 0;
-  std::function<void(const std::string)> output_cb_;
+  // Trace context and push time of the frames in the runner, oldest at
+  // pending_head_. There are never more than kMaxQueueSize of them.
+  struct PendingFrame {
+    TraceContext context;
+    uint64_t push_ns;
+  };
+  std::array<PendingFrame, kMaxQueueSize> pending_frames_;
+  size_t pending_head_ = 0;
+  Gauge *in_flight_ = nullptr;
+  Histogram *latency_ = nullptr;
   std::thread consumer_thread_;
   bool running_ = false;
 };
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * RateController.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "absl/strings/str_cat.h"
+
+#include "RateController.h"
+
+namespace szd {
+
+static uint64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void RateController::ReportQos() {
+  qos_messages_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool RateController::OnFrame() {
+  const auto now_ns = NowNs();
+  if (!period_start_ns_) {
+    period_start_ns_ = now_ns;
+    Update(now_ns);
+  } else if (now_ns - period_start_ns_ >= kPeriodNs) {
+    Update(now_ns);
+  }
+  arrivals_++;
+  return frame_index_++ % skip_factor_.load(std::memory_order_relaxed) == 0;
+}
+
+void RateController::Update(uint64_t now_ns) {
+  const double seconds = (now_ns - period_start_ns_) * 1e-9;
+  const uint64_t inferences = latency_metric_->GetCount();
+  const uint64_t latency_ns = latency_metric_->GetSumNs();
+  const uint64_t dropped = dropped_metric_->Get();
+  const uint64_t tpu_busy_ns = tpu_busy_metric_ ? tpu_busy_metric_->Get() : 0;
+  const uint64_t qos = qos_messages_.load(std::memory_order_relaxed);
+
+  // A stream that just started or was hidden for a while has nothing to go
+  // on.
+  if (arrivals_ > 0 && now_ns - period_start_ns_ < 2 * kPeriodNs) {
+    const double arrival_fps = arrivals_ / seconds;
+    const double inferred_fps = (inferences - inferences_) / seconds;
+    double target = target_fps_.load(std::memory_order_relaxed);
+    if (target <= 0) {
+      target = arrival_fps;
+    }
+    if (qos != qos_) {
+      target = std::min(target, inferred_fps) * 0.75;
+      lowered_qos_->Increment();
+    } else if (dropped != dropped_) {
+      target = std::min(target, inferred_fps) * 0.75;
+      lowered_dropped_->Increment();
+    } else if ((tpu_busy_ns - tpu_busy_ns_) * 1e-9 / seconds
+        > kMaxTpuUtilization) {
+      target = std::min(target, inferred_fps) * 0.75;
+      lowered_tpu_->Increment();
+    } else {
+      target += std::max(1.0, 0.1 * target);
+    }
+    if (inferences > inferences_) {
+      // Frames are inferred one at a time, faster than the latency allows
+      // only fills the queue.
+      const double latency_fps = 1e9 * (inferences - inferences_)
+          / (latency_ns - latency_ns_);
+      target = std::min(target, kHeadroom * latency_fps);
+    }
+    target = std::max(kMinFps, std::min(target, arrival_fps));
+    target_fps_.store(target, std::memory_order_relaxed);
+    skip_factor_.store(std::max(1, static_cast<int>(std::lround(
+                           arrival_fps / target))),
+                       std::memory_order_relaxed);
+  }
+
+  period_start_ns_ = now_ns;
+  arrivals_ = 0;
+  inferences_ = inferences;
+  latency_ns_ = latency_ns;
+  dropped_ = dropped;
+  tpu_busy_ns_ = tpu_busy_ns;
+  qos_ = qos;
+}
+
+RateController::RateController(const std::string &labels,
+                               const Histogram *latency,
+                               const Counter *dropped,
+                               const Counter *tpu_busy_ns)
+    :
+    latency_metric_(latency),
+    dropped_metric_(dropped),
+    tpu_busy_metric_(tpu_busy_ns) {
+  auto &registry = MetricsRegistry::GetInstance();
+  registry.AddCallbackGauge("inference_target_fps",
+                            "Inference rate the rate controller aims for.",
+                            labels, [this] {
+                              return target_fps_.load(
+                                  std::memory_order_relaxed);
+                            });
+  registry.AddCallbackGauge("inference_skip_factor",
+                            "One in this many frames is inferred.", labels,
+                            [this] {
+                              return skip_factor_.load(
+                                  std::memory_order_relaxed);
+                            });
+  const std::string help =
+      "Times the rate controller lowered the target rate, by reason.";
+  lowered_qos_ = registry.GetCounter("inference_rate_lowered_total", help,
+                                     absl::StrCat(labels, ",reason=\"qos\""));
+  lowered_dropped_ = registry.GetCounter(
+      "inference_rate_lowered_total", help,
+      absl::StrCat(labels, ",reason=\"dropped\""));
+  lowered_tpu_ = registry.GetCounter("inference_rate_lowered_total", help,
+                                     absl::StrCat(labels, ",reason=\"tpu\""));
+}
+
+RateController::~RateController() {
+}
+
+} /* namespace szd */
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * RateController.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_RATECONTROLLER_H_
+#define SRC_RATECONTROLLER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "Metrics.h"
+
+namespace szd {
+
+// Picks how many of the frames reaching a stream's appsink are inferred.
+//
+// Once every kPeriodNs it looks at the frames that arrived, the inferences
+// made and their latency, the frames the stream dropped, the QoS messages
+// about its frames and the utilization of the stream's TPU. Any sign of
+// overload, the display falling behind first, lowers the target rate
+// multiplicatively, otherwise it is raised additively up to the arrival rate
+// and what the inference latency allows. Only every skip factor-th frame is
+// inferred then, so the dropping happens evenly instead of in the leaky
+// queues.
+class RateController {
+ public:
+  static const uint64_t kPeriodNs = 1000000000;
+  // The rate is never lowered below this.
+  static constexpr double kMinFps = 1.0;
+  // Share of the inference latency limited rate that is aimed for, to leave
+  // room for jitter.
+  static constexpr double kHeadroom = 0.9;
+  // TPU utilization above which the stream backs off.
+  static constexpr double kMaxTpuUtilization = 0.9;
+
+  // latency and dropped are the stream's own metrics, tpu_busy_ns the busy
+  // time of its TPU or nullptr, they must outlive the controller.
+  RateController(const std::string &labels, const Histogram *latency,
+                 const Counter *dropped, const Counter *tpu_busy_ns);
+  RateController() = delete;
+  RateController(const RateController &other) = delete;
+  RateController(RateController &&other) = delete;
+  RateController& operator=(const RateController &other) = delete;
+  RateController& operator=(RateController &&other) = delete;
+  virtual ~RateController();
+
+  // Called from the streaming thread for each frame reaching the appsink,
+  // returns whether to infer it.
+  bool OnFrame();
+  // Called for QoS messages of the elements handling the stream's frames,
+  // from any thread.
+  void ReportQos();
+
+ private:
+  // Reads the inputs since the last period and sets the target.
+  void Update(uint64_t now_ns);
+
+  std::atomic<double> target_fps_ { 0.0 };
+  std::atomic<int> skip_factor_ { 1 };
+  uint64_t period_start_ns_ = 0;
+  uint64_t frame_index_ = 0;
+  uint64_t arrivals_ = 0;
+  uint64_t inferences_ = 0;
+  uint64_t latency_ns_ = 0;
+  uint64_t dropped_ = 0;
+  uint64_t tpu_busy_ns_ = 0;
+  uint64_t qos_ = 0;
+  const Histogram *latency_metric_;
+  const Counter *dropped_metric_;
+  const Counter *tpu_busy_metric_;
+  Counter *lowered_qos_ = nullptr;
+  Counter *lowered_dropped_ = nullptr;
+  Counter *lowered_tpu_ = nullptr;
+  std::atomic<uint64_t> qos_messages_ { 0 };
+};
+
+} /* namespace szd */
+
+#endif /* SRC_RATECONTROLLER_H_ */
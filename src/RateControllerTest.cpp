@@ -0,0 +1,119 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * RateControllerTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "Metrics.h"
+#include "MockDeviceProvider.h"
+#include "RateController.h"
+
+namespace szd {
+
+// The value of the metric with labels in the rendered text, -1 if missing.
+static double GetValue(const std::string &text, const std::string &name,
+                       const std::string &labels) {
+  const auto line = name + "{" + labels + "} ";
+  const auto found = text.find(line);
+  if (found == std::string::npos) {
+    return -1;
+  }
+  return std::stod(text.substr(found + line.size()));
+}
+
+// A stream inferring on a mock TPU with its own metrics and controller.
+struct Stream {
+  explicit Stream(const std::string &name)
+      :
+      labels("stream=\"" + name + "\"") {
+    auto &registry = MetricsRegistry::GetInstance();
+    latency = registry.GetLatencyHistogram("test_rate_latency_seconds",
+                                           "Latency.", labels);
+    dropped = registry.GetCounter("test_rate_dropped_total", "Dropped.",
+                                  labels);
+    controller = std::make_unique<RateController>(labels, latency, dropped,
+                                                  nullptr);
+  }
+
+  Counter* LoweredForQos() {
+    return MetricsRegistry::GetInstance().GetCounter(
+        "inference_rate_lowered_total",
+        "Times the rate controller lowered the target rate, by reason.",
+        labels + ",reason=\"qos\"");
+  }
+
+  std::string labels;
+  Histogram *latency;
+  Counter *dropped;
+  std::unique_ptr<RateController> controller;
+};
+
+// Frames arrive at 50 fps on two streams for a little over two periods,
+// the inferred ones take 2 ms on a mock TPU. Only the first stream gets a
+// QoS message, in its second period.
+TEST(RateControllerTest, QosLowersOnlyTheStreamItIsAbout) {
+  MockTpuConfig config;
+  config.num_devices = 1;
+  config.invoke_us = 2000;
+  config.jitter_us = 0;
+  MockEdgeTpu device( { edgetpu::DeviceType::kApexPci, "/dev/mock_rate_0" },
+                     config, 0);
+  int model;
+  Stream late("late"), smooth("smooth");
+
+  const auto start = std::chrono::steady_clock::now();
+  auto next_frame = start;
+  bool reported = false;
+  while (next_frame - start < std::chrono::milliseconds(2200)) {
+    std::this_thread::sleep_until(next_frame);
+    next_frame += std::chrono::milliseconds(20);
+    if (!reported && next_frame - start > std::chrono::milliseconds(1500)) {
+      late.controller->ReportQos();
+      reported = true;
+    }
+    for (auto *stream : { &late, &smooth }) {
+      if (stream->controller->OnFrame()) {
+        const auto invoke_start = std::chrono::steady_clock::now();
+        device.Invoke(&model);
+        stream->latency->ObserveNs(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - invoke_start).count());
+      }
+    }
+  }
+
+  EXPECT_EQ(late.LoweredForQos()->Get(), 1u);
+  EXPECT_EQ(smooth.LoweredForQos()->Get(), 0u);
+  const auto text = MetricsRegistry::GetInstance().Render();
+  const double late_fps = GetValue(text, "inference_target_fps", late.labels);
+  const double smooth_fps = GetValue(text, "inference_target_fps",
+                                     smooth.labels);
+  printf("Target rates: %.1f fps after a QoS message, %.1f fps without\n",
+         late_fps, smooth_fps);
+  EXPECT_LT(late_fps, smooth_fps);
+}
+
+} /* namespace szd */
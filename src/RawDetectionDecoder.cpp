@@ -0,0 +1,259 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * RawDetectionDecoder.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "glog/logging.h"
+
+#include "RawDetectionDecoder.h"
+
+namespace szd {
+
+template<typename T>
+static void Gather(const T *values, size_t stride, size_t offset,
+                   const uint32_t *indices, size_t n, float scale,
+                   int zero_point, float *out) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = (static_cast<float>(values[indices[i] * stride + offset])
+        - zero_point) * scale;
+  }
+}
+
+// Float outputs aren't quantized.
+static void Gather(const float *values, size_t stride, size_t offset,
+                   const uint32_t *indices, size_t n, float scale,
+                   int zero_point, float *out) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = values[indices[i] * stride + offset];
+  }
+}
+
+template<typename T>
+void RawDetectionDecoder::FindCandidates(const T *scores, int id) {
+  // The raw scores are compared as floats, which is exact for the 8 bit
+  // types and lets the class loop below compile to vector max instructions.
+  const float threshold = raw_threshold_;
+  const size_t stride = num_classes_;
+  num_candidates_ = 0;
+  if (id >= 0 && static_cast<size_t>(id) + 1 >= stride) {
+    return;
+  }
+  for (size_t anchor = 0; anchor < num_anchors_; ++anchor) {
+    const T *row = scores + anchor * stride;
+    int best_id = id + 1;
+    if (id < 0) {
+      T best = row[1];
+      for (size_t c = 2; c < stride; ++c) {
+        best = std::max(best, row[c]);
+      }
+      if (!(best > threshold)) {
+        continue;
+      }
+      best_id = std::max_element(row + 1, row + stride) - row;
+    } else if (!(row[best_id] > threshold)) {
+      continue;
+    }
+    candidate_anchor_[num_candidates_] = anchor;
+    // Without the background class, as the postprocess op reports ids.
+    candidate_id_[num_candidates_] = best_id - 1;
+    candidate_score_[num_candidates_] = (static_cast<float>(row[best_id])
+        - scores_format_.zero_point) * scores_format_.scale;
+    num_candidates_++;
+  }
+}
+
+template<typename T>
+void RawDetectionDecoder::DecodeCandidates(const T *boxes) {
+  const size_t n = num_candidates_;
+  const auto *indices = candidate_anchor_.data();
+  const auto &format = boxes_format_;
+  for (size_t k = 0; k < 4; ++k) {
+    Gather(boxes, 4, k, indices, n, format.scale, format.zero_point,
+           encoding_[k].data());
+  }
+
+  // Straight line arithmetic over contiguous arrays, vectorized by the
+  // compiler.
+  const float *ty = encoding_[0].data();
+  const float *tx = encoding_[1].data();
+  const float *th = encoding_[2].data();
+  const float *tw = encoding_[3].data();
+  for (size_t i = 0; i < n; ++i) {
+    const uint32_t anchor = indices[i];
+    const float y = ty[i] / kYScale * anchor_h_[anchor] + anchor_y_[anchor];
+    const float x = tx[i] / kXScale * anchor_w_[anchor] + anchor_x_[anchor];
+    const float half_h = 0.5f * std::exp(th[i] / kHScale) * anchor_h_[anchor];
+    const float half_w = 0.5f * std::exp(tw[i] / kWScale) * anchor_w_[anchor];
+    y1_[i] = y - half_h;
+    x1_[i] = x - half_w;
+    y2_[i] = y + half_h;
+    x2_[i] = x + half_w;
+    area_[i] = 4.0f * half_h * half_w;
+  }
+}
+
+void RawDetectionDecoder::SuppressCandidates() {
+  const size_t n = num_candidates_ < kMaxCandidates ? num_candidates_ :
+      kMaxCandidates;
+  std::iota(order_.begin(), order_.begin() + num_candidates_, 0);
+  std::partial_sort(order_.begin(), order_.begin() + n,
+                    order_.begin() + num_candidates_,
+                    [this](uint32_t a, uint32_t b) {
+                      return candidate_score_[a] > candidate_score_[b];
+                    });
+  std::fill(keep_.begin(), keep_.begin() + n, 1);
+
+  detections_.clear();
+  for (size_t i = 0; i < n && detections_.size() < kMaxDetections; ++i) {
+    if (!keep_[i]) {
+      continue;
+    }
+    const uint32_t a = order_[i];
+    float score = candidate_score_[a];
+    if (score_type_ == kLogits) {
+      score = 1.0f / (1.0f + std::exp(-score));
+    }
+    detections_.push_back( { candidate_id_[a], score, x1_[a], y1_[a], x2_[a],
+        y2_[a] });
+    for (size_t j = i + 1; j < n; ++j) {
+      const uint32_t b = order_[j];
+      const float width = std::max(
+          0.0f, std::min(x2_[a], x2_[b]) - std::max(x1_[a], x1_[b]));
+      const float height = std::max(
+          0.0f, std::min(y2_[a], y2_[b]) - std::max(y1_[a], y1_[b]));
+      const float intersection = width * height;
+      const bool overlaps = intersection
+          > kIouThreshold * (area_[a] + area_[b] - intersection);
+      keep_[j] &= !(overlaps && candidate_id_[a] == candidate_id_[b]);
+    }
+  }
+}
+
+template<typename TBoxes, typename TScores>
+void RawDetectionDecoder::DecodeAs(const void *boxes, const void *scores,
+                                   int id) {
+  FindCandidates(static_cast<const TScores*>(scores), id);
+  DecodeCandidates(static_cast<const TBoxes*>(boxes));
+  SuppressCandidates();
+}
+
+template<typename TBoxes>
+RawDetectionDecoder::DecodeFunction RawDetectionDecoder::SelectDecode(
+    TensorFormat::Type scores_type) {
+  switch (scores_type) {
+    case TensorFormat::kFloat32:
+      return &RawDetectionDecoder::DecodeAs<TBoxes, float>;
+    case TensorFormat::kUInt8:
+      return &RawDetectionDecoder::DecodeAs<TBoxes, uint8_t>;
+    case TensorFormat::kInt8:
+      return &RawDetectionDecoder::DecodeAs<TBoxes, int8_t>;
+  }
+  return nullptr;
+}
+
+const std::vector<RawDetectionDecoder::Detection>& RawDetectionDecoder::Decode(
+    const void *boxes, const void *scores, int id) {
+  (this->*decode_)(boxes, scores, id);
+  return detections_;
+}
+
+void RawDetectionDecoder::SetThreshold(float threshold) {
+  // The threshold is a probability, logits are compared to its logit.
+  if (score_type_ == kLogits) {
+    threshold = std::min(std::max(threshold, 1e-6f), 1.0f - 1e-6f);
+    threshold = std::log(threshold / (1.0f - threshold));
+  }
+  raw_threshold_ = threshold / scores_format_.scale + scores_format_.zero_point;
+}
+
+RawDetectionDecoder::RawDetectionDecoder(const std::string &anchors_path,
+                                         size_t num_classes,
+                                         const TensorFormat &boxes_format,
+                                         const TensorFormat &scores_format,
+                                         ScoreType score_type,
+                                         float threshold)
+    :
+    num_classes_(num_classes),
+    boxes_format_(boxes_format),
+    scores_format_(scores_format),
+    score_type_(score_type) {
+  CHECK_GE(num_classes_, 2) << "Scores need a background and a class";
+  std::ifstream f { anchors_path };
+  CHECK(f.is_open()) << "Can't read anchors from " << anchors_path;
+  for (std::string line; std::getline(f, line);) {
+    std::vector<std::string> p = absl::StrSplit(line, ',');
+    if (p.size() < 4) {
+      continue;
+    }
+    float y, x, h, w;
+    CHECK(absl::SimpleAtof(p[0], &y));
+    CHECK(absl::SimpleAtof(p[1], &x));
+    CHECK(absl::SimpleAtof(p[2], &h));
+    CHECK(absl::SimpleAtof(p[3], &w));
+    anchor_y_.push_back(y);
+    anchor_x_.push_back(x);
+    anchor_h_.push_back(h);
+    anchor_w_.push_back(w);
+  }
+  num_anchors_ = anchor_y_.size();
+
+  SetThreshold(threshold);
+
+  candidate_anchor_.resize(num_anchors_);
+  candidate_id_.resize(num_anchors_);
+  candidate_score_.resize(num_anchors_);
+  for (auto &encoding : encoding_) {
+    encoding.resize(num_anchors_);
+  }
+  x1_.resize(num_anchors_);
+  y1_.resize(num_anchors_);
+  x2_.resize(num_anchors_);
+  y2_.resize(num_anchors_);
+  area_.resize(num_anchors_);
+  order_.resize(num_anchors_);
+  keep_.resize(kMaxCandidates);
+  detections_.reserve(kMaxDetections);
+
+  switch (boxes_format_.type) {
+    case TensorFormat::kFloat32:
+      decode_ = SelectDecode<float>(scores_format_.type);
+      break;
+    case TensorFormat::kUInt8:
+      decode_ = SelectDecode<uint8_t>(scores_format_.type);
+      break;
+    case TensorFormat::kInt8:
+      decode_ = SelectDecode<int8_t>(scores_format_.type);
+      break;
+  }
+  CHECK(decode_) << "Unsupported output formats";
+}
+
+RawDetectionDecoder::~RawDetectionDecoder() {
+}
+
+} /* namespace szd */
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * RawDetectionDecoder.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_RAWDETECTIONDECODER_H_
+#define SRC_RAWDETECTIONDECODER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace szd {
+
+// Element type and quantization of a model output.
+struct TensorFormat {
+  enum Type {
+    kFloat32,
+    kUInt8,
+    kInt8,
+  };
+  Type type = kFloat32;
+  float scale = 1.0f;
+  int zero_point = 0;
+};
+
+// Does on the CPU what the TFLite_Detection_PostProcess op does on models
+// exported without it: decodes the SSD box encodings [anchors, 4] against
+// the anchors and keeps the best of each class in the scores
+// [anchors, classes], class 0 being the background. Scores are compared
+// still quantized, so only the few anchors above the threshold are
+// dequantized and decoded. All buffers are allocated up front, decoding a
+// frame doesn't allocate, and the decoding is compiled for the element types
+// of the outputs.
+class RawDetectionDecoder {
+ public:
+  // One result, relative to the model input.
+  struct Detection {
+    int id;
+    float score, x1, y1, x2, y2;
+  };
+  // What the scores output of the model holds.
+  enum ScoreType {
+    // Logits, as the object detection API exports the scores before the
+    // postprocess op. The sigmoid is applied to the detections found.
+    kLogits,
+    // Probabilities, for models ending with the sigmoid.
+    kProbabilities,
+  };
+
+  // anchors_path is a csv file with a y_center,x_center,height,width line
+  // per anchor, in the order of the box encodings.
+  RawDetectionDecoder(const std::string &anchors_path, size_t num_classes,
+                      const TensorFormat &boxes_format,
+                      const TensorFormat &scores_format, ScoreType score_type,
+                      float threshold);
+  RawDetectionDecoder() = delete;
+  RawDetectionDecoder(const RawDetectionDecoder &other) = delete;
+  RawDetectionDecoder(RawDetectionDecoder &&other) = delete;
+  RawDetectionDecoder& operator=(const RawDetectionDecoder &other) = delete;
+  RawDetectionDecoder& operator=(RawDetectionDecoder &&other) = delete;
+  virtual ~RawDetectionDecoder();
+
+  // Returns the detections of class id, or of all classes when id < 0,
+  // highest score first. Valid until the next call.
+  const std::vector<Detection>& Decode(const void *boxes, const void *scores,
+                                       int id);
+  // Lowest probability a detection may have.
+  void SetThreshold(float threshold);
+  size_t GetNumAnchors() const {
+    return num_anchors_;
+  }
+
+ private:
+  // Same defaults as the postprocess op of the object detection API.
+  static constexpr float kYScale = 10.0f;
+  static constexpr float kXScale = 10.0f;
+  static constexpr float kHScale = 5.0f;
+  static constexpr float kWScale = 5.0f;
+  static constexpr float kIouThreshold = 0.6f;
+  static const size_t kMaxCandidates = 100;
+  static const size_t kMaxDetections = 25;
+
+  // Collects the anchors whose score of id, or best score, is above the
+  // threshold into the candidate buffers.
+  template<typename T>
+  void FindCandidates(const T *scores, int id);
+  template<typename T>
+  void DecodeCandidates(const T *boxes);
+  void SuppressCandidates();
+
+  // Decoding compiled for the element types of the outputs, the one for the
+  // model is chosen when the decoder is created.
+  typedef void (RawDetectionDecoder::*DecodeFunction)(const void *boxes,
+                                                      const void *scores,
+                                                      int id);
+  template<typename TBoxes, typename TScores>
+  void DecodeAs(const void *boxes, const void *scores, int id);
+  template<typename TBoxes>
+  static DecodeFunction SelectDecode(TensorFormat::Type scores_type);
+
+  const size_t num_classes_;
+  const TensorFormat boxes_format_;
+  const TensorFormat scores_format_;
+  const ScoreType score_type_;
+  DecodeFunction decode_ = nullptr;
+  // The threshold in the domain of the raw scores.
+  float raw_threshold_;
+  size_t num_anchors_ = 0;
+  std::vector<float> anchor_y_, anchor_x_, anchor_h_, anchor_w_;
+
+  size_t num_candidates_ = 0;
+  std::vector<uint32_t> candidate_anchor_;
+  std::vector<int> candidate_id_;
+  std::vector<float> candidate_score_;
+  std::vector<float> encoding_[4];
+  std::vector<float> x1_, y1_, x2_, y2_, area_;
+  std::vector<uint32_t> order_;
+  std::vector<uint8_t> keep_;
+  std::vector<Detection> detections_;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_RAWDETECTIONDECODER_H_ */
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * RawDetectionDecoderTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "RawDetectionDecoder.h"
+
+namespace szd {
+
+static float Sigmoid(float logit) {
+  return 1.0f / (1.0f + std::exp(-logit));
+}
+
+// Four anchors, the first two overlapping, and the background plus two
+// classes.
+class RawDetectionDecoderTest : public ::testing::Test {
+ protected:
+  static const size_t kNumAnchors = 4;
+  static const size_t kNumClasses = 3;
+
+  void SetUp() override {
+    anchors_path_ = ::testing::TempDir() + "raw_detection_anchors.csv";
+    std::ofstream anchors(anchors_path_);
+    anchors << "0.25,0.25,0.2,0.2\n"
+            "0.26,0.25,0.2,0.2\n"
+            "0.75,0.75,0.2,0.2\n"
+            "0.5,0.5,0.4,0.4\n";
+  }
+
+  // Scores of all classes of an anchor, background first.
+  void SetScores(size_t anchor, float background, float a, float b) {
+    scores_[anchor * kNumClasses] = background;
+    scores_[anchor * kNumClasses + 1] = a;
+    scores_[anchor * kNumClasses + 2] = b;
+  }
+
+  std::string anchors_path_;
+  // Box encodings that decode to the anchors themselves.
+  std::vector<float> boxes_ = std::vector<float>(kNumAnchors * 4, 0.0f);
+  // All anchors well below any threshold.
+  std::vector<float> scores_ = std::vector<float>(kNumAnchors * kNumClasses,
+                                                  -10.0f);
+};
+
+TEST_F(RawDetectionDecoderTest, ReadsAnchors) {
+  RawDetectionDecoder decoder(anchors_path_, kNumClasses, TensorFormat(),
+                              TensorFormat(), RawDetectionDecoder::kLogits,
+                              0.5f);
+  EXPECT_EQ(decoder.GetNumAnchors(), 4u);
+}
+
+TEST_F(RawDetectionDecoderTest, DecodesBoxesAgainstAnchors) {
+  RawDetectionDecoder decoder(anchors_path_, kNumClasses, TensorFormat(),
+                              TensorFormat(), RawDetectionDecoder::kLogits,
+                              0.5f);
+  SetScores(2, 0.0f, 0.0f, 2.0f);
+  // Moved down by a tenth of the anchor height, twice as high.
+  boxes_[2 * 4] = 1.0f;
+  boxes_[2 * 4 + 2] = 5.0f * std::log(2.0f);
+  const auto &detections = decoder.Decode(boxes_.data(), scores_.data(), -1);
+  ASSERT_EQ(detections.size(), 1u);
+  const auto &detection = detections[0];
+  EXPECT_EQ(detection.id, 1);
+  EXPECT_NEAR(detection.score, Sigmoid(2.0f), 1e-5);
+  EXPECT_NEAR(detection.y1, 0.77f - 0.2f, 1e-5);
+  EXPECT_NEAR(detection.y2, 0.77f + 0.2f, 1e-5);
+  EXPECT_NEAR(detection.x1, 0.65f, 1e-5);
+  EXPECT_NEAR(detection.x2, 0.85f, 1e-5);
+}
+
+TEST_F(RawDetectionDecoderTest, SuppressesOverlapsOfTheSameClass) {
+  RawDetectionDecoder decoder(anchors_path_, kNumClasses, TensorFormat(),
+                              TensorFormat(), RawDetectionDecoder::kLogits,
+                              0.5f);
+  SetScores(0, 0.0f, 1.0f, -10.0f);
+  SetScores(1, 0.0f, 2.0f, -10.0f);
+  SetScores(2, 0.0f, -10.0f, 3.0f);
+  const auto &detections = decoder.Decode(boxes_.data(), scores_.data(), -1);
+  ASSERT_EQ(detections.size(), 2u);
+  EXPECT_EQ(detections[0].id, 1);
+  EXPECT_NEAR(detections[0].score, Sigmoid(3.0f), 1e-5);
+  // The better of the two overlapping anchors.
+  EXPECT_EQ(detections[1].id, 0);
+  EXPECT_NEAR(detections[1].score, Sigmoid(2.0f), 1e-5);
+  EXPECT_NEAR(detections[1].y1, 0.16f, 1e-5);
+}
+
+TEST_F(RawDetectionDecoderTest, KeepsOverlapsOfOtherClasses) {
+  RawDetectionDecoder decoder(anchors_path_, kNumClasses, TensorFormat(),
+                              TensorFormat(), RawDetectionDecoder::kLogits,
+                              0.5f);
+  SetScores(0, 0.0f, 1.0f, -10.0f);
+  SetScores(1, 0.0f, -10.0f, 2.0f);
+  EXPECT_EQ(decoder.Decode(boxes_.data(), scores_.data(), -1).size(), 2u);
+}
+
+TEST_F(RawDetectionDecoderTest, DecodesOneClass) {
+  RawDetectionDecoder decoder(anchors_path_, kNumClasses, TensorFormat(),
+                              TensorFormat(), RawDetectionDecoder::kLogits,
+                              0.5f);
+  SetScores(0, 0.0f, 1.0f, -10.0f);
+  SetScores(2, 0.0f, 0.5f, 3.0f);
+  const auto &detections = decoder.Decode(boxes_.data(), scores_.data(), 0);
+  ASSERT_EQ(detections.size(), 2u);
+  EXPECT_EQ(detections[0].id, 0);
+  EXPECT_NEAR(detections[0].score, Sigmoid(1.0f), 1e-5);
+  EXPECT_NEAR(detections[1].score, Sigmoid(0.5f), 1e-5);
+  EXPECT_TRUE(decoder.Decode(boxes_.data(), scores_.data(), 2).empty());
+}
+
+TEST_F(RawDetectionDecoderTest, AppliesThresholdToProbabilities) {
+  RawDetectionDecoder decoder(anchors_path_, kNumClasses, TensorFormat(),
+                              TensorFormat(), RawDetectionDecoder::kLogits,
+                              0.5f);
+  SetScores(0, 0.0f, 1.0f, -10.0f);
+  SetScores(2, 0.0f, -10.0f, 3.0f);
+  EXPECT_EQ(decoder.Decode(boxes_.data(), scores_.data(), -1).size(), 2u);
+  decoder.SetThreshold(0.9f);
+  EXPECT_EQ(decoder.Decode(boxes_.data(), scores_.data(), -1).size(), 1u);
+}
+
+TEST_F(RawDetectionDecoderTest, DecodesQuantizedProbabilities) {
+  TensorFormat boxes_format;
+  boxes_format.type = TensorFormat::kInt8;
+  boxes_format.scale = 0.1f;
+  boxes_format.zero_point = 0;
+  // The quantization of the output of a sigmoid.
+  TensorFormat scores_format;
+  scores_format.type = TensorFormat::kUInt8;
+  scores_format.scale = 1.0f / 256;
+  scores_format.zero_point = 0;
+  RawDetectionDecoder decoder(anchors_path_, kNumClasses, boxes_format,
+                              scores_format,
+                              RawDetectionDecoder::kProbabilities, 0.5f);
+  std::vector<int8_t> boxes(kNumAnchors * 4, 0);
+  boxes[3 * 4 + 1] = 10;
+  std::vector<uint8_t> scores(kNumAnchors * kNumClasses, 0);
+  scores[3 * kNumClasses + 1] = 192;
+  scores[2 * kNumClasses + 2] = 127;
+  const auto &detections = decoder.Decode(boxes.data(), scores.data(), -1);
+  ASSERT_EQ(detections.size(), 1u);
+  EXPECT_EQ(detections[0].id, 0);
+  EXPECT_NEAR(detections[0].score, 0.75f, 1e-5);
+  // Moved right by a tenth of the anchor width.
+  EXPECT_NEAR(detections[0].x1, 0.34f, 1e-5);
+  EXPECT_NEAR(detections[0].x2, 0.74f, 1e-5);
+}
+
+} /* namespace szd */
@@ -20,7 +20,7 @@
  *      Author: pnordstrom
  */
 
-#include "coral/tflite_utils.h"
+#include <cstring>
 
 #include "SegmentationInferencer.h"
 
@@ -28,39 +28,34 @@ namespace szd {
 
 void SegmentationInferencer::InterpretFrame(
     const uint8_t *pixels, size_t pixel_length, size_t width, size_t height,
-    size_t stride, std::shared_ptr<void> &return_data) {
-  std::string boxlist;
-  std::string labellist;
-  std::string svg;
-
-  auto segmask = std::make_shared<std::vector<uint8_t>>();
-
-  GetDetectionResults(pixels, pixel_length, width, height, stride, segmask);
-  return_data = segmask;
+    size_t stride, InferenceResult &result) {
+  result.Clear();
+  result.dropped = !GetDetectionResults(pixels, pixel_length, width, height,
+                                        stride, &result.segmentation_mask);
 }
 
-void SegmentationInferencer::GetDetectionResults(
+bool SegmentationInferencer::GetDetectionResults(
     const uint8_t *input_data, const size_t input_size, const size_t width,
     const size_t height, const size_t stride,
-    std::shared_ptr<std::vector<uint8_t>> output_mask) {
+    std::vector<uint8_t> *output_mask) {
 
   uint8_t *in_tensor = interpreter_->typed_input_tensor<uint8_t>(0);
-  for (size_t i = 0; i < height; ++i) {
-    std::memcpy(&in_tensor[i * width * 3], &input_data[i * stride], width * 3);
+  if (in_tensor != input_data) {
+    for (size_t i = 0; i < height; ++i) {
+      std::memcpy(&in_tensor[i * width * 3], &input_data[i * stride],
+                  width * 3);
+    }
   }
 
-  CHECK_EQ(interpreter_->Invoke(), kTfLiteOk) << error_reporter_.message();
-
-  const TfLiteTensor &out_tensor = *interpreter_->output_tensor(0);
-
-  if (out_tensor.type == kTfLiteInt64) {  // detection model out is Int64
-    auto output = coral::TensorData<int64_t>(out_tensor);
-    output_mask->resize(height * width);
-
-    for (size_t i = 0; i < height * width; ++i) {
-      (*output_mask)[i] = (uint8_t) output[i];
-    }
+  if (!Invoke()) {
+    return false;
   }
+
+  auto start_ns = Tracer::Now();
+  output_mask->resize(mask_size_);
+  mask_decoder_(*interpreter_->output_tensor(0), output_mask->data());
+  decode_latency_->ObserveNs(Tracer::Now() - start_ns);
+  return true;
 }
 
 SegmentationInferencer::SegmentationInferencer(
@@ -70,6 +65,11 @@ SegmentationInferencer::SegmentationInferencer(
     InferencerBase(1),
     threshold_(threshold) {
   Initialize(model_path, label_path, detection_object);
+  const auto &output = *interpreter_->output_tensor(0);
+  std::string decoder;
+  mask_decoder_ = SelectMaskDecoder(output, &decoder);
+  mask_size_ = GetMaskSize(output);
+  SetOutputDecoder(model_path, decoder);
 }
 
 SegmentationInferencer::~SegmentationInferencer() {
@@ -24,6 +24,7 @@
 #define SEGMENTATIONINFERENCER_H_
 
 #include "InferencerBase.h"
+#include "OutputDecoders.h"
 
 namespace szd {
 
@@ -42,18 +43,23 @@ class SegmentationInferencer : public InferencerBase {
 
   void InterpretFrame(const uint8_t *pixels, size_t pixel_length, size_t width,
                       size_t height, size_t stride,
-                      std::shared_ptr<void> &return_data) override;
+                      InferenceResult &result) override;
   InferencerType GetInferencerType() override {
     return kSegmentation;
   }
 
  private:
-  void GetDetectionResults(const uint8_t *input_data, const size_t input_size,
+  // Returns false if the TPU scheduler dropped the frame.
+  bool GetDetectionResults(const uint8_t *input_data, const size_t input_size,
                            const size_t width, const size_t height,
                            const size_t stride,
-                           std::shared_ptr<std::vector<uint8_t>> mask_data);
+                           std::vector<uint8_t> *mask_data);
 
   const float threshold_;
+  // Chosen for the output of the model, DeepLab models either output the
+  // class of each pixel or the scores to take the argmax of.
+  MaskDecoder mask_decoder_ = nullptr;
+  size_t mask_size_ = 0;
 };
 
 } /* namespace szd */
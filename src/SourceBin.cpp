@@ -0,0 +1,175 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * SourceBin.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <limits.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "absl/strings/str_cat.h"
+#include "SourceBin.h"
+#include "ThreadPlacement.h"
+
+namespace szd {
+
+bool SourceBin::LinkOutput(InferencerBin &inferencer_bin) {
+  auto tee_src_pad = gst_element_get_request_pad(tee_, "src_%u");
+  auto src_name = absl::StrCat("src_bin_src_", num_outputs_);
+  auto src_pad = gst_ghost_pad_new(src_name.c_str(), tee_src_pad);
+  gst_element_add_pad(bin_, src_pad);
+  gst_object_unref(tee_src_pad);
+
+  if (!gst_element_link_pads(bin_, src_name.c_str(), inferencer_bin.GetBin(),
+                             "inf_bin_sink")) {
+    return false;
+  }
+  num_outputs_++;
+  return true;
+}
+
+void SourceBin::Rewind() {
+  // Cached clips loop by themselves.
+  if (!decoder_) {
+    return;
+  }
+  gst_element_seek(decoder_, 1.0, GST_FORMAT_TIME, GST_SEEK_FLAG_SEGMENT,
+                   GST_SEEK_TYPE_SET, 0, GST_SEEK_TYPE_NONE, 0);
+}
+
+GstPadProbeReturn SourceBin::QueueSinkPadCallback(GstPad *pad,
+                                                  GstPadProbeInfo *info) {
+  auto event = gst_pad_probe_info_get_event(info);
+  if (GST_EVENT_TYPE(event) == GST_EVENT_SEGMENT_DONE) {
+    g_idle_add(reinterpret_cast<GSourceFunc>(+[](SourceBin *self) -> int {
+      self->Rewind();
+      return 0;
+    }),
+               this);
+  }
+  return GST_PAD_PROBE_PASS;
+}
+
+void SourceBin::PushCachedFrame(GstElement *appsrc) {
+  GstFlowReturn ret;
+  auto buffer = frame_cache_->MakeBuffer(next_frame_++);
+  g_signal_emit_by_name(appsrc, "push-buffer", buffer, &ret);
+  gst_buffer_unref(buffer);
+}
+
+SourceBin::SourceBin(const std::string &video_file, bool cache_frames) {
+  if (cache_frames) {
+    frame_cache_ = std::make_shared<FrameCache>(video_file, kMaxCacheBytes);
+    if (!frame_cache_->Load()) {
+      g_printerr("Failed to cache %s, decoding it while playing\n",
+                 video_file.c_str());
+      frame_cache_ = nullptr;
+    }
+  }
+
+  std::string bin_src = frame_cache_ ? kCachedSourceBinSrc : kSourceBinSrc;
+  ParseBin(bin_src);
+  tee_ = gst_bin_get_by_name(GST_BIN(bin_), "t");
+  auto source = gst_bin_get_by_name(GST_BIN(bin_), "source");
+
+  if (frame_cache_) {
+    g_object_set(G_OBJECT(source), "caps", frame_cache_->GetCaps(), NULL);
+    g_signal_connect(
+        source,
+        "need-data",
+        reinterpret_cast<GCallback>(+[](GstElement *appsrc, guint length,
+                                        SourceBin *self) {
+          self->PushCachedFrame(appsrc);
+        }),
+        this);
+    gst_object_unref(source);
+    return;
+  }
+
+  g_object_set(G_OBJECT(source), "location", video_file.c_str(), NULL);
+  gst_object_unref(source);
+
+  decoder_ = gst_bin_get_by_name(GST_BIN(bin_), "decoder");
+
+  // setup pad probe for enabling looping of videos
+  auto q = gst_bin_get_by_name(GST_BIN(bin_), "q");
+  auto sink_pad_queue = gst_element_get_static_pad(q, "sink");
+  gst_pad_add_probe(
+      sink_pad_queue,
+      GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      reinterpret_cast<GstPadProbeCallback>(+[](
+          GstPad *pad, GstPadProbeInfo *info,
+          SourceBin *self) -> GstPadProbeReturn {
+        return self->QueueSinkPadCallback(pad, info);
+      }),
+      this, NULL);
+  gst_object_unref(sink_pad_queue);
+  gst_object_unref(q);
+}
+
+SourceBin::~SourceBin() {
+  if (decoder_) {
+    gst_object_unref(decoder_);
+  }
+  gst_object_unref(tee_);
+}
+
+bool SourceRegistry::Link(InferencerBin &inferencer_bin) {
+  // Key on the canonical path so "videos/a.mp4" and "./videos/a.mp4" share
+  // the same decoder.
+  const auto &video_file = inferencer_bin.GetVideoFile();
+  char resolved[PATH_MAX];
+  std::string key =
+      realpath(video_file.c_str(), resolved) ? resolved : video_file;
+
+  auto it = sources_.find(key);
+  if (it == sources_.end()) {
+    auto source = std::make_shared<SourceBin>(video_file, cache_frames_);
+    if (!gst_bin_add(GST_BIN(pipeline_), source->GetBin())) {
+      return false;
+    }
+    it = sources_.emplace(key, source).first;
+    // Decoding runs at the pace of the first stream showing the video.
+    ThreadPlacement::AddBin(source->GetBin(),
+                            inferencer_bin.GetTraceStream());
+  }
+  return it->second->LinkOutput(inferencer_bin);
+}
+
+void SourceRegistry::Rewind() {
+  for (auto &source : sources_) {
+    source.second->Rewind();
+  }
+}
+
+SourceRegistry::SourceRegistry(GstElement *pipeline, bool cache_frames)
+    :
+    pipeline_(CHECK_NOTNULL(pipeline)),
+    cache_frames_(cache_frames) {
+}
+
+SourceRegistry::~SourceRegistry() {
+}
+
+} /* namespace szd */
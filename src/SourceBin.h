@@ -0,0 +1,104 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * SourceBin.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_SOURCEBIN_H_
+#define SRC_SOURCEBIN_H_
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include <gst/gst.h>
+
+#include "Bin.h"
+#include "FrameCache.h"
+#include "InferencerBin.h"
+
+namespace szd {
+  const std::string kSourceBinSrc =
+      "filesrc name=source ! decodebin name=decoder ! queue name=q ! "
+          "tee name=t allow-not-linked=true";
+  const std::string kCachedSourceBinSrc =
+      "appsrc name=source format=time ! queue name=q ! "
+          "tee name=t allow-not-linked=true";
+
+// Decodes one video file and fans the decoded frames out to every
+// InferencerBin that shows it. Also owns the looping of the video since a
+// seek on the shared decoder affects all consumers. With cache_frames the
+// whole clip is decoded up front into a FrameCache and replayed from memory,
+// which loops without seeking and gives the same frames on every run.
+class SourceBin : public Bin {
+ public:
+  SourceBin(const std::string &video_file, bool cache_frames);
+  SourceBin() = delete;
+  SourceBin(const SourceBin &other) = delete;
+  SourceBin(SourceBin &&other) = delete;
+  SourceBin& operator=(const SourceBin &other) = delete;
+  SourceBin& operator=(SourceBin &&other) = delete;
+  virtual ~SourceBin();
+
+  // Links a new tee branch to the sink pad of the inferencer bin. Both bins
+  // need to be in the same pipeline.
+  bool LinkOutput(InferencerBin &inferencer_bin);
+  void Rewind();
+
+ private:
+  // Clips are truncated to this many bytes of decoded frames.
+  static const size_t kMaxCacheBytes = 1024 * 1024 * 1024;
+
+  GstPadProbeReturn QueueSinkPadCallback(GstPad *pad, GstPadProbeInfo *info);
+  void PushCachedFrame(GstElement *appsrc);
+
+  std::shared_ptr<FrameCache> frame_cache_;
+  uint64_t next_frame_ = 0;
+  GstElement *decoder_ = nullptr;
+  GstElement *tee_;
+  size_t num_outputs_ = 0;
+};
+
+// Keeps one SourceBin per unique video file.
+class SourceRegistry {
+ public:
+  SourceRegistry(GstElement *pipeline, bool cache_frames);
+  SourceRegistry() = delete;
+  SourceRegistry(const SourceRegistry &other) = delete;
+  SourceRegistry(SourceRegistry &&other) = delete;
+  SourceRegistry& operator=(const SourceRegistry &other) = delete;
+  SourceRegistry& operator=(SourceRegistry &&other) = delete;
+  virtual ~SourceRegistry();
+
+  // Connects the inferencer bin to the decoder for its video file, creating
+  // and adding the decoder to the pipeline the first time the file is seen.
+  bool Link(InferencerBin &inferencer_bin);
+  void Rewind();
+  size_t GetNumSources() {
+    return sources_.size();
+  }
+
+ private:
+  GstElement *pipeline_;
+  bool cache_frames_;
+  std::map<std::string, std::shared_ptr<SourceBin>> sources_;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_SOURCEBIN_H_ */
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * StartupTimeline.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <algorithm>
+#include <string>
+
+#include <glib.h>
+
+#include "StartupTimeline.h"
+#include "Tracer.h"
+
+namespace szd {
+
+StartupTimeline::Phase::Phase(StartupTimeline *timeline,
+                              const std::string &name)
+    :
+    timeline_(timeline),
+    name_(name),
+    start_ns_(Tracer::Now()) {
+}
+
+StartupTimeline::Phase::~Phase() {
+  auto end_ns = Tracer::Now();
+  absl::MutexLock lock(&timeline_->mutex_);
+  timeline_->records_.push_back( { name_, start_ns_, end_ns });
+}
+
+void StartupTimeline::Print() {
+  absl::MutexLock lock(&mutex_);
+  std::sort(records_.begin(), records_.end(),
+            [](const Record &a, const Record &b) {
+              return a.start_ns < b.start_ns;
+            });
+  uint64_t end_ns = start_ns_;
+  for (const auto &record : records_) {
+    g_print("startup: %-32s %8.1f ms - %8.1f ms (%8.1f ms)\n",
+            record.name.c_str(), (record.start_ns - start_ns_) / 1e6,
+            (record.end_ns - start_ns_) / 1e6,
+            (record.end_ns - record.start_ns) / 1e6);
+    end_ns = std::max(end_ns, record.end_ns);
+  }
+  g_print("startup: total %.1f ms\n", (end_ns - start_ns_) / 1e6);
+}
+
+StartupTimeline::StartupTimeline()
+    :
+    start_ns_(Tracer::Now()) {
+}
+
+StartupTimeline::~StartupTimeline() {
+}
+
+} /* namespace szd */
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * StartupTimeline.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_STARTUPTIMELINE_H_
+#define SRC_STARTUPTIMELINE_H_
+
+#include <cstdint>
+#include <future>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+
+namespace szd {
+
+// Runs the independent steps of the pipeline setup concurrently and
+// records when each of them started and finished.
+class StartupTimeline {
+ public:
+  StartupTimeline();
+  StartupTimeline(const StartupTimeline &other) = delete;
+  StartupTimeline(StartupTimeline &&other) = delete;
+  StartupTimeline& operator=(const StartupTimeline &other) = delete;
+  StartupTimeline& operator=(StartupTimeline &&other) = delete;
+  virtual ~StartupTimeline();
+
+  // Runs fn on a thread of its own as the phase name.
+  template<typename F>
+  std::future<typename std::result_of<F()>::type> Start(
+      const std::string &name, F fn) {
+    return std::async(std::launch::async, [this, name, fn] {
+      Phase phase(this, name);
+      return fn();
+    });
+  }
+  // Runs fn on the calling thread as the phase name.
+  template<typename F>
+  typename std::result_of<F()>::type Run(const std::string &name, F fn) {
+    Phase phase(this, name);
+    return fn();
+  }
+  // Prints the phases in the order they started.
+  void Print();
+
+ private:
+  // Records the time from its construction to its destruction.
+  class Phase {
+   public:
+    Phase(StartupTimeline *timeline, const std::string &name);
+    ~Phase();
+
+   private:
+    StartupTimeline *timeline_;
+    std::string name_;
+    uint64_t start_ns_;
+  };
+  struct Record {
+    std::string name;
+    uint64_t start_ns;
+    uint64_t end_ns;
+  };
+
+  uint64_t start_ns_;
+  absl::Mutex mutex_;
+  std::vector<Record> records_;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_STARTUPTIMELINE_H_ */
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * SvgBuilder.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+
+#include "SvgBuilder.h"
+
+namespace szd {
+// Room for roughly 64 boxes and labels before the buffers have to grow.
+static const size_t kInitialBoxesCapacity = 64 * 128;
+static const size_t kInitialLabelsCapacity = 64 * 96;
+static const char kSvgFooter[] = "</svg>";
+
+void SvgBuilder::Begin() {
+  // clear() keeps the capacity, so steady state appends never reallocate.
+  boxes_.clear();
+  labels_.clear();
+}
+
+void SvgBuilder::AddBox(int x, int y, int width, int height, int red,
+                        int green, int blue) {
+  absl::StrAppend(&boxes_, "<rect x=\"", x, "\" y=\"", y, "\" width=\"", width,
+                  "\" height=\"", height, "\" fill-opacity=\"0.0\" ");
+  absl::StrAppend(&boxes_, "style=\"stroke-width:2;stroke:rgb(", red, ",",
+                  green, ",", blue, ");\"/>");
+}
+
+void SvgBuilder::AddLabel(int x, int y, const char *fill,
+                          const std::string &candidate, float score) {
+  absl::StrAppend(&labels_, "<text x=\"", x, "\" y=\"", y,
+                  "\" font-size=\"large\" fill=\"", fill, "\">");
+  absl::StrAppend(&labels_, candidate, ": ", score, "</text>");
+}
+
+const std::string& SvgBuilder::Finish(const std::string &prefix) {
+  svg_.clear();
+  svg_.reserve(
+      header_.size() + prefix.size() + boxes_.size() + labels_.size()
+          + sizeof(kSvgFooter));
+  absl::StrAppend(&svg_, header_, prefix, boxes_, labels_, kSvgFooter);
+  return svg_;
+}
+
+SvgBuilder::SvgBuilder(int width, int height)
+    :
+    header_(absl::StrCat("<svg viewBox=\"0 0 ", width, " ", height, "\">")) {
+  boxes_.reserve(kInitialBoxesCapacity);
+  labels_.reserve(kInitialLabelsCapacity);
+}
+
+SvgBuilder::~SvgBuilder() {
+}
+
+} /* namespace szd */
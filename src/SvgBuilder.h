@@ -0,0 +1,64 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * SvgBuilder.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_SVGBUILDER_H_
+#define SRC_SVGBUILDER_H_
+
+#include <string>
+
+namespace szd {
+
+// Builds the overlay svg for one stream. The internal buffers are kept
+// between frames so once they have grown to fit a busy scene, building a new
+// svg does not touch the heap. Not thread safe, each bin owns its own builder.
+class SvgBuilder {
+ public:
+  SvgBuilder(int width, int height);
+  SvgBuilder() = delete;
+  SvgBuilder(const SvgBuilder &other) = delete;
+  SvgBuilder(SvgBuilder &&other) = delete;
+  SvgBuilder& operator=(const SvgBuilder &other) = delete;
+  SvgBuilder& operator=(SvgBuilder &&other) = delete;
+  virtual ~SvgBuilder();
+
+  // Clears the boxes and labels from the previous frame.
+  void Begin();
+  // Adds a rectangle, coordinates are in svg pixels.
+  void AddBox(int x, int y, int width, int height, int red, int green,
+              int blue);
+  // Adds a "<candidate>: <score>" label at the given svg pixel position.
+  void AddLabel(int x, int y, const char *fill, const std::string &candidate,
+                float score);
+  // Returns the complete svg with prefix (e.g. the keepout polygon) drawn
+  // below the boxes and labels. The reference stays valid until the next
+  // call to Finish().
+  const std::string& Finish(const std::string &prefix);
+
+ private:
+  std::string header_;
+  std::string boxes_;
+  std::string labels_;
+  std::string svg_;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_SVGBUILDER_H_ */
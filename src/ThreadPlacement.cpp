@@ -0,0 +1,247 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * ThreadPlacement.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "absl/base/const_init.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/substitute.h"
+#include "absl/synchronization/mutex.h"
+#include "glog/logging.h"
+
+#include "Metrics.h"
+#include "ThreadPlacement.h"
+
+namespace szd {
+
+// The appsink branches are named appq_<index>, see InferencerBin.
+static const char *kInferenceQueuePrefix = "appq_";
+
+struct StreamPlacement {
+  // Indexed by ThreadPlacement::Role.
+  std::vector<int> cpus[2];
+  int rt_priority = 0;
+};
+
+ABSL_CONST_INIT static absl::Mutex mutex(absl::kConstInit);
+static std::map<int, StreamPlacement> placements;
+static std::map<GstElement*, int> bins;
+// What threads may run on when their stream has no policy.
+static cpu_set_t default_cpus;
+
+// Parses a kernel cpu list such as 0-7,16-23.
+static std::vector<int> ParseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  for (absl::string_view range : absl::StrSplit(list, ',',
+                                                absl::SkipWhitespace())) {
+    std::vector<absl::string_view> bounds = absl::StrSplit(range, '-');
+    int first, last;
+    if (!absl::SimpleAtoi(bounds[0], &first)
+        || !absl::SimpleAtoi(bounds.back(), &last)) {
+      return {};
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// The CPUs of the NUMA node of the TPU at tpu_path, /dev/apex_<n> for a
+// PCIe TPU or the sysfs directory of a USB one, whose closest PCI ancestor
+// is the USB controller. Empty if unknown.
+static std::vector<int> GetLocalCpus(const std::string &tpu_path) {
+  const std::string apex = "/dev/apex_";
+  std::string device = tpu_path;
+  if (device.compare(0, apex.size(), apex) == 0) {
+    device = absl::Substitute("/sys/class/apex/$0/device", device.substr(5));
+  }
+  char resolved[PATH_MAX];
+  if (tpu_path.empty() || !realpath(device.c_str(), resolved)) {
+    return {};
+  }
+  for (std::string dir = resolved; !dir.empty();
+      dir.resize(dir.find_last_of('/'))) {
+    std::ifstream f(dir + "/local_cpulist");
+    std::string list;
+    if (std::getline(f, list)) {
+      return ParseCpuList(list);
+    }
+  }
+  return {};
+}
+
+// cpus limited to local, unless that leaves none.
+static std::vector<int> Restrict(const std::vector<int> &cpus,
+                                 const std::vector<int> &local) {
+  if (local.empty()) {
+    return cpus;
+  }
+  if (cpus.empty()) {
+    return local;
+  }
+  std::vector<int> both;
+  for (int cpu : cpus) {
+    if (std::find(local.begin(), local.end(), cpu) != local.end()) {
+      both.push_back(cpu);
+    }
+  }
+  if (both.empty()) {
+    LOG(WARNING) << "No configured CPU is local to the TPU, using them anyway";
+    return cpus;
+  }
+  return both;
+}
+
+void ThreadPlacement::SetPolicy(int stream, const ThreadPolicy &policy,
+                                const std::string &tpu_path) {
+  const auto local = policy.tpu_local ? GetLocalCpus(tpu_path) :
+      std::vector<int>();
+  absl::MutexLock lock(&mutex);
+  if (placements.empty()) {
+    // Called before the pipeline starts its threads, this is still what
+    // the process was started with.
+    CHECK_EQ(sched_getaffinity(0, sizeof(default_cpus), &default_cpus), 0);
+  }
+  auto &placement = placements[stream];
+  placement.cpus[kStreaming] = Restrict(policy.streaming_cpus, local);
+  placement.cpus[kInference] = Restrict(policy.inference_cpus, local);
+  placement.rt_priority = policy.rt_priority;
+}
+
+void ThreadPlacement::AddBin(GstElement *bin, int stream) {
+  absl::MutexLock lock(&mutex);
+  bins.emplace(bin, stream);
+}
+
+GstBusSyncReply ThreadPlacement::OnBusSync(GstBus *bus, GstMessage *msg,
+                                           gpointer data) {
+  if (GST_MESSAGE_TYPE(msg) != GST_MESSAGE_STREAM_STATUS) {
+    return GST_BUS_PASS;
+  }
+  GstStreamStatusType type;
+  GstElement *owner;
+  gst_message_parse_stream_status(msg, &type, &owner);
+  // Posted from the thread that is starting.
+  if (type != GST_STREAM_STATUS_TYPE_ENTER) {
+    return GST_BUS_PASS;
+  }
+  const auto role =
+      g_str_has_prefix(GST_OBJECT_NAME(owner), kInferenceQueuePrefix) ?
+          kInference : kStreaming;
+  int stream = -1;
+  auto *object = GST_OBJECT(gst_object_ref(owner));
+  while (object && stream < 0) {
+    {
+      absl::MutexLock lock(&mutex);
+      auto found = bins.find(reinterpret_cast<GstElement*>(object));
+      if (found != bins.end()) {
+        stream = found->second;
+      }
+    }
+    auto *parent = gst_object_get_parent(object);
+    gst_object_unref(object);
+    object = parent;
+  }
+  if (object) {
+    gst_object_unref(object);
+  }
+  // Task pool threads are reused, a thread outside the bins may still
+  // carry an earlier placement.
+  Place(stream, role);
+  return GST_BUS_PASS;
+}
+
+void ThreadPlacement::Enter(int stream, Role role) {
+  thread_local bool entered = false;
+  if (!entered) {
+    entered = true;
+    Place(stream, role);
+  }
+}
+
+void ThreadPlacement::Place(int stream, Role role) {
+  thread_local bool placed = false;
+  cpu_set_t cpus;
+  int priority = 0;
+  bool found = false;
+  {
+    absl::MutexLock lock(&mutex);
+    cpus = default_cpus;
+    auto placement = placements.find(stream);
+    if (placement != placements.end()) {
+      found = true;
+      const auto &role_cpus = placement->second.cpus[role];
+      if (!role_cpus.empty()) {
+        CPU_ZERO(&cpus);
+        for (int cpu : role_cpus) {
+          // CPU_SET doesn't check the bounds of the set.
+          if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            LOG(WARNING) << "Stream " << stream << " names CPU " << cpu
+                << ", past the " << CPU_SETSIZE << " a thread can run on";
+            continue;
+          }
+          CPU_SET(cpu, &cpus);
+        }
+        if (CPU_COUNT(&cpus) == 0) {
+          cpus = default_cpus;
+        }
+      }
+      priority = role == kInference ? placement->second.rt_priority : 0;
+    }
+  }
+  if (!found && !placed) {
+    return;
+  }
+
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+    LOG(WARNING) << "Can't set the CPUs of a thread of stream " << stream;
+  }
+  sched_param param = { };
+  param.sched_priority = priority;
+  const int policy = priority ? SCHED_FIFO : SCHED_OTHER;
+  if (pthread_setschedparam(pthread_self(), policy, &param) != 0) {
+    LOG(WARNING) << "Can't set the priority of a thread of stream " << stream
+        << ", real-time priorities need CAP_SYS_NICE";
+  }
+  placed = found;
+  if (found) {
+    MetricsRegistry::GetInstance().GetCounter(
+        "threads_placed_total",
+        "Threads pinned to the CPUs of their stream's thread policy.",
+        absl::Substitute("stream=\"$0\",role=\"$1\"", stream,
+                         role == kInference ? "inference" : "streaming"))
+        ->Increment();
+  }
+}
+
+} /* namespace szd */
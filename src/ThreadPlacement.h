@@ -0,0 +1,90 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * ThreadPlacement.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_THREADPLACEMENT_H_
+#define SRC_THREADPLACEMENT_H_
+
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+
+namespace szd {
+
+// Where the threads of a stream run.
+struct ThreadPolicy {
+  // CPUs the streaming threads of the stream may run on, the ones decoding,
+  // converting and drawing its frames. Empty for any.
+  std::vector<int> streaming_cpus;
+  // CPUs the threads running its inferences may run on, empty for any.
+  std::vector<int> inference_cpus;
+  // Further limits both to the CPUs of the NUMA node the TPU of the stream
+  // is attached to, if the kernel reports one.
+  bool tpu_local = false;
+  // SCHED_FIFO priority of the inference threads, 1 to 99, 0 to leave them
+  // in the normal class. Needs CAP_SYS_NICE.
+  int rt_priority = 0;
+};
+
+// Pins the threads of each stream to the CPUs of its ThreadPolicy so they
+// don't migrate between sockets and caches, and can raise its inference
+// threads to a real-time priority.
+//
+// GStreamer announces every streaming thread it starts on the bus, from the
+// thread itself, with the element owning it. The threads of the elements in
+// a registered bin take the policy of its stream, the ones of the appsink
+// queues being inference threads. Threads started outside GStreamer place
+// themselves with Enter. The GL thread of the display composes the frames of
+// all streams, it belongs to none and is left to the scheduler.
+class ThreadPlacement {
+ public:
+  enum Role {
+    kStreaming,
+    kInference,
+  };
+
+  ThreadPlacement() = delete;
+
+  // Must be called before the pipeline starts. tpu_path is the device the
+  // stream infers on, empty if none.
+  static void SetPolicy(int stream, const ThreadPolicy &policy,
+                        const std::string &tpu_path);
+  // The streaming threads of the elements in bin belong to stream. A bin
+  // shared by streams belongs to the first one added.
+  static void AddBin(GstElement *bin, int stream);
+  // Places the GStreamer threads, set as the sync handler of the pipeline
+  // bus.
+  static GstBusSyncReply OnBusSync(GstBus *bus, GstMessage *msg,
+                                   gpointer data);
+  // Places the calling thread the first time it is called on it, later
+  // calls return right away. For threads that serve a single stream.
+  static void Enter(int stream, Role role);
+
+ private:
+  // Applies the policy of stream to the calling thread, or undoes an
+  // earlier placement if the stream has none. CPUs past CPU_SETSIZE are
+  // left out.
+  static void Place(int stream, Role role);
+};
+
+} /* namespace szd */
+
+#endif /* SRC_THREADPLACEMENT_H_ */
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * ThreadPlacementTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "ThreadPlacement.h"
+
+namespace szd {
+
+// Stream ids of the tests, each test uses its own since policies stay.
+static const int kMeasuredStream = 100;
+static const int kLoadStream = 101;
+static const int kBadCpuStream = 102;
+
+struct Jitter {
+  double p50_us, p99_us, max_us;
+};
+
+// How late a thread waking up every millisecond is, while as many threads
+// as there are CPUs spin. The first thread places itself in stream
+// kMeasuredStream as an inference thread, the spinning ones in kLoadStream
+// as streaming threads, so their policies decide where they run.
+static Jitter MeasureWakeups(int *measured_cpu) {
+  const int kWakeups = 1000;
+  const auto kPeriod = std::chrono::milliseconds(1);
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> load;
+  for (unsigned i = 0; i < std::max(1u, std::thread::hardware_concurrency());
+      ++i) {
+    load.emplace_back([&stop] {
+      ThreadPlacement::Enter(kLoadStream, ThreadPlacement::kStreaming);
+      while (!stop) {
+      }
+    });
+  }
+  std::vector<double> late_us;
+  std::thread measured([&] {
+    ThreadPlacement::Enter(kMeasuredStream, ThreadPlacement::kInference);
+    auto wakeup = std::chrono::steady_clock::now();
+    for (int i = 0; i < kWakeups; ++i) {
+      wakeup += kPeriod;
+      std::this_thread::sleep_until(wakeup);
+      late_us.push_back(std::chrono::duration<double, std::micro>(
+          std::chrono::steady_clock::now() - wakeup).count());
+    }
+    *measured_cpu = sched_getcpu();
+  });
+  measured.join();
+  stop = true;
+  for (auto &thread : load) {
+    thread.join();
+  }
+  std::sort(late_us.begin(), late_us.end());
+  return {late_us[late_us.size() / 2], late_us[late_us.size() * 99 / 100],
+    late_us.back()};
+}
+
+// Without policies both streams share every CPU. With them the measured
+// thread gets CPU 0 and the load the others, as kThreadPolicies would keep
+// a stream's inference thread off the CPUs decoding the other streams.
+TEST(ThreadPlacementTest, PinningKeepsLoadOffTheInferenceCpu) {
+  int cpu;
+  const Jitter shared = MeasureWakeups(&cpu);
+
+  const int num_cpus = std::thread::hardware_concurrency();
+  ThreadPolicy measured_policy;
+  measured_policy.inference_cpus = { 0 };
+  ThreadPlacement::SetPolicy(kMeasuredStream, measured_policy, "");
+  ThreadPolicy load_policy;
+  for (int i = 1; i < num_cpus; ++i) {
+    load_policy.streaming_cpus.push_back(i);
+  }
+  ThreadPlacement::SetPolicy(kLoadStream, load_policy, "");
+  const Jitter pinned = MeasureWakeups(&cpu);
+
+  printf("Wakeup lateness on %d CPUs, p50/p99/max:\n"
+         "  shared  %7.1f %7.1f %7.1f us\n"
+         "  pinned  %7.1f %7.1f %7.1f us\n",
+         num_cpus, shared.p50_us, shared.p99_us, shared.max_us,
+         pinned.p50_us, pinned.p99_us, pinned.max_us);
+  if (num_cpus < 2) {
+    printf("  a single CPU, the load can't be kept off it\n");
+  }
+  EXPECT_EQ(cpu, 0);
+}
+
+TEST(ThreadPlacementTest, IgnoresCpusPastTheSet) {
+  cpu_set_t before;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(before), &before), 0);
+  ThreadPolicy policy;
+  policy.inference_cpus = { CPU_SETSIZE, CPU_SETSIZE + 100, -1 };
+  ThreadPlacement::SetPolicy(kBadCpuStream, policy, "");
+  cpu_set_t after;
+  std::thread([&after] {
+    ThreadPlacement::Enter(kBadCpuStream, ThreadPlacement::kInference);
+    ASSERT_EQ(pthread_getaffinity_np(pthread_self(), sizeof(after), &after),
+              0);
+  }).join();
+  EXPECT_TRUE(CPU_EQUAL(&before, &after));
+}
+
+} /* namespace szd */
@@ -0,0 +1,323 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * TiledInferencerBin.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gst/video/video.h>
+
+#include "absl/strings/substitute.h"
+#include "TiledInferencerBin.h"
+
+namespace szd {
+
+GstFlowReturn TiledInferencerBin::AppsinkOnNewSample(GstElement *sink) {
+  GstSample *sample = NULL;
+  g_signal_emit_by_name(sink, "pull-sample", &sample);
+  if (!sample) {
+    g_error("Failed to pull appsink sample\n");
+    return GST_FLOW_ERROR;
+  }
+  TraceAppsinkSample(sample);
+  if (!DoInterpret()) {
+    metrics_[0].skipped->Increment();
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+  }
+
+  GstVideoFrame frame;
+  YuvImage image;
+  if (!MapYuvFrame(sample, &frame, &image)) {
+    g_error("Couldn't map buffer\n");
+    gst_sample_unref(sample);
+    return GST_FLOW_ERROR;
+  }
+  auto tiles = MakeTiles(ChooseGrid(image));
+  tiles_per_frame_->Set(tiles.size());
+
+  auto start_ns = Tracer::Now();
+  bool stopped;
+  bool inferred = false;
+  {
+    absl::MutexLock lock(&mutex_);
+    stopped = stopped_;
+    if (!stopped) {
+      image_ = &image;
+      pts_ = GST_BUFFER_PTS(gst_sample_get_buffer(sample));
+      tiles_ = std::move(tiles);
+      next_tile_ = 0;
+      pending_tiles_ = tiles_.size();
+      inferred_tiles_ = 0;
+      results_.clear();
+      cond_.SignalAll();
+      // Once stopped only the tiles the workers already took are pending,
+      // they still read the frame.
+      while (pending_tiles_ > 0) {
+        cond_.Wait(&mutex_);
+      }
+      stopped = stopped_;
+      inferred = inferred_tiles_ > 0;
+      image_ = nullptr;
+      // Both keep their capacity for the next frames.
+      detections_.swap(results_);
+      cond_.SignalAll();
+    }
+  }
+  if (!stopped) {
+    metrics_[0].latency->ObserveNs(Tracer::Now() - start_ns);
+    // A frame all of whose tiles the TPU scheduler dropped keeps the last
+    // results on screen.
+    if (inferred) {
+      metrics_[0].inferred->Increment();
+      MergeTileDetections(detections_, suppressor_, &merged_);
+      OutputInferenceResult(ResultsToSvg(merged_));
+    } else {
+      metrics_[0].dropped->Increment();
+    }
+  }
+  gst_video_frame_unmap(&frame);
+  gst_sample_unref(sample);
+  return stopped ? GST_FLOW_FLUSHING : GST_FLOW_OK;
+}
+
+void TiledInferencerBin::RunWorker(Worker &worker) {
+  auto &inferencer = *worker.inferencer;
+  auto &output = worker.result;
+  while (true) {
+    Tile tile;
+    YuvImage image;
+    {
+      absl::MutexLock lock(&mutex_);
+      while (!stopped_ && next_tile_ == tiles_.size()) {
+        cond_.Wait(&mutex_);
+      }
+      if (stopped_) {
+        return;
+      }
+      tile = tiles_[next_tile_++];
+      image = *image_;
+      Tracer::SetContext(trace_stream_, pts_);
+    }
+    ThreadPlacement::Enter(trace_stream_, ThreadPlacement::kInference);
+
+    auto start_ns = Tracer::Now();
+    auto crop = CropYuvImage(image, tile.x1 * image.width,
+                             tile.y1 * image.height,
+                             (tile.x2 - tile.x1) * image.width,
+                             (tile.y2 - tile.y1) * image.height);
+    PrepareInput(crop, worker.preprocessor, inferencer, letterbox_);
+    auto width = inferencer.GetInputWidth();
+    inferencer.InterpretFrame(inferencer.GetInputTensor(),
+                              inferencer.GetInputBytes(), width,
+                              inferencer.GetInputHeight(), width * 3,
+                              output);
+    const uint64_t tile_ns = Tracer::Now() - start_ns;
+
+    absl::MutexLock lock(&mutex_);
+    // A tile dropped by the TPU scheduler adds nothing and its time says
+    // nothing about the next ones.
+    if (!output.dropped) {
+      for (const auto &detection : output.detections) {
+        // From tile to frame coordinates.
+        DetectionResult result = detection;
+        result.x1 = tile.x1 + detection.x1 * (tile.x2 - tile.x1);
+        result.x2 = tile.x1 + detection.x2 * (tile.x2 - tile.x1);
+        result.y1 = tile.y1 + detection.y1 * (tile.y2 - tile.y1);
+        result.y2 = tile.y1 + detection.y2 * (tile.y2 - tile.y1);
+        const bool at_seam = (tile.x1 > 0.0f && detection.x1 < kSeamMargin)
+            || (tile.y1 > 0.0f && detection.y1 < kSeamMargin)
+            || (tile.x2 < 1.0f && detection.x2 > 1.0f - kSeamMargin)
+            || (tile.y2 < 1.0f && detection.y2 > 1.0f - kSeamMargin);
+        results_.push_back( { result, at_seam });
+      }
+      tile_ns_ = tile_ns_ ? (7 * tile_ns_ + tile_ns) / 8 : tile_ns;
+      inferred_tiles_++;
+    }
+    if (--pending_tiles_ == 0) {
+      cond_.SignalAll();
+    }
+  }
+}
+
+int TiledInferencerBin::ChooseGrid(const YuvImage &image) {
+  auto &inferencer = *workers_[0]->inferencer;
+  int max_grid = std::min<int>(image.width / inferencer.GetInputWidth(),
+                               image.height / inferencer.GetInputHeight());
+  max_grid = std::max(1, std::min(kMaxGrid, max_grid));
+
+  uint64_t tile_ns;
+  {
+    absl::MutexLock lock(&mutex_);
+    tile_ns = tile_ns_;
+  }
+  // The whole frame on its own until there is a measurement.
+  if (!tile_ns) {
+    return 1;
+  }
+  const size_t num_workers = workers_.size();
+  int grid = 1;
+  for (int g = 2; g <= max_grid; ++g) {
+    const size_t num_tiles = g * g + 1;
+    const uint64_t frame_ns = (num_tiles + num_workers - 1) / num_workers
+        * tile_ns;
+    if (frame_ns > frame_budget_ns_) {
+      break;
+    }
+    grid = g;
+  }
+  return grid;
+}
+
+std::vector<TiledInferencerBin::Tile> TiledInferencerBin::MakeTiles(int grid) {
+  std::vector<Tile> tiles = { { 0.0f, 0.0f, 1.0f, 1.0f } };
+  if (grid == 1) {
+    return tiles;
+  }
+  const float size = 1.0f / (grid - (grid - 1) * kTileOverlap);
+  const float step = size * (1.0f - kTileOverlap);
+  for (int row = 0; row < grid; ++row) {
+    for (int col = 0; col < grid; ++col) {
+      tiles.push_back( { col * step, row * step,
+          std::min(1.0f, col * step + size), std::min(1.0f, row * step + size) });
+    }
+  }
+  return tiles;
+}
+
+void TiledInferencerBin::MergeTileDetections(
+    const std::vector<TileDetection> &detections,
+    OverlapSuppressor &suppressor, std::vector<DetectionResult> *results) {
+  results->clear();
+  for (const auto &cut : detections) {
+    const auto &a = cut.result;
+    const float area = (a.x2 - a.x1) * (a.y2 - a.y1);
+    bool covered = false;
+    for (const auto &whole : detections) {
+      const auto &b = whole.result;
+      if (!cut.at_seam || &whole == &cut || b.candidate != a.candidate
+          || (b.x2 - b.x1) * (b.y2 - b.y1) <= area) {
+        continue;
+      }
+      const float width = std::max(
+          0.0f, std::min(a.x2, b.x2) - std::max(a.x1, b.x1));
+      const float height = std::max(
+          0.0f, std::min(a.y2, b.y2) - std::max(a.y1, b.y1));
+      if (width * height > kMinSeamCover * area) {
+        covered = true;
+        break;
+      }
+    }
+    if (!covered) {
+      results->push_back(a);
+    }
+  }
+  suppressor.Run(results);
+}
+
+void TiledInferencerBin::SetFullScreenCaps(int src_pad) {
+  std::string caps = "video/x-raw, width=$0, height=$1, pixel-aspect-ratio=1/1";
+  caps = absl::Substitute(caps, fullscreen_video_width_,
+                          fullscreen_video_height_);
+  gst_util_set_object_arg(G_OBJECT(filter_0_), "caps", caps.c_str());
+}
+
+void TiledInferencerBin::SetTiledViewCaps(int src_pad) {
+  std::string caps = "video/x-raw, width=$0, height=$1, pixel-aspect-ratio=1/1";
+  caps = absl::Substitute(caps, tiled_video_width_, tiled_video_height_);
+  gst_util_set_object_arg(G_OBJECT(filter_0_), "caps", caps.c_str());
+}
+
+TiledInferencerBin::TiledInferencerBin(
+    const std::vector<std::shared_ptr<InferencerBase>> &inferencers,
+    std::string video_file, uint64_t frame_budget_ns)
+    :
+    InferencerBin(inferencers.at(0)),
+    frame_budget_ns_(frame_budget_ns) {
+  for (const auto &inferencer : inferencers) {
+    if (inferencer->GetInferencerType() != kDetection) {
+      g_error("Tiles can only be inferred by detection models\n");
+    }
+  }
+
+  SetupAllDims(video_file);
+  auto bin_src = absl::Substitute(inferencer_bin_src_, tiled_video_width_,
+                                  tiled_video_height_,
+                                  MakeInputBranch(*inferencer_));
+  SetupBin(bin_src, video_file);
+  SetupMetrics(0, *inferencer_);
+  tiles_per_frame_ = MetricsRegistry::GetInstance().GetGauge(
+      "tiles_per_frame", "Tiles inferred for the last frame.", metric_labels_);
+
+  for (const auto &inferencer : inferencers) {
+    workers_.push_back(std::make_unique<Worker>());
+    workers_.back()->inferencer = inferencer;
+  }
+  for (auto &worker : workers_) {
+    auto *w = worker.get();
+    worker->thread = std::thread([this, w] {
+      RunWorker(*w);
+    });
+  }
+
+  auto appsink = gst_bin_get_by_name(GST_BIN(bin_), "appsink_0");
+  g_object_set(appsink, "emit-signals", true, NULL);
+  g_signal_connect(
+      appsink,
+      "new-sample",
+      reinterpret_cast<GCallback>(+[](
+          GstElement *sink, TiledInferencerBin *self) -> GstFlowReturn {
+        return self->AppsinkOnNewSample(sink);
+      }),
+      this);
+  gst_object_unref(appsink);
+
+  // Setup the output pad to connect to the mixer
+  auto source_pad_internal = gst_element_get_static_pad(text_overlay_0_, "src");
+  auto source_pad = gst_ghost_pad_new("inf_bin_src_0", source_pad_internal);
+  gst_element_add_pad(bin_, source_pad);
+  gst_object_unref(source_pad_internal);
+
+  num_src_pads_ = 1;
+}
+
+TiledInferencerBin::~TiledInferencerBin() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopped_ = true;
+    // Takes back the tiles no worker has started, so a frame being inferred
+    // only waits for the ones in flight.
+    pending_tiles_ -= tiles_.size() - next_tile_;
+    next_tile_ = tiles_.size();
+    cond_.SignalAll();
+  }
+  for (auto &worker : workers_) {
+    worker->thread.join();
+  }
+  // The streaming thread may still be in AppsinkOnNewSample.
+  absl::MutexLock lock(&mutex_);
+  while (image_) {
+    cond_.Wait(&mutex_);
+  }
+}
+
+} /* namespace szd */
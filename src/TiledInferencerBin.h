@@ -0,0 +1,136 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * TiledInferencerBin.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_TILEDINFERENCERBIN_H_
+#define SRC_TILEDINFERENCERBIN_H_
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+
+#include "InferencerBin.h"
+
+namespace szd {
+  const std::string kTiledInferencerBinSrc =
+      "queue name=q ! videoconvert ! tee name=t "
+          "t. ! videoscale ! capsfilter name=filter_0 caps=video/x-raw,width=$0,height=$1 ! queue ! videoconvert ! "
+          "rsvgoverlay fit-to-frame=true name=rsvg_0 ! textoverlay name=text_0 "
+          "t. ! $2 ! "
+          "queue name=appq_0 leaky=downstream max-size-buffers=1 ! appsink name=appsink_0";
+
+// Detects small objects by running the model on overlapping tiles of the
+// full resolution frame as well as on the whole frame. The tiles are spread
+// over the inferencers, one per TPU, and their results merged with
+// MergeTileDetections(). The grid grows from 1x1 up to where the tiles get
+// smaller than the model input, as far as the measured tile latency fits
+// the TPU time budget of a frame.
+class TiledInferencerBin : public InferencerBin {
+ public:
+  // All inferencers must run the same detection model, each on its own TPU.
+  TiledInferencerBin(
+      const std::vector<std::shared_ptr<InferencerBase>> &inferencers,
+      std::string video_file, uint64_t frame_budget_ns);
+  TiledInferencerBin() = delete;
+  TiledInferencerBin(const TiledInferencerBin &other) = delete;
+  TiledInferencerBin(TiledInferencerBin &&other) = delete;
+  TiledInferencerBin& operator=(const TiledInferencerBin &other) = delete;
+  TiledInferencerBin& operator=(TiledInferencerBin &&other) = delete;
+  virtual ~TiledInferencerBin();
+
+  // Relative to the frame.
+  struct Tile {
+    float x1, y1, x2, y2;
+  };
+  // A detection in frame coordinates and whether its box ends at an edge of
+  // its tile that lies inside the frame, where the object may be cut off.
+  struct TileDetection {
+    DetectionResult result;
+    bool at_seam;
+  };
+
+  // The whole frame followed by a grid x grid set of overlapping tiles.
+  static std::vector<Tile> MakeTiles(int grid);
+  // Drops the detections cut off at a seam that are mostly covered by a
+  // larger one of the same class, the whole object found by a neighbouring
+  // tile or the whole frame, then suppresses the duplicates of the tile
+  // overlaps with suppressor. The results are written to results.
+  static void MergeTileDetections(const std::vector<TileDetection> &detections,
+                                  OverlapSuppressor &suppressor,
+                                  std::vector<DetectionResult> *results);
+
+ private:
+  static const int kMaxGrid = 4;
+  // Part of a tile shared with its neighbour, so objects on a border are
+  // whole in one of them.
+  static constexpr float kTileOverlap = 0.2f;
+  // A box this close to a tile edge, relative to the tile, ends at it.
+  static constexpr float kSeamMargin = 0.01f;
+  // Part of a box cut off at a seam another box must cover to replace it.
+  static constexpr float kMinSeamCover = 0.6f;
+  static constexpr float kIouThreshold = 0.5f;
+
+  struct Worker {
+    std::shared_ptr<InferencerBase> inferencer;
+    FramePreprocessor preprocessor;
+    InferenceResult result;
+    std::thread thread;
+  };
+
+  const std::string inferencer_bin_src_ = kTiledInferencerBinSrc;
+  GstFlowReturn AppsinkOnNewSample(GstElement *sink) override;
+  // Infers tiles of the current frame until the bin is destroyed.
+  void RunWorker(Worker &worker);
+  // Largest grid whose tiles are at least the model input size and whose
+  // tiles are expected to finish within the budget.
+  int ChooseGrid(const YuvImage &image);
+  void SetFullScreenCaps(int src_pad) override;
+  void SetTiledViewCaps(int src_pad) override;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  const uint64_t frame_budget_ns_;
+  // Reused for every frame by the streaming thread.
+  OverlapSuppressor suppressor_ { kIouThreshold };
+  std::vector<TileDetection> detections_;
+  std::vector<DetectionResult> merged_;
+  Gauge *tiles_per_frame_ = nullptr;
+
+  // The frame being inferred, shared with the workers.
+  absl::Mutex mutex_;
+  absl::CondVar cond_;
+  const YuvImage *image_ = nullptr;
+  uint64_t pts_ = 0;
+  std::vector<Tile> tiles_;
+  size_t next_tile_ = 0;
+  size_t pending_tiles_ = 0;
+  // Tiles of the frame the TPU scheduler didn't drop.
+  size_t inferred_tiles_ = 0;
+  std::vector<TileDetection> results_;
+  // Moving average of the time a worker takes for one tile.
+  uint64_t tile_ns_ = 0;
+  bool stopped_ = false;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_TILEDINFERENCERBIN_H_ */
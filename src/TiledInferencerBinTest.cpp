@@ -0,0 +1,134 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * TiledInferencerBinTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "TiledInferencerBin.h"
+
+namespace szd {
+
+static std::vector<DetectionResult> Merge(
+    const std::vector<TiledInferencerBin::TileDetection> &detections) {
+  OverlapSuppressor suppressor(0.5f);
+  std::vector<DetectionResult> results;
+  TiledInferencerBin::MergeTileDetections(detections, suppressor, &results);
+  return results;
+}
+
+TEST(TiledInferencerBinTest, OneTileIsTheWholeFrame) {
+  const auto tiles = TiledInferencerBin::MakeTiles(1);
+  ASSERT_EQ(tiles.size(), 1u);
+  EXPECT_EQ(tiles[0].x1, 0.0f);
+  EXPECT_EQ(tiles[0].y1, 0.0f);
+  EXPECT_EQ(tiles[0].x2, 1.0f);
+  EXPECT_EQ(tiles[0].y2, 1.0f);
+}
+
+TEST(TiledInferencerBinTest, TilesCoverTheFrameAndOverlap) {
+  for (int grid = 2; grid <= 4; ++grid) {
+    const auto tiles = TiledInferencerBin::MakeTiles(grid);
+    ASSERT_EQ(tiles.size(), static_cast<size_t>(grid * grid + 1));
+    EXPECT_EQ(tiles[0].x2, 1.0f);
+    for (int row = 0; row < grid; ++row) {
+      for (int col = 0; col < grid; ++col) {
+        const auto &tile = tiles[1 + row * grid + col];
+        const float size = tile.x2 - tile.x1;
+        EXPECT_NEAR(tile.y2 - tile.y1, size, 1e-5);
+        if (col == 0) {
+          EXPECT_EQ(tile.x1, 0.0f);
+        } else {
+          // A fifth of the tile is shared with the one to the left.
+          EXPECT_NEAR(tiles[row * grid + col].x2 - tile.x1, 0.2f * size,
+                      1e-5);
+        }
+        if (col == grid - 1) {
+          EXPECT_NEAR(tile.x2, 1.0f, 1e-5);
+        }
+        if (row == grid - 1) {
+          EXPECT_NEAR(tile.y2, 1.0f, 1e-5);
+        }
+      }
+    }
+  }
+}
+
+TEST(TiledInferencerBinTest, MergesBoxesCutOffAtASeam) {
+  // The left part of the bird in one tile, the whole bird in the frame.
+  const std::vector<TiledInferencerBin::TileDetection> detections = { { {
+      "bird", 0.9f, 0.4f, 0.4f, 0.5f, 0.6f }, true }, { { "bird", 0.7f, 0.3f,
+      0.4f, 0.6f, 0.6f }, false } };
+  const auto results = Merge(detections);
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].score, 0.7f);
+}
+
+TEST(TiledInferencerBinTest, KeepsSmallObjectsInsideLargeOnes) {
+  // A bird in front of another one, neither cut off.
+  const std::vector<TiledInferencerBin::TileDetection> detections = { { {
+      "bird", 0.9f, 0.4f, 0.4f, 0.5f, 0.6f }, false }, { { "bird", 0.7f, 0.3f,
+      0.4f, 0.6f, 0.6f }, false } };
+  EXPECT_EQ(Merge(detections).size(), 2u);
+}
+
+TEST(TiledInferencerBinTest, KeepsOtherClasses) {
+  const std::vector<TiledInferencerBin::TileDetection> detections = { { {
+      "bird", 0.9f, 0.4f, 0.4f, 0.5f, 0.6f }, true }, { { "cat", 0.7f, 0.3f,
+      0.4f, 0.6f, 0.6f }, false } };
+  EXPECT_EQ(Merge(detections).size(), 2u);
+}
+
+TEST(TiledInferencerBinTest, SuppressesDuplicatesOfOverlappingTiles) {
+  // The same bird found in two tiles and the whole frame.
+  const std::vector<TiledInferencerBin::TileDetection> detections = { { {
+      "bird", 0.6f, 0.40f, 0.40f, 0.50f, 0.50f }, false }, { { "bird", 0.8f,
+      0.41f, 0.40f, 0.51f, 0.50f }, false }, { { "bird", 0.5f, 0.40f, 0.41f,
+      0.50f, 0.51f }, false }, { { "bird", 0.9f, 0.7f, 0.7f, 0.8f, 0.8f },
+      false } };
+  const auto results = Merge(detections);
+  ASSERT_EQ(results.size(), 2u);
+  EXPECT_EQ(results[0].score, 0.9f);
+  EXPECT_EQ(results[1].score, 0.8f);
+}
+
+TEST(TiledInferencerBinTest, ReusesTheSuppressor) {
+  OverlapSuppressor suppressor(0.5f);
+  std::vector<DetectionResult> results;
+  const std::vector<TiledInferencerBin::TileDetection> birds = { { { "bird",
+      0.6f, 0.40f, 0.40f, 0.50f, 0.50f }, false }, { { "bird", 0.8f, 0.41f,
+      0.40f, 0.51f, 0.50f }, false }, { { "cat", 0.7f, 0.40f, 0.40f, 0.50f,
+      0.50f }, false } };
+  const std::vector<TiledInferencerBin::TileDetection> cats = { { { "cat",
+      0.3f, 0.1f, 0.1f, 0.2f, 0.2f }, false } };
+  for (int i = 0; i < 3; ++i) {
+    TiledInferencerBin::MergeTileDetections(birds, suppressor, &results);
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(results[0].candidate, "bird");
+    EXPECT_EQ(results[0].score, 0.8f);
+    EXPECT_EQ(results[1].candidate, "cat");
+    TiledInferencerBin::MergeTileDetections(cats, suppressor, &results);
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].score, 0.3f);
+  }
+}
+
+} /* namespace szd */
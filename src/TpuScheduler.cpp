@@ -0,0 +1,234 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * TpuScheduler.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/substitute.h"
+#include "glog/logging.h"
+
+#include "TpuScheduler.h"
+
+namespace szd {
+
+// The cost of an invoke before its cache group has been timed.
+static const double kDefaultInvokeNs = 1e6;
+
+static absl::Mutex config_mutex;
+static std::map<std::string, int> cache_groups;
+// Co-compiled models share one id, so the number of models says nothing
+// about the ids in use.
+static int next_cache_group = 0;
+static std::map<int, StreamPolicy> stream_policies;
+
+static uint64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TpuScheduler::SetCoCompiled(const std::vector<std::string> &model_paths) {
+  absl::MutexLock lock(&config_mutex);
+  const int group = next_cache_group++;
+  for (const auto &path : model_paths) {
+    cache_groups[path] = group;
+  }
+}
+
+int TpuScheduler::GetCacheGroup(const std::string &model_path) {
+  absl::MutexLock lock(&config_mutex);
+  auto found = cache_groups.find(model_path);
+  if (found != cache_groups.end()) {
+    return found->second;
+  }
+  return cache_groups[model_path] = next_cache_group++;
+}
+
+void TpuScheduler::SetStreamPolicy(int stream, const StreamPolicy &policy) {
+  // The weight divides the cost an invoke is charged.
+  CHECK_GT(policy.weight, 0.0) << "Stream " << stream << " has no weight";
+  absl::MutexLock lock(&config_mutex);
+  stream_policies[stream] = policy;
+}
+
+TpuScheduler& TpuScheduler::ForDevice(const edgetpu::EdgeTpuContext &context) {
+  static absl::Mutex mutex;
+  static std::map<std::string, std::unique_ptr<TpuScheduler>> schedulers;
+  const auto &path = context.GetDeviceEnumRecord().path;
+  absl::MutexLock lock(&mutex);
+  auto &scheduler = schedulers[path];
+  if (!scheduler) {
+    scheduler.reset(new TpuScheduler(path));
+  }
+  return *scheduler;
+}
+
+TpuScheduler::StreamState& TpuScheduler::GetStream(int stream) {
+  auto found = streams_.find(stream);
+  if (found != streams_.end()) {
+    return found->second;
+  }
+  auto &state = streams_[stream];
+  {
+    absl::MutexLock lock(&config_mutex);
+    auto policy = stream_policies.find(stream);
+    if (policy != stream_policies.end()) {
+      state.policy = policy->second;
+    }
+  }
+  state.dropped = MetricsRegistry::GetInstance().GetCounter(
+      "tpu_invokes_dropped_total",
+      "Invokes dropped because they would have missed the deadline of their "
+      "stream.",
+      absl::Substitute("tpu=\"$0\",stream=\"$1\"", tpu_path_, stream));
+  return state;
+}
+
+double TpuScheduler::GetCost(int cache_group) {
+  auto cost = invoke_ns_.find(cache_group);
+  return cost == invoke_ns_.end() ? kDefaultInvokeNs : cost->second;
+}
+
+bool TpuScheduler::Acquire(int cache_group, int stream) {
+  absl::MutexLock lock(&mutex_);
+  auto &state = GetStream(stream);
+  Request request;
+  request.ticket = ++next_ticket_;
+  request.cache_group = cache_group;
+  request.stream = stream;
+  request.charge = GetCost(cache_group) / state.policy.weight;
+  request.finish_tag = std::max(virtual_time_, state.finish_tag)
+      + request.charge;
+  request.deadline_ns =
+      state.policy.deadline_ns ? NowNs() + state.policy.deadline_ns : 0;
+  request.state = Request::kWaiting;
+  state.finish_tag = request.finish_tag;
+  if (!busy_ && waiting_.empty()) {
+    Grant(request);
+    return true;
+  }
+  waiting_.push_back(&request);
+  while (request.state == Request::kWaiting) {
+    cond_.Wait(&mutex_);
+  }
+  return request.state == Request::kGranted;
+}
+
+void TpuScheduler::Release() {
+  absl::MutexLock lock(&mutex_);
+  const double invoke_ns = NowNs() - grant_ns_;
+  auto cost = invoke_ns_.emplace(cached_group_, invoke_ns).first;
+  cost->second += 0.1 * (invoke_ns - cost->second);
+  busy_ = false;
+  GrantNext();
+}
+
+void TpuScheduler::GrantNext() {
+  if (waiting_.empty()) {
+    return;
+  }
+  const auto now_ns = NowNs();
+  for (auto it = waiting_.begin(); it != waiting_.end();) {
+    auto &request = **it;
+    if (request.deadline_ns
+        && now_ns + GetCost(request.cache_group) > request.deadline_ns) {
+      // The stream isn't charged for the time it didn't get.
+      auto &state = streams_[request.stream];
+      state.finish_tag -= request.charge;
+      state.dropped->Increment();
+      request.state = Request::kDropped;
+      it = waiting_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Streams below their minimum rate go first, the furthest behind of them.
+  auto next = waiting_.end();
+  double most_behind = 1.0;
+  for (auto it = waiting_.begin(); it != waiting_.end(); ++it) {
+    const auto &state = streams_[(*it)->stream];
+    const double behind = (now_ns - state.last_grant_ns) * 1e-9
+        * state.policy.min_fps;
+    if (behind > most_behind) {
+      most_behind = behind;
+      next = it;
+    }
+  }
+  // Then the cached parameters while they have work, unless that has kept
+  // the others waiting for long enough, then the lowest finish tag.
+  if (next == waiting_.end()) {
+    auto before = [this](const Request *a, const Request *b) {
+      const bool a_cached = a->cache_group == cached_group_
+          && run_length_ < kMaxRunLength;
+      const bool b_cached = b->cache_group == cached_group_
+          && run_length_ < kMaxRunLength;
+      if (a_cached != b_cached) {
+        return a_cached;
+      }
+      if (a->finish_tag != b->finish_tag) {
+        return a->finish_tag < b->finish_tag;
+      }
+      return a->ticket < b->ticket;
+    };
+    next = std::min_element(waiting_.begin(), waiting_.end(), before);
+  }
+
+  if (next != waiting_.end()) {
+    Grant(**next);
+    waiting_.erase(next);
+  }
+  cond_.SignalAll();
+}
+
+void TpuScheduler::Grant(Request &request) {
+  busy_ = true;
+  request.state = Request::kGranted;
+  grant_ns_ = NowNs();
+  virtual_time_ = request.finish_tag;
+  streams_[request.stream].last_grant_ns = grant_ns_;
+  if (request.cache_group != cached_group_) {
+    if (cached_group_ >= 0) {
+      swaps_->Increment();
+    }
+    cached_group_ = request.cache_group;
+    run_length_ = 0;
+  }
+  run_length_++;
+}
+
+TpuScheduler::TpuScheduler(const std::string &tpu_path)
+    :
+    tpu_path_(tpu_path) {
+  swaps_ = MetricsRegistry::GetInstance().GetCounter(
+      "tpu_cache_swaps_total",
+      "Invokes that needed other parameters than the ones cached on the "
+      "TPU.",
+      absl::Substitute("tpu=\"$0\"", tpu_path));
+}
+
+TpuScheduler::~TpuScheduler() {
+}
+
+} /* namespace szd */
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * TpuScheduler.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_TPUSCHEDULER_H_
+#define SRC_TPUSCHEDULER_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "tflite/public/edgetpu.h"
+
+#include "Metrics.h"
+
+namespace szd {
+
+// How a stream shares the TPUs it uses with the other streams.
+struct StreamPolicy {
+  // Share of TPU time relative to the other streams waiting for it.
+  double weight = 1.0;
+  // Inferences per second the stream gets before any fair share is
+  // considered, 0 for none.
+  double min_fps = 0.0;
+  // An invoke that can't finish within this long of asking for the TPU is
+  // dropped without running, 0 to always run.
+  uint64_t deadline_ns = 0;
+};
+
+// Orders the invokes of the models sharing one Edge TPU.
+//
+// Streams share the TPU by weighted fair queueing, each invoke is tagged
+// with the virtual time its stream will have used when it finishes and the
+// lowest tag goes first. Streams behind their minimum rate go ahead of
+// that, and invokes past their deadline are dropped before they take TPU
+// time.
+//
+// The TPU caches the parameters of one model, or of one set of co-compiled
+// models, and reloads them whenever an invoke needs a different one. While
+// the cached model has invokes waiting they go first, up to kMaxRunLength in
+// a row, so a swap is paid once for several invokes instead of on every
+// other one.
+class TpuScheduler {
+ public:
+  // Invokes of one cache group run back to back when others are waiting.
+  static constexpr int kMaxRunLength = 4;
+
+  static TpuScheduler& ForDevice(const edgetpu::EdgeTpuContext &context);
+  TpuScheduler(const TpuScheduler &other) = delete;
+  TpuScheduler(TpuScheduler &&other) = delete;
+  TpuScheduler& operator=(const TpuScheduler &other) = delete;
+  TpuScheduler& operator=(TpuScheduler &&other) = delete;
+  virtual ~TpuScheduler();
+
+  // Models compiled together share the parameter cache, switching between
+  // them is free. Must be called before their inferencers are created.
+  static void SetCoCompiled(const std::vector<std::string> &model_paths);
+  // The models in a cache group can run without reloading the TPU.
+  static int GetCacheGroup(const std::string &model_path);
+  // Must be called before the stream runs its first invoke, streams
+  // without a policy get the default one. The weight must be positive.
+  static void SetStreamPolicy(int stream, const StreamPolicy &policy);
+
+  // Blocks until it is the turn of this invoke of cache_group for stream.
+  // Returns false if the invoke was dropped, otherwise it must be followed
+  // by a Release once the TPU is done.
+  bool Acquire(int cache_group, int stream);
+  void Release();
+  // Times the TPU had to load different parameters.
+  uint64_t GetNumSwaps() {
+    return swaps_->Get();
+  }
+
+ private:
+  struct Request {
+    uint64_t ticket;
+    int cache_group;
+    int stream;
+    double finish_tag;
+    // Virtual time the stream is charged for the invoke.
+    double charge;
+    uint64_t deadline_ns;
+    enum {
+      kWaiting,
+      kGranted,
+      kDropped,
+    } state;
+  };
+  struct StreamState {
+    StreamPolicy policy;
+    // Virtual time at the end of the last invoke queued for the stream.
+    double finish_tag = 0.0;
+    uint64_t last_grant_ns = 0;
+    Counter *dropped = nullptr;
+  };
+
+  TpuScheduler(const std::string &tpu_path);
+  StreamState& GetStream(int stream);
+  // Expected time of an invoke of cache_group.
+  double GetCost(int cache_group);
+  // Drops the waiting invokes past their deadline and hands the TPU to the
+  // next one, if any.
+  void GrantNext();
+  void Grant(Request &request);
+
+  std::string tpu_path_;
+  // Guards everything below but swaps_.
+  absl::Mutex mutex_;
+  absl::CondVar cond_;
+  bool busy_ = false;
+  int cached_group_ = -1;
+  int run_length_ = 0;
+  uint64_t next_ticket_ = 0;
+  uint64_t grant_ns_ = 0;
+  double virtual_time_ = 0.0;
+  // Moving average of the invoke time of each cache group.
+  std::map<int, double> invoke_ns_;
+  std::map<int, StreamState> streams_;
+  // Owned by the threads waiting in Acquire.
+  std::vector<Request*> waiting_;
+  Counter *swaps_ = nullptr;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_TPUSCHEDULER_H_ */
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * TpuSchedulerTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "gtest/gtest.h"
+
+#include "MockDeviceProvider.h"
+#include "TpuScheduler.h"
+
+namespace szd {
+
+// A mock TPU of its own for each test, the schedulers are per device path.
+static std::unique_ptr<MockEdgeTpu> MakeDevice(const std::string &path,
+                                               int invoke_us,
+                                               int swap_penalty_us) {
+  MockTpuConfig config;
+  config.num_devices = 1;
+  config.invoke_us = invoke_us;
+  config.jitter_us = 0;
+  config.swap_penalty_us = swap_penalty_us;
+  return std::make_unique<MockEdgeTpu>(
+      edgetpu::EdgeTpuManager::DeviceEnumerationRecord {
+          edgetpu::DeviceType::kApexPci, path },
+      config, 0);
+}
+
+// Hands the TPU out in the order it was asked for, as a fair lock would
+// without the scheduler.
+class FifoTurns {
+ public:
+  void Acquire() {
+    absl::MutexLock lock(&mutex_);
+    const uint64_t ticket = next_ticket_++;
+    while (ticket != serving_) {
+      cond_.Wait(&mutex_);
+    }
+  }
+  void Release() {
+    absl::MutexLock lock(&mutex_);
+    serving_++;
+    cond_.SignalAll();
+  }
+
+ private:
+  absl::Mutex mutex_;
+  absl::CondVar cond_;
+  uint64_t next_ticket_ = 0;
+  uint64_t serving_ = 0;
+};
+
+// Four streams on each of two models that don't fit the parameter cache
+// together, every stream invoking back to back. Takes turns by arrival
+// without a scheduler.
+static uint64_t RunTwoModels(MockEdgeTpu &device, TpuScheduler *scheduler,
+                             int invokes_per_stream) {
+  int models[2];
+  FifoTurns fifo;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    const int group = i % 2;
+    threads.emplace_back([&, group, i] {
+      for (int j = 0; j < invokes_per_stream; ++j) {
+        if (scheduler) {
+          ASSERT_TRUE(scheduler->Acquire(group, i));
+        } else {
+          fifo.Acquire();
+        }
+        device.Invoke(&models[group]);
+        if (scheduler) {
+          scheduler->Release();
+        } else {
+          fifo.Release();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return device.GetNumSwaps();
+}
+
+TEST(TpuSchedulerTest, RunsTheCachedModelBackToBack) {
+  const int kInvokesPerStream = 10;
+  const int kInvokes = 8 * kInvokesPerStream;
+  auto fifo_device = MakeDevice("/dev/mock_sched_0", 500, 2000);
+  auto start = std::chrono::steady_clock::now();
+  const auto fifo_swaps = RunTwoModels(*fifo_device, nullptr,
+                                       kInvokesPerStream);
+  const double fifo_seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+  auto device = MakeDevice("/dev/mock_sched_1", 500, 2000);
+  auto &scheduler = TpuScheduler::ForDevice(*device);
+  start = std::chrono::steady_clock::now();
+  const auto swaps = RunTwoModels(*device, &scheduler, kInvokesPerStream);
+  const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  printf("%d invokes of two models: %llu swaps in %.0f ms in arrival order, "
+         "%llu swaps in %.0f ms scheduled\n",
+         kInvokes, static_cast<unsigned long long>(fifo_swaps),
+         fifo_seconds * 1e3, static_cast<unsigned long long>(swaps),
+         seconds * 1e3);
+
+  // The scheduler saw the swaps the device paid for.
+  EXPECT_EQ(scheduler.GetNumSwaps(), swaps);
+  // At most one swap per run of the cached model, with a little slack for
+  // the runs that end when a model has nothing waiting.
+  EXPECT_LE(swaps, kInvokes / TpuScheduler::kMaxRunLength + 4);
+  EXPECT_LT(swaps, fifo_swaps);
+  EXPECT_LT(seconds, fifo_seconds);
+}
+
+TEST(TpuSchedulerTest, SharesTheTpuByWeight) {
+  StreamPolicy heavy;
+  heavy.weight = 3.0;
+  TpuScheduler::SetStreamPolicy(100, heavy);
+  TpuScheduler::SetStreamPolicy(101, StreamPolicy());
+  auto device = MakeDevice("/dev/mock_sched_2", 1000, 0);
+  auto &scheduler = TpuScheduler::ForDevice(*device);
+  int model;
+  std::atomic<bool> running(true);
+  std::atomic<int> invokes[2];
+  invokes[0] = 0;
+  invokes[1] = 0;
+  std::vector<std::thread> threads;
+  // Two threads per stream keep an invoke of each waiting.
+  for (int i = 0; i < 4; ++i) {
+    const int index = i % 2;
+    threads.emplace_back([&, index] {
+      while (running) {
+        ASSERT_TRUE(scheduler.Acquire(0, 100 + index));
+        device->Invoke(&model);
+        scheduler.Release();
+        invokes[index]++;
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(400));
+  running = false;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  const double ratio = static_cast<double>(invokes[0]) / invokes[1];
+  printf("Weights 3:1 got %d:%d invokes\n", invokes[0].load(),
+         invokes[1].load());
+  EXPECT_GT(ratio, 2.0);
+  EXPECT_LT(ratio, 4.5);
+}
+
+TEST(TpuSchedulerTest, DropsInvokesPastTheirDeadline) {
+  StreamPolicy urgent;
+  urgent.deadline_ns = 2000000;
+  TpuScheduler::SetStreamPolicy(200, urgent);
+  auto device = MakeDevice("/dev/mock_sched_3", 10000, 0);
+  auto &scheduler = TpuScheduler::ForDevice(*device);
+  int model;
+  // Times the model, an invoke then takes longer than the deadline.
+  ASSERT_TRUE(scheduler.Acquire(0, 201));
+  device->Invoke(&model);
+  scheduler.Release();
+
+  ASSERT_TRUE(scheduler.Acquire(0, 201));
+  std::thread busy([&] {
+    device->Invoke(&model);
+    scheduler.Release();
+  });
+  EXPECT_FALSE(scheduler.Acquire(0, 200));
+  busy.join();
+  // Without another invoke in the way there is time.
+  EXPECT_TRUE(scheduler.Acquire(0, 200));
+  scheduler.Release();
+}
+
+TEST(TpuSchedulerTest, GivesEveryCacheGroupItsOwnId) {
+  const int detector = TpuScheduler::GetCacheGroup("groups/detector");
+  EXPECT_NE(TpuScheduler::GetCacheGroup("groups/classifier"), detector);
+  EXPECT_EQ(TpuScheduler::GetCacheGroup("groups/detector"), detector);
+  // Grouping known models adds no model but a group.
+  TpuScheduler::SetCoCompiled( { "groups/detector", "groups/classifier" });
+  const int co_compiled = TpuScheduler::GetCacheGroup("groups/detector");
+  EXPECT_EQ(TpuScheduler::GetCacheGroup("groups/classifier"), co_compiled);
+  const int other = TpuScheduler::GetCacheGroup("groups/other");
+  EXPECT_NE(other, co_compiled);
+  TpuScheduler::SetCoCompiled( { "groups/first", "groups/second" });
+  const int pair = TpuScheduler::GetCacheGroup("groups/first");
+  EXPECT_NE(pair, co_compiled);
+  EXPECT_NE(pair, other);
+  EXPECT_NE(TpuScheduler::GetCacheGroup("groups/last"), pair);
+}
+
+TEST(TpuSchedulerTest, RejectsStreamsWithoutWeight) {
+  StreamPolicy policy;
+  policy.weight = 0.0;
+  EXPECT_DEATH(TpuScheduler::SetStreamPolicy(300, policy), "no weight");
+}
+
+} /* namespace szd */
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Tracer.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "Tracer.h"
+
+namespace szd {
+thread_local Tracer::ThreadBuffer *Tracer::thread_buffer_ = nullptr;
+thread_local TraceContext Tracer::context_;
+
+Tracer& Tracer::GetInstance() {
+  static Tracer tracer;
+  return tracer;
+}
+
+uint64_t Tracer::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::SetContext(int stream, uint64_t pts) {
+  context_.stream = stream;
+  context_.pts = pts;
+}
+
+void Tracer::SetContextPts(uint64_t pts) {
+  context_.pts = pts;
+}
+
+TraceContext Tracer::GetContext() {
+  return context_;
+}
+
+int Tracer::RegisterStream(const std::string &name) {
+  absl::MutexLock lock(&mutex_);
+  streams_.push_back(name);
+  return streams_.size() - 1;
+}
+
+Tracer::ThreadBuffer* Tracer::GetThreadBuffer() {
+  if (!thread_buffer_) {
+    // Only the first span of every thread takes the lock. The buffers are
+    // owned by the tracer so they outlive their threads and can be exported.
+    auto buffer = std::make_unique<ThreadBuffer>();
+    buffer->events.reset(new TraceSlot[ThreadBuffer::kCapacity]);
+    buffer->head.store(0);
+    absl::MutexLock lock(&mutex_);
+    buffer->tid = buffers_.size() + 1;
+    thread_buffer_ = buffer.get();
+    buffers_.push_back(std::move(buffer));
+  }
+  return thread_buffer_;
+}
+
+void Tracer::Record(const char *name, int stream, uint64_t pts,
+                    uint64_t start_ns, uint64_t end_ns) {
+  if (!IsEnabled()) {
+    return;
+  }
+  auto *buffer = GetThreadBuffer();
+  const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+  auto &slot = buffer->events[head % ThreadBuffer::kCapacity];
+  // Seqlock, a reader seeing seq unchanged around its reads got one event.
+  slot.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.stream.store(stream, std::memory_order_relaxed);
+  slot.pts.store(pts, std::memory_order_relaxed);
+  slot.start_ns.store(start_ns, std::memory_order_relaxed);
+  slot.end_ns.store(end_ns, std::memory_order_relaxed);
+  slot.seq.store(head + 1, std::memory_order_release);
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::Record(const char *name, uint64_t start_ns, uint64_t end_ns) {
+  Record(name, context_.stream, context_.pts, start_ns, end_ns);
+}
+
+bool Tracer::WriteChromeTrace(const std::string &path) {
+  std::ofstream out(path);
+  if (!out.good()) {
+    return false;
+  }
+
+  absl::MutexLock lock(&mutex_);
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  // Every stream is shown as a process, spans without a stream under -1.
+  bool first = true;
+  for (size_t i = 0; i < streams_.size(); ++i) {
+    out << (first ? "" : ",") << "{\"name\":\"process_name\",\"ph\":\"M\","
+        << "\"pid\":" << i << ",\"args\":{\"name\":\"" << streams_[i]
+        << "\"}}";
+    first = false;
+  }
+
+  for (const auto &buffer : buffers_) {
+    const uint64_t head = buffer->head.load(std::memory_order_acquire);
+    // The slot of the oldest event is the next one the thread writes, it is
+    // left out of a full ring.
+    const uint64_t begin =
+        head >= ThreadBuffer::kCapacity ?
+            head - ThreadBuffer::kCapacity + 1 : 0;
+    std::vector<TraceEvent> events;
+    events.reserve(head - begin);
+    for (uint64_t i = begin; i < head; ++i) {
+      const auto &slot = buffer->events[i % ThreadBuffer::kCapacity];
+      if (slot.seq.load(std::memory_order_acquire) != i + 1) {
+        continue;
+      }
+      TraceEvent event;
+      event.name = slot.name.load(std::memory_order_relaxed);
+      event.stream = slot.stream.load(std::memory_order_relaxed);
+      event.pts = slot.pts.load(std::memory_order_relaxed);
+      event.start_ns = slot.start_ns.load(std::memory_order_relaxed);
+      event.end_ns = slot.end_ns.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // Overwritten by the thread while we were copying it.
+      if (slot.seq.load(std::memory_order_relaxed) != i + 1) {
+        continue;
+      }
+      events.push_back(event);
+    }
+
+    for (const auto &event : events) {
+      const double ts = (event.start_ns - start_ns_) / 1000.0;
+      out << (first ? "" : ",") << "{\"name\":\"" << event.name
+          << "\",\"pid\":" << event.stream << ",\"tid\":" << buffer->tid
+          << ",\"ts\":" << ts;
+      if (event.end_ns > event.start_ns) {
+        out << ",\"ph\":\"X\",\"dur\":"
+            << (event.end_ns - event.start_ns) / 1000.0;
+      } else {
+        out << ",\"ph\":\"i\",\"s\":\"t\"";
+      }
+      if (event.pts != TraceContext::kNoPts) {
+        out << ",\"args\":{\"pts\":" << event.pts << "}";
+      }
+      out << "}";
+      first = false;
+    }
+  }
+  out << "]}\n";
+  return out.good();
+}
+
+Tracer::Tracer()
+    :
+    start_ns_(Now()) {
+}
+
+Tracer::~Tracer() {
+}
+
+} /* namespace szd */
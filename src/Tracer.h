@@ -0,0 +1,144 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Tracer.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_TRACER_H_
+#define SRC_TRACER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+
+namespace szd {
+
+// The stream and frame the current thread is working on. Spans recorded
+// without an explicit stream are attributed to it.
+struct TraceContext {
+  static const uint64_t kNoPts = UINT64_MAX;
+  int stream = -1;
+  uint64_t pts = kNoPts;
+};
+
+// Collects timing spans for every stage of the pipeline and writes them as a
+// Chrome trace (chrome://tracing or ui.perfetto.dev). Each thread records
+// into its own fixed size ring so recording never locks or allocates, only
+// the oldest spans are lost when a ring wraps. Does nothing until enabled.
+class Tracer {
+ public:
+  static Tracer& GetInstance();
+  Tracer(const Tracer &other) = delete;
+  Tracer(Tracer &&other) = delete;
+  Tracer& operator=(const Tracer &other) = delete;
+  Tracer& operator=(Tracer &&other) = delete;
+  virtual ~Tracer();
+
+  void Enable() {
+    enabled_.store(true, std::memory_order_relaxed);
+  }
+  bool IsEnabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+  // Returns the id to record spans of the named stream with.
+  int RegisterStream(const std::string &name);
+  // Records a span, or an instant event when start_ns == end_ns.
+  void Record(const char *name, int stream, uint64_t pts, uint64_t start_ns,
+              uint64_t end_ns);
+  // Records a span for the stream and frame in the thread's context.
+  void Record(const char *name, uint64_t start_ns, uint64_t end_ns);
+  // Writes all spans recorded so far, returns false if the file couldn't be
+  // written.
+  bool WriteChromeTrace(const std::string &path);
+
+  static uint64_t Now();
+  static void SetContext(int stream, uint64_t pts);
+  static void SetContextPts(uint64_t pts);
+  static TraceContext GetContext();
+
+ private:
+  struct TraceEvent {
+    const char *name;
+    int stream;
+    uint64_t pts;
+    uint64_t start_ns;
+    uint64_t end_ns;
+  };
+  // A ring slot, read by WriteChromeTrace while its thread may be rewriting
+  // it. seq is the ring position + 1 of the event it holds, 0 while it is
+  // being written.
+  struct TraceSlot {
+    std::atomic<uint64_t> seq { 0 };
+    std::atomic<const char*> name;
+    std::atomic<int> stream;
+    std::atomic<uint64_t> pts;
+    std::atomic<uint64_t> start_ns;
+    std::atomic<uint64_t> end_ns;
+  };
+  // Single producer ring, written only by its thread.
+  struct ThreadBuffer {
+    static const size_t kCapacity = 1 << 14;
+    std::unique_ptr<TraceSlot[]> events;
+    std::atomic<uint64_t> head;
+    int tid;
+  };
+
+  Tracer();
+  ThreadBuffer* GetThreadBuffer();
+
+  static thread_local ThreadBuffer *thread_buffer_;
+  static thread_local TraceContext context_;
+  std::atomic<bool> enabled_ { false };
+  uint64_t start_ns_;
+  absl::Mutex mutex_;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+  std::vector<std::string> streams_;
+};
+
+// Records the time from construction to destruction for the stream and frame
+// in the thread's context.
+class TraceSpan {
+ public:
+  TraceSpan(const char *name)
+      :
+      name_(name),
+      start_ns_(Tracer::GetInstance().IsEnabled() ? Tracer::Now() : 0) {
+  }
+  TraceSpan() = delete;
+  TraceSpan(const TraceSpan &other) = delete;
+  TraceSpan(TraceSpan &&other) = delete;
+  TraceSpan& operator=(const TraceSpan &other) = delete;
+  TraceSpan& operator=(TraceSpan &&other) = delete;
+  ~TraceSpan() {
+    if (start_ns_) {
+      Tracer::GetInstance().Record(name_, start_ns_, Tracer::Now());
+    }
+  }
+
+ private:
+  const char *name_;
+  uint64_t start_ns_;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_TRACER_H_ */
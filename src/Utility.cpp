@@ -20,6 +20,7 @@
  *      Author: pnordstrom
  */
 
+#include <algorithm>
 #include <cmath>
 #include <string>
 #include <utility>
@@ -64,6 +65,13 @@ bool Utility::Line::IntersectsLine(const Line &l) const {
   return false;
 }
 
+float Utility::Letterbox::MapX(float x) const {
+  return std::min(1.0f, std::max(0.0f, (x - x_) / width_));
+}
+float Utility::Letterbox::MapY(float y) const {
+  return std::min(1.0f, std::max(0.0f, (y - y_) / height_));
+}
+
 Utility::Polygon::Polygon(std::vector<Point> &polygon_points) {
   lines_.emplace_back(polygon_points[0],
                       polygon_points[polygon_points.size() - 1]);
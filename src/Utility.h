@@ -76,6 +76,19 @@ class Utility {
     double length_;
   };
 
+  // Where a video frame was placed in the model input when its aspect ratio
+  // was preserved, relative to the model input size. The default maps the
+  // frame onto the whole input.
+  struct Letterbox {
+    // Maps a coordinate relative to the model input back to the frame.
+    float MapX(float x) const;
+    float MapY(float y) const;
+    float x_ = 0.0;
+    float y_ = 0.0;
+    float width_ = 1.0;
+    float height_ = 1.0;
+  };
+
   class Polygon {
    public:
     Polygon() {
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * VideoInfoCache.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gst/pbutils/pbutils.h>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "VideoInfoCache.h"
+
+namespace szd {
+
+VideoInfoCache& VideoInfoCache::GetInstance() {
+  static VideoInfoCache cache;
+  return cache;
+}
+
+std::string VideoInfoCache::MakeKey(const std::string &video_file) {
+  struct stat status;
+  if (stat(video_file.c_str(), &status) != 0) {
+    return "";
+  }
+  return absl::StrCat(video_file, "\t", status.st_size, "\t",
+                      status.st_mtim.tv_sec, ".", status.st_mtim.tv_nsec);
+}
+
+VideoInfoCache::VideoInfo VideoInfoCache::Discover(
+    const std::string &video_file) {
+  char dir[FILENAME_MAX];
+  auto uri = absl::StrCat("file:///", getcwd(dir, FILENAME_MAX), "/",
+                          video_file);
+
+  auto discoverer = gst_discoverer_new(GST_SECOND * 10, nullptr);
+  auto info = gst_discoverer_discover_uri(discoverer, uri.c_str(), nullptr);
+  auto streaminfo =
+      info ? gst_discoverer_info_get_video_streams(info) : nullptr;
+  if (!streaminfo) {
+    g_error("No video stream found in %s\n", video_file.c_str());
+  }
+  auto video_info = GST_DISCOVERER_VIDEO_INFO(streaminfo->data);
+
+  VideoInfo result;
+  result.width = gst_discoverer_video_info_get_width(video_info);
+  result.height = gst_discoverer_video_info_get_height(video_info)
+      * gst_discoverer_video_info_get_par_denom(video_info)
+      / gst_discoverer_video_info_get_par_num(video_info);
+
+  gst_discoverer_stream_info_list_free(streaminfo);
+  gst_discoverer_info_unref(info);
+  g_object_unref(discoverer);
+  return result;
+}
+
+VideoInfoCache::VideoInfo VideoInfoCache::Get(const std::string &video_file) {
+  const auto key = MakeKey(video_file);
+  {
+    absl::MutexLock lock(&mutex_);
+    auto info = infos_.find(key);
+    if (!key.empty() && info != infos_.end()) {
+      return info->second;
+    }
+  }
+  auto info = Discover(video_file);
+  absl::MutexLock lock(&mutex_);
+  if (!key.empty()) {
+    infos_[key] = info;
+    Save();
+  }
+  return info;
+}
+
+void VideoInfoCache::Prefetch(const std::vector<std::string> &video_files) {
+  std::set<std::string> unique_files(video_files.begin(), video_files.end());
+  std::vector<std::thread> threads;
+  for (const auto &video_file : unique_files) {
+    threads.emplace_back([this, video_file] {
+      Get(video_file);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+void VideoInfoCache::SetCacheFile(const std::string &path) {
+  absl::MutexLock lock(&mutex_);
+  cache_file_ = path;
+  std::ifstream f { path };
+  // One video per line: path, size, mtime, width and height separated by
+  // tabs.
+  for (std::string line; std::getline(f, line);) {
+    std::vector<std::string> p = absl::StrSplit(line, '\t');
+    VideoInfo info;
+    if (p.size() != 5 || !absl::SimpleAtoi(p[3], &info.width)
+        || !absl::SimpleAtoi(p[4], &info.height)) {
+      continue;
+    }
+    infos_[absl::StrCat(p[0], "\t", p[1], "\t", p[2])] = info;
+  }
+}
+
+void VideoInfoCache::Save() {
+  if (cache_file_.empty()) {
+    return;
+  }
+  const auto tmp_path = absl::StrCat(cache_file_, ".tmp");
+  {
+    std::ofstream out(tmp_path);
+    for (const auto &info : infos_) {
+      out << info.first << "\t" << info.second.width << "\t"
+          << info.second.height << "\n";
+    }
+    if (!out.good()) {
+      return;
+    }
+  }
+  rename(tmp_path.c_str(), cache_file_.c_str());
+}
+
+VideoInfoCache::VideoInfoCache() {
+}
+
+VideoInfoCache::~VideoInfoCache() {
+}
+
+} /* namespace szd */
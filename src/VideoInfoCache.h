@@ -0,0 +1,73 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * VideoInfoCache.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_VIDEOINFOCACHE_H_
+#define SRC_VIDEOINFOCACHE_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+
+namespace szd {
+
+// What the bins need to know about a video before the pipeline runs.
+// Discovering a file takes a GstDiscoverer run, so the results are kept in
+// a file and only discovered again when the video's size or modification
+// time changes.
+class VideoInfoCache {
+ public:
+  struct VideoInfo {
+    int width;
+    // Corrected for the pixel aspect ratio.
+    int height;
+  };
+
+  static VideoInfoCache& GetInstance();
+  VideoInfoCache(const VideoInfoCache &other) = delete;
+  VideoInfoCache(VideoInfoCache &&other) = delete;
+  VideoInfoCache& operator=(const VideoInfoCache &other) = delete;
+  VideoInfoCache& operator=(VideoInfoCache &&other) = delete;
+  virtual ~VideoInfoCache();
+
+  // Loads the entries saved in path and saves new ones to it.
+  void SetCacheFile(const std::string &path);
+  // Discovers the videos not cached yet, each on its own thread.
+  void Prefetch(const std::vector<std::string> &video_files);
+  VideoInfo Get(const std::string &video_file);
+
+ private:
+  VideoInfoCache();
+  // The video path, size and modification time, or empty if the file
+  // doesn't exist.
+  static std::string MakeKey(const std::string &video_file);
+  static VideoInfo Discover(const std::string &video_file);
+  void Save();
+
+  absl::Mutex mutex_;
+  std::map<std::string, VideoInfo> infos_;
+  std::string cache_file_;
+};
+
+} /* namespace szd */
+
+#endif /* SRC_VIDEOINFOCACHE_H_ */